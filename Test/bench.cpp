@@ -0,0 +1,572 @@
+#include "pch.h"
+#include "../Src/header/BankDB.h"
+#include "../Src/header/InterestEngine.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+//Benchmarks; disabled so they stay out of the normal test run.
+//Run with: --gtest_also_run_disabled_tests --gtest_filter=Bench*
+
+namespace DB {
+	//times a function, in seconds
+	template <typename F>
+	double timeIt(F f)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		f();
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	//threads each hammer their own accounts with deposits, purchases & transfers; independent accounts shouldn't wait on each other
+	TEST(BenchConcurrency, DISABLED_ParallelPostings) {
+		const int accountsPerThread = 64;
+		const int opsPerThread = 20000;
+		int cores = (int)std::thread::hardware_concurrency();
+		if (cores < 1) cores = 1;
+		double base = 0;
+		for (int threads = 1; threads <= cores; threads *= 2)
+		{
+			std::shared_ptr<Database> db(new Database());
+			std::shared_ptr<Employee> e = db->findEmployee("Admin");
+			for (int i = 0; i < threads * accountsPerThread; i++)
+			{
+				std::shared_ptr<Transaction> t(new Deposit(USDollar(100000)));
+				db->addAccount(std::shared_ptr<Account>(new Checking(t, "b" + std::to_string(i))));
+			}
+			double secs = timeIt([&]()
+			{
+				std::vector<std::thread> pool;
+				for (int w = 0; w < threads; w++)
+				{
+					pool.push_back(std::thread([&, w]()
+					{
+						for (int op = 0; op < opsPerThread; op++)
+						{
+							std::string a = "b" + std::to_string(w * accountsPerThread + op % accountsPerThread);
+							std::string b = "b" + std::to_string(w * accountsPerThread + (op + 1) % accountsPerThread);
+							switch (op % 3)
+							{
+								case 0:
+									e->deposit(db, a, 1.00);
+									break;
+								case 1:
+									db->findAccount(a)->purchase(1.00, "Bench", "Bench");
+									break;
+								default:
+									e->transfer(db, a, b, 1.00);
+									break;
+							}
+						}
+					}));
+				}
+				for (std::thread& t : pool) t.join();
+			});
+			double rate = threads * opsPerThread / secs;
+			if (threads == 1) base = rate;
+			std::cout << threads << " thread(s): " << (long long)rate << " ops/s, speedup " << rate / base << "x\n";
+		}
+	}
+
+	//nightly interest run, account by account vs the column based batch engine
+	TEST(BenchInterest, DISABLED_BatchVsIndividual) {
+		const int accounts = 200000;
+		LinkedList<Account> accs;
+		std::chrono::system_clock::time_point longAgo = std::chrono::system_clock::now() - std::chrono::hours(24 * 400);
+		for (int i = 0; i < accounts; i++)
+		{
+			std::shared_ptr<Transaction> t(new Deposit(USDollar(100000 + i)));
+			std::shared_ptr<Account> a(new Saving(t, "s" + std::to_string(i)));
+			a->setInterestType(i % InterestProductCount);
+			a->LastInterest = longAgo;
+			a->LastPayout = longAgo;
+			accs.put(a);
+		}
+		//first pass resets every due account, so put the timestamps back between runs
+		auto rewind = [&]()
+		{
+			accs.forEach([&](std::shared_ptr<Account> a) { a->LastInterest = longAgo; a->LastPayout = longAgo; return true; });
+		};
+		double individual = timeIt([&]() { accs.forEach([](std::shared_ptr<Account> a) { Interest::IndividualAccount(a); return true; }); });
+		rewind();
+		InterestBatch batch;
+		double gather = timeIt([&]() { batch.gather(accs); });
+		double compute = timeIt([&]() { batch.compute(std::chrono::system_clock::now()); });
+		double scatter = timeIt([&]() { batch.scatter(std::chrono::system_clock::now()); });
+		std::cout << accounts << " accounts\n";
+		std::cout << "individual: " << individual << "s\n";
+		std::cout << "batch: gather " << gather << "s, compute " << compute << "s, scatter " << scatter << "s, total " << gather + compute + scatter << "s\n";
+	}
+
+	//partitioned interest run, speedup versus thread count
+	TEST(BenchInterest, DISABLED_ParallelSpeedup) {
+		const int accounts = 200000;
+		LinkedList<Account> accs;
+		std::chrono::system_clock::time_point longAgo = std::chrono::system_clock::now() - std::chrono::hours(24 * 400);
+		for (int i = 0; i < accounts; i++)
+		{
+			std::shared_ptr<Transaction> t(new Deposit(USDollar(100000 + i)));
+			std::shared_ptr<Account> a(new Saving(t, "s" + std::to_string(i)));
+			a->setInterestType(i % InterestProductCount);
+			accs.put(a);
+		}
+		int cores = (int)std::thread::hardware_concurrency();
+		if (cores < 1) cores = 1;
+		double base = 0;
+		for (int threads = 1; threads <= cores; threads *= 2)
+		{
+			accs.forEach([&](std::shared_ptr<Account> a) { a->LastInterest = longAgo; a->LastPayout = longAgo; return true; });
+			std::shared_ptr<ThreadPool> pool(new ThreadPool(threads));
+			double secs = timeIt([&]() { Interest::AllAccounts(accs, pool); });
+			if (threads == 1) base = secs;
+			std::cout << threads << " thread(s): " << secs << "s, speedup " << base / secs << "x\n";
+		}
+	}
+
+	//bank process tick with 1% of accounts due: due-date queue vs running every account
+	TEST(BenchInterest, DISABLED_SchedulerTick) {
+		const int accounts = 200000;
+		std::shared_ptr<Database> db(new Database());
+		std::chrono::system_clock::time_point longAgo = std::chrono::system_clock::now() - std::chrono::hours(24 * 400);
+		for (int i = 0; i < accounts; i++)
+		{
+			std::shared_ptr<Transaction> t(new Deposit(USDollar(100000 + i)));
+			std::shared_ptr<Account> a(new Saving(t, "s" + std::to_string(i)));
+			a->setInterestType(1 + i % (InterestProductCount - 1));
+			if (i % 100 == 0)
+			{
+				a->LastInterest = longAgo;
+				a->LastPayout = longAgo;
+			}
+			db->addAccount(a);
+		}
+		int changed = 0;
+		double tick = timeIt([&]() { changed = db->bankProcesses(); });
+		double full = timeIt([&]() { for (std::shared_ptr<Shard>& s : db->Shards) Interest::AllAccounts(s->Accounts); });
+		std::cout << accounts << " accounts, " << changed << " due\n";
+		std::cout << "scheduler tick: " << tick << "s, full pass: " << full << "s\n";
+	}
+
+	//ten simulated years of interest for a whole bank, as fast as the due dates can be stepped through
+	TEST(BenchInterest, DISABLED_TenYearFastForward) {
+		const int accounts = 100;
+		std::shared_ptr<SimulatedClock> clock(new SimulatedClock());
+		{
+			std::shared_ptr<Database> db(new Database("BenchTenYears.dat")); //daily payouts pile up thousands of postings, keep them tiered
+			db->setClock(clock);
+			for (int i = 0; i < accounts; i++)
+			{
+				std::shared_ptr<Transaction> t(new Deposit(USDollar(100000 + i)));
+				std::shared_ptr<Account> a(new Saving(t, "s" + std::to_string(i)));
+				a->setInterestType(1 + i % (InterestProductCount - 1));
+				db->addAccount(a);
+				clock->advance(std::chrono::minutes(1)); //spread the due dates out
+			}
+			int changed = 0;
+			double seconds = timeIt([&]() { changed = db->fastForward(*clock, std::chrono::hours(24 * 365 * 10)); });
+			std::cout << accounts << " accounts, 10 years, " << changed << " account updates in " << seconds << "s\n";
+		}
+	}
+
+	//postings per second with the log on, one fsync per record vs group commit, as the number of writers grows
+	TEST(BenchLog, DISABLED_SyncModes) {
+		const int postsPerThread = 200;
+		const char* names[] = { "fsync per record", "group commit" };
+		WriteAheadLog::SyncMode modes[] = { WriteAheadLog::SyncEachRecord, WriteAheadLog::GroupCommit };
+		for (int threads = 1; threads <= 16; threads *= 4)
+		{
+			for (int m = 0; m < 2; m++)
+			{
+				std::remove("BenchLog.dat");
+				std::shared_ptr<Database> db(new Database());
+				db->enableLog("BenchLog.dat", modes[m]);
+				for (int i = 0; i < threads; i++)
+				{
+					std::shared_ptr<Transaction> t(new Deposit(USDollar(100000)));
+					db->addAccount(std::shared_ptr<Account>(new Checking(t, "l" + std::to_string(i))));
+				}
+				std::uint64_t syncsBefore = db->Log->syncs();
+				double secs = timeIt([&]()
+				{
+					std::vector<std::thread> pool;
+					for (int i = 0; i < threads; i++)
+					{
+						pool.push_back(std::thread([&, i]()
+						{
+							std::shared_ptr<Account> a = db->findAccount("l" + std::to_string(i));
+							for (int k = 0; k < postsPerThread; k++) a->deposit(1.00);
+						}));
+					}
+					for (std::thread& th : pool) th.join();
+				});
+				int posts = threads * postsPerThread;
+				std::cout << threads << " writers, " << names[m] << ": " << (int)(posts / secs) << " postings/s, "
+					<< (db->Log->syncs() - syncsBefore) << " syncs for " << posts << " postings\n";
+			}
+		}
+		std::remove("BenchLog.dat");
+	}
+
+	//cold start from a snapshot: write one for a big bank, then time loading it into an empty one.
+	//5M accounts by default; set BENCH_ACCOUNTS for a smaller run
+	TEST(BenchSnapshot, DISABLED_ColdStart) {
+		const char* env = std::getenv("BENCH_ACCOUNTS");
+		const int accounts = env ? std::atoi(env) : 5000000;
+		std::remove("BenchSnapshot.dat");
+		{
+			std::shared_ptr<Database> db(new Database());
+			for (int i = 0; i < accounts; i++)
+			{
+				std::shared_ptr<Transaction> t(new Deposit(USDollar(100000 + i)));
+				std::shared_ptr<Account> a(new Saving(t, "s" + std::to_string(i)));
+				a->setInterestType(1 + i % (InterestProductCount - 1));
+				db->addAccount(a);
+			}
+			double save = timeIt([&]() { db->saveSnapshot("BenchSnapshot.dat"); });
+			std::cout << accounts << " accounts, snapshot written in " << save << "s\n";
+		}
+		std::shared_ptr<Database> db(new Database());
+		int loaded = 0;
+		double load = timeIt([&]() { loaded = db->loadSnapshot("BenchSnapshot.dat"); });
+		std::cout << loaded << " accounts loaded in " << load << "s\n";
+		EXPECT_EQ(loaded, accounts);
+		std::remove("BenchSnapshot.dat");
+	}
+
+	//customer purchases through the database, which look up the customer, ownership & account first: one shard vs many.
+	//each purchase touches a single shard, so with many shards the threads stop meeting on one catalog lock
+	TEST(BenchConcurrency, DISABLED_ShardScaling) {
+		const int customersPerThread = 256;
+		const int opsPerThread = 20000;
+		int cores = (int)std::thread::hardware_concurrency();
+		if (cores < 1) cores = 1;
+		const int shardCounts[] = { 1, Database::DefaultShards };
+		for (int shards : shardCounts)
+		{
+			for (int threads = 1; threads <= cores; threads *= 2)
+			{
+				std::shared_ptr<Database> db(new Database(shards));
+				for (int i = 0; i < threads * customersPerThread; i++)
+				{
+					std::shared_ptr<Customer> c(new Customer("u" + std::to_string(i), "pass"));
+					db->addCustomer(c);
+					std::shared_ptr<Transaction> t(new Deposit(USDollar(100000000)));
+					db->addAccount(std::shared_ptr<Account>(new Checking(t, "h" + std::to_string(i))), c);
+				}
+				double secs = timeIt([&]()
+				{
+					std::vector<std::thread> pool;
+					for (int w = 0; w < threads; w++)
+					{
+						pool.push_back(std::thread([&, w]()
+						{
+							for (int op = 0; op < opsPerThread; op++)
+							{
+								std::string i = std::to_string(w * customersPerThread + op % customersPerThread);
+								db->purchase("h" + i, "u" + i, 0.01, db, "Bench", "Bench");
+							}
+						}));
+					}
+					for (std::thread& t : pool) t.join();
+				});
+				std::cout << shards << " shard(s), " << threads << " thread(s): " << (long long)(threads * opsPerThread / secs) << " purchases/s\n";
+			}
+		}
+	}
+
+	//postings per second while a full-bank report runs over & over: the report locking each account vs reading a pinned view
+	TEST(BenchConcurrency, DISABLED_ReportUnderLoad) {
+		const int accounts = 20000;
+		const int opsPerThread = 20000;
+		int writers = (int)std::thread::hardware_concurrency() - 1;
+		if (writers < 1) writers = 1;
+		const char* names[] = { "locking report", "pinned view report" };
+		for (int mode = 0; mode < 2; mode++)
+		{
+			std::shared_ptr<Database> db(new Database());
+			std::shared_ptr<Employee> e = db->findEmployee("Admin");
+			for (int i = 0; i < accounts; i++)
+			{
+				std::shared_ptr<Transaction> t(new Deposit(USDollar(100000)));
+				db->addAccount(std::shared_ptr<Account>(new Checking(t, "r" + std::to_string(i))));
+			}
+			std::atomic<bool> done(false);
+			int reports = 0;
+			std::thread reporter([&]()
+			{
+				while (!done)
+				{
+					std::string s;
+					std::shared_ptr<ReadView> view = mode == 1 ? db->readView() : std::shared_ptr<ReadView>();
+					db->forEachAccount([&](std::shared_ptr<Account> a)
+					{
+						if (view)
+						{
+							std::shared_ptr<const AccountVersion> v = view->at(*a);
+							if (v) s += a->preview(*v);
+						}
+						else s += a->preview();
+						return true;
+					});
+					reports++;
+				}
+			});
+			double secs = timeIt([&]()
+			{
+				std::vector<std::thread> pool;
+				for (int w = 0; w < writers; w++)
+				{
+					pool.push_back(std::thread([&, w]()
+					{
+						for (int op = 0; op < opsPerThread; op++)
+						{
+							int i = (w * 7919 + op * 31) % accounts;
+							e->transfer(db, "r" + std::to_string(i), "r" + std::to_string((i + 1) % accounts), 0.01);
+						}
+					}));
+				}
+				for (std::thread& t : pool) t.join();
+			});
+			done = true;
+			reporter.join();
+			std::cout << names[mode] << ": " << (long long)(writers * opsPerThread / secs) << " transfers/s, " << reports << " reports\n";
+		}
+	}
+
+	//concurrent transfers between random account pairs through the transfer primitive
+	TEST(BenchConcurrency, DISABLED_RandomTransfers) {
+		const int accounts = 10000;
+		const int opsPerThread = 50000;
+		int cores = (int)std::thread::hardware_concurrency();
+		if (cores < 1) cores = 1;
+		std::shared_ptr<Database> db(new Database());
+		std::vector<std::shared_ptr<Account>> accs;
+		for (int i = 0; i < accounts; i++)
+		{
+			std::shared_ptr<Transaction> t(new Deposit(USDollar(100000)));
+			accs.push_back(std::shared_ptr<Account>(new Checking(t, "t" + std::to_string(i))));
+			db->addAccount(accs.back());
+		}
+		for (int threads = 1; threads <= cores; threads *= 2)
+		{
+			double secs = timeIt([&]()
+			{
+				std::vector<std::thread> pool;
+				for (int w = 0; w < threads; w++)
+				{
+					pool.push_back(std::thread([&, w]()
+					{
+						std::uint32_t x = 2463534242u + w; //xorshift, so threads don't share a generator
+						for (int op = 0; op < opsPerThread; op++)
+						{
+							x ^= x << 13;
+							x ^= x >> 17;
+							x ^= x << 5;
+							Database::transfer(accs[x % accounts], accs[(x >> 16) % accounts], USDollar(1));
+						}
+					}));
+				}
+				for (std::thread& t : pool) t.join();
+			});
+			std::cout << threads << " thread(s): " << (long long)(threads * opsPerThread / secs) << " transfers/s\n";
+		}
+	}
+
+	//card settlement: per-row purchases vs purchaseBatch, with the log off & on
+	TEST(BenchSettlement, DISABLED_BatchVsPerRow) {
+		const int customers = 2000;
+		const int accountsEach = 10;
+		const int rowCount = 200000;
+		const int perRowLogged = 5000; //the logged per-row loop waits for the disk every row, so it only runs a slice & is scaled
+		auto build = [&](bool logged)
+		{
+			std::remove("BenchSettle.dat");
+			std::shared_ptr<Database> db(new Database());
+			if (logged) db->enableLog("BenchSettle.dat");
+			for (int c = 0; c < customers; c++)
+			{
+				std::shared_ptr<Customer> cust(new Customer("s" + std::to_string(c), "pass"));
+				db->addCustomer(cust);
+				for (int k = 0; k < accountsEach; k++)
+				{
+					std::shared_ptr<Transaction> t(new Deposit(USDollar(100000000)));
+					db->addAccount(std::shared_ptr<Account>(new Checking(t, "s" + std::to_string(c) + "_" + std::to_string(k))), cust);
+				}
+			}
+			return db;
+		};
+		std::vector<PurchaseRow> rows;
+		for (int i = 0; i < rowCount; i++)
+		{
+			int c = (i * 7919) % customers;
+			rows.push_back(PurchaseRow{ "s" + std::to_string(c) + "_" + std::to_string(i % accountsEach), "s" + std::to_string(c), 1.25, "Store", "Town" });
+		}
+		for (int logged = 0; logged < 2; logged++)
+		{
+			int sliced = logged ? perRowLogged : rowCount;
+			std::shared_ptr<Database> one = build(logged == 1);
+			double perRow = timeIt([&]()
+			{
+				for (int i = 0; i < sliced; i++) one->purchase(rows[i].account, rows[i].user, rows[i].val, one, rows[i].name, rows[i].origin);
+			});
+			one.reset();
+			std::shared_ptr<Database> batch = build(logged == 1);
+			int posted = 0;
+			double batched = timeIt([&]() { posted = batch->purchaseBatch(rows, batch); });
+			double rowRate = sliced / perRow;
+			double batchRate = posted / batched;
+			std::cout << (logged ? "log on" : "log off") << ": per-row " << (long long)rowRate << " rows/s, batch " << (long long)batchRate
+				<< " rows/s, " << batchRate / rowRate << "x\n";
+		}
+		std::remove("BenchSettle.dat");
+	}
+
+	//migration load: generates a portfolio file & bulk loads it. BENCH_TRANSACTIONS sets the size, 10M by default
+	TEST(BenchLoad, DISABLED_TenMillion) {
+		const char* env = std::getenv("BENCH_TRANSACTIONS");
+		const long long transactions = env ? std::atoll(env) : 10000000;
+		const int accounts = (int)std::max(1LL, transactions / 100);
+		{
+			std::ofstream out("BenchLoad.csv", std::ios::binary);
+			for (int a = 0; a < accounts; a++)
+			{
+				out << "C,l" << a << ",pass\n";
+				out << "A,l" << a << ",l" << a << "," << a % 4 << ",0,1000.00\n";
+			}
+			for (long long t = 0; t < transactions; t++)
+			{
+				out << "T,l" << (t * 7919) % accounts << ",P,-1.25,Store,Town," << 1600000000 + t / 1000 << "\n";
+			}
+		}
+		std::remove("BenchLoad.dat");
+		Database db;
+		db.enableArchive("BenchLoad.dat");
+		BulkLoader loader(db, std::shared_ptr<ThreadPool>(new ThreadPool(0)));
+		BulkLoadResult r;
+		double secs = timeIt([&]() { r = loader.load("BenchLoad.csv"); });
+		std::cout << r.accounts << " accounts, " << r.transactions << " transactions in " << secs << "s, "
+			<< (long long)(r.transactions / secs) << " transactions/s, " << r.rejected << " rejected\n";
+		EXPECT_EQ(r.transactions, transactions);
+		std::remove("BenchLoad.csv");
+		std::remove("BenchLoad.dat");
+	}
+
+	//month-end statement export: every account, one file per shard. BENCH_ACCOUNTS sets the size, 200k by default
+	TEST(BenchStatements, DISABLED_MonthEnd) {
+		const char* env = std::getenv("BENCH_ACCOUNTS");
+		const int accounts = env ? std::atoi(env) : 200000;
+		const int perAccount = 20;
+		Database db;
+		for (int a = 0; a < accounts; a++)
+		{
+			std::shared_ptr<Transaction> t(new Deposit(USDollar(100000)));
+			std::shared_ptr<Account> acc(new Checking(t, "m" + std::to_string(a)));
+			db.addAccount(acc);
+			for (int i = 0; i < perAccount; i++) acc->applyLogged(std::shared_ptr<Transaction>(new Purchase(USDollar(-125), "Store", "Town")));
+		}
+		StatementExporter exporter(db, std::shared_ptr<ThreadPool>(new ThreadPool(0)));
+		long long written = 0;
+		std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+		double secs = timeIt([&]() { written = exporter.exportAll(".", now - std::chrono::hours(24 * 30), now + std::chrono::hours(1)); });
+		std::cout << written << " statements in " << secs << "s, " << (long long)(written / secs) << " statements/s\n";
+		for (int s = 0; s < Database::DefaultShards; s++)
+		{
+			char name[32];
+			std::snprintf(name, sizeof(name), "statements-%02d.txt", s);
+			std::remove(name);
+		}
+	}
+
+	//aggregate query: purchases by origin over every account. BENCH_ACCOUNTS sets the size, 200k by default
+	TEST(BenchQuery, DISABLED_PurchasesByOrigin) {
+		const char* env = std::getenv("BENCH_ACCOUNTS");
+		const int accounts = env ? std::atoi(env) : 200000;
+		const int perAccount = 20;
+		Database db;
+		for (int a = 0; a < accounts; a++)
+		{
+			std::shared_ptr<Transaction> t(new Deposit(USDollar(100000)));
+			std::shared_ptr<Account> acc(new Checking(t, "g" + std::to_string(a)));
+			db.addAccount(acc);
+			for (int i = 0; i < perAccount; i++) acc->applyLogged(std::shared_ptr<Transaction>(new Purchase(USDollar(-125), "Store", "Town" + std::to_string(i % 8))));
+		}
+		QueryEngine engine(db, std::shared_ptr<ThreadPool>(new ThreadPool(0)));
+		TransactionQuery q;
+		q.type = "Purchase";
+		q.group = TransactionQuery::ORIGIN;
+		std::vector<QueryRow> rows;
+		double secs = timeIt([&]() { rows = engine.run(q); });
+		long long scanned = (long long)accounts * (perAccount + 1);
+		std::cout << rows.size() << " groups from " << scanned << " transactions in " << secs << "s, " << (long long)(scanned / secs) << " transactions/s\n";
+	}
+
+	//building & tearing down a bank, with every object on the heap vs in the database's arena. List nodes link both ways & are
+	//never freed, so teardown frees little either way; the nodes left behind keep the arena's blocks too. BENCH_ACCOUNTS sets the
+	//size, 200k by default
+	TEST(BenchArena, DISABLED_BuildAndDestroy) {
+		const char* env = std::getenv("BENCH_ACCOUNTS");
+		const int accounts = env ? std::atoi(env) : 200000;
+		const int perAccount = 20;
+		for (int pooled = 0; pooled < 2; pooled++)
+		{
+			std::shared_ptr<Database> db(new Database(Database::DefaultShards, pooled == 1));
+			double build = timeIt([&]()
+			{
+				for (int a = 0; a < accounts; a++)
+				{
+					std::shared_ptr<Transaction> t = arenaShared<Deposit>(db->Memory.get(), USDollar(100000));
+					std::shared_ptr<Account> acc = makeAccount(ACCOUNT_CHECKING, t, "b" + std::to_string(a), db->Memory.get());
+					db->addAccount(acc);
+					for (int i = 0; i < perAccount; i++) acc->processTransaction(acc->makeTransaction<Purchase>(USDollar(-125), "Store", "Town"));
+				}
+			});
+			double teardown = timeIt([&]() { db.reset(); });
+			std::cout << (pooled ? "arena: " : "heap:  ") << build << "s to build, " << teardown << "s to destroy, "
+				<< (long long)(accounts * (perAccount + 1) / build) << " transactions/s\n";
+		}
+	}
+
+	//a decade of daily interest payouts per account, compacted to 30-day summaries; full rescans before & after. BENCH_ACCOUNTS sets the size, 2000 by default
+	TEST(BenchCompaction, DISABLED_DecadeOfPayouts) {
+		const char* env = std::getenv("BENCH_ACCOUNTS");
+		const int accounts = env ? std::atoi(env) : 2000;
+		const int days = 3650;
+		const std::chrono::system_clock::time_point start = std::chrono::system_clock::now() - std::chrono::hours(24 * (days + 1));
+		Database db;
+		std::vector<std::shared_ptr<Account>> all;
+		for (int a = 0; a < accounts; a++)
+		{
+			std::shared_ptr<Account> acc(new MoneyMarket(std::shared_ptr<Transaction>(new Deposit(USDollar(100000), "Bank", start)), "d" + std::to_string(a)));
+			db.addAccount(acc);
+			for (int d = 1; d <= days; d++) acc->applyLogged(acc->makeTransaction<BankFunction>(USDollar(3), "Interest payout", start + std::chrono::hours(24 * d)));
+			all.push_back(acc);
+		}
+		auto rescan = [&]() { for (std::shared_ptr<Account>& a : all) a->updateBalance(); };
+		double before = timeIt(rescan);
+		long long removed = 0;
+		double compact = timeIt([&]() { removed = db.compactHistory(std::chrono::system_clock::now() - std::chrono::hours(24 * 365)); });
+		double after = timeIt(rescan);
+		std::cout << removed << " transactions folded in " << compact << "s; rescan " << before << "s before, " << after << "s after, "
+			<< all[0]->transactionCount() << " left per account\n";
+	}
+
+	//employee lookups; they used to scan the employee list after missing in the customers, now it's one probe either way
+	TEST(BenchDirectory, DISABLED_EmployeeLookups) {
+		const int customers = 100000;
+		const int employees = 2000;
+		const int lookups = 2000000;
+		Database db;
+		for (int i = 0; i < customers; i++) db.addCustomer(std::shared_ptr<Customer>(new Customer("c" + std::to_string(i), "pw")));
+		for (int i = 0; i < employees; i++) db.addEmployee(std::shared_ptr<Employee>(new Employee("e" + std::to_string(i), "pw")));
+		std::vector<std::string> names;
+		for (int i = 0; i < 1024; i++) names.push_back("e" + std::to_string(i * 7919 % employees));
+		long long found = 0;
+		double t = timeIt([&]() { for (int i = 0; i < lookups; i++) if (db.findUser(names[i & 1023]).role == ROLE_EMPLOYEE) found++; });
+		std::cout << found << " of " << lookups << " employee lookups in " << t << "s, " << (long long)(lookups / t) << " lookups/s\n";
+	}
+}
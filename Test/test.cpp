@@ -1,6 +1,11 @@
 #include "pch.h"
 #include "../Src/header/List.h"
 #include "../Src/header/BankDB.h"
+#include "../Src/header/InterestEngine.h"
+#include "../Src/header/BankServer.h"
+#include <atomic>
+#include <fstream>
+#include <thread>
 
 //LinkedList initialization
 TEST(LinkedList, ListInit)
@@ -401,4 +406,1384 @@ namespace DB {
 		EXPECT_EQ(a1->available, 98999); //$989.99 remaining in available
 
 	}
+
+	//tiered storage; old history spills to the archive & balances still add up
+	TEST(ArchiveTest, ArchiveSpill) {
+		std::shared_ptr<Transaction> t(new Deposit(USDollar(100000))); //1000 dollars
+		std::shared_ptr<Account> a(new Saving(t, "s0001")); //initialize
+		a->Archive = std::shared_ptr<TransactionArchive>(new TransactionArchive("ArchiveSpill.dat"));
+		a->HotWindow = 4; //tiny window so we spill quickly
+		for (int i = 0; i < 20; i++) EXPECT_TRUE(a->deposit(1.00)); //20 more dollars
+		EXPECT_LT(a->Transactions.getCount(), 8); //hot list never gets past twice the window
+		EXPECT_GT(a->archivedCount, 0); //some went to the archive
+		EXPECT_EQ(a->transactionCount(), 21); //nothing lost
+		EXPECT_EQ(a->balance, 102000); //$1020.00 in balance
+		EXPECT_EQ(a->available, 102000); //$1020.00 in available
+	}
+
+	//history & range queries reach back into the archive
+	TEST(ArchiveTest, ArchiveHistory) {
+		std::shared_ptr<Transaction> t(new Deposit(USDollar(100000))); //1000 dollars
+		std::shared_ptr<Account> a(new Checking(t, "c0001")); //initialize
+		a->Archive = std::shared_ptr<TransactionArchive>(new TransactionArchive("ArchiveHistory.dat"));
+		a->HotWindow = 2;
+		EXPECT_TRUE(a->purchase(10.01, "Test Purchase", "Test Company"));
+		for (int i = 0; i < 5; i++) EXPECT_TRUE(a->deposit(1.00));
+		EXPECT_FALSE(a->ArchivedSegments.empty()); //the first transactions are archived now
+		std::string all = a->transactionHistory();
+		EXPECT_NE(all.find("Purchase: Test Purchase - Test Company\n-$10.01"), std::string::npos); //archived purchase comes back intact
+		EXPECT_EQ(a->transactionHistory(1).find("Purchase"), std::string::npos); //only the newest, no archive read needed
+		LinkedList<Transaction> r = a->transactionsBetween(std::chrono::system_clock::time_point::min(), std::chrono::system_clock::time_point::max());
+		EXPECT_EQ(r.getCount(), 7); //everything is in range
+		EXPECT_EQ(r.get(0)->Val, 100000); //oldest first
+		EXPECT_EQ(r.get(1)->Val, -1001);
+	}
+
+	//transfers going both ways between the same accounts at once; ordered locking means no deadlock & no lost money
+	TEST(ConcurrencyTest, OpposingTransfers) {
+		std::shared_ptr<Database> db(new Database());
+		std::shared_ptr<Employee> e = db->findEmployee("Admin");
+		std::shared_ptr<Transaction> t(new Deposit(USDollar(100000))); //1000 dollars
+		std::shared_ptr<Transaction> t1(new Deposit(USDollar(100000))); //1000 dollars
+		EXPECT_TRUE(db->addAccount(std::shared_ptr<Account>(new Checking(t, "c0001"))));
+		EXPECT_TRUE(db->addAccount(std::shared_ptr<Account>(new Checking(t1, "c0002"))));
+		std::thread one([&]() { for (int i = 0; i < 200; i++) e->transfer(db, "c0001", "c0002", 1.00); });
+		std::thread two([&]() { for (int i = 0; i < 200; i++) e->transfer(db, "c0002", "c0001", 2.00); });
+		one.join();
+		two.join();
+		EXPECT_EQ(db->findAccount("c0001")->balance, 120000); //+$200 net
+		EXPECT_EQ(db->findAccount("c0002")->balance, 80000); //-$200 net
+		EXPECT_EQ(db->findAccount("c0001")->transactionCount(), 401); //every leg got posted
+	}
+
+	//product catalog; constants are worked out once & accounts just point at a product
+	TEST(ProductTest, ProductCatalog) {
+		EXPECT_EQ(InterestProductCount, 10);
+		EXPECT_EQ(getProduct(4).accrualHours, 720); //compound monthly
+		EXPECT_EQ(getProduct(4).payoutHours, 720); //paid monthly
+		EXPECT_DOUBLE_EQ(getProduct(6).periodRate, 0.5 / 365); //daily share of the yearly rate
+		EXPECT_EQ(getProduct(9).payoutCents, 2); //10% simple paid daily, 24/8760 of the rate
+		EXPECT_EQ(getProduct(42).id, 0); //unknown products fall back to no interest
+		std::shared_ptr<Transaction> t(new Deposit(USDollar(1)));
+		std::shared_ptr<Account> a(new Saving(t, "s0001"));
+		a->setInterestType(8);
+		EXPECT_EQ(a->product().APY, 5);
+		a->setInterestType(10); //not a product, ignored
+		EXPECT_EQ(a->ProductID, 8);
+	}
+
+	//batch interest engine gives the same results as going account by account
+	TEST(InterestTest, BatchMatchesIndividual) {
+		LinkedList<Account> serial;
+		LinkedList<Account> batch;
+		std::chrono::system_clock::time_point longAgo = std::chrono::system_clock::now() - std::chrono::hours(24 * 400);
+		for (int p = 0; p < InterestProductCount; p++)
+		{
+			for (int k = 0; k < 2; k++) //one normal account & one certificate per product
+			{
+				for (int copy = 0; copy < 2; copy++)
+				{
+					std::shared_ptr<Transaction> t(new Deposit(USDollar(12345678 + p)));
+					std::shared_ptr<Account> a;
+					if (k == 0) a = std::shared_ptr<Account>(new Saving(t, "s" + std::to_string(p)));
+					else a = std::shared_ptr<Account>(new CertOfDep(t, "cd" + std::to_string(p)));
+					a->setInterestType(p);
+					a->LastInterest = longAgo;
+					a->LastPayout = longAgo;
+					(copy == 0 ? serial : batch).put(a);
+				}
+			}
+		}
+		serial.forEach([](std::shared_ptr<Account> a) { Interest::IndividualAccount(a); return true; });
+		InterestBatch engine;
+		EXPECT_GT(engine.run(batch, std::chrono::system_clock::now()), 0); //something was due
+		EXPECT_EQ(engine.size(), serial.getCount());
+		for (int i = 0; i < serial.getCount(); i++)
+		{
+			EXPECT_EQ(serial.get(i)->balance, batch.get(i)->balance);
+			EXPECT_EQ(serial.get(i)->accruedInterest(), batch.get(i)->accruedInterest());
+			EXPECT_EQ(serial.get(i)->transactionCount(), batch.get(i)->transactionCount());
+		}
+	}
+
+	//partitioned interest over a thread pool matches the single threaded run
+	TEST(InterestTest, ParallelMatchesSerial) {
+		LinkedList<Account> serial;
+		LinkedList<Account> parallel;
+		std::chrono::system_clock::time_point longAgo = std::chrono::system_clock::now() - std::chrono::hours(24 * 400);
+		for (int i = 0; i < 500; i++)
+		{
+			for (int copy = 0; copy < 2; copy++)
+			{
+				std::shared_ptr<Transaction> t(new Deposit(USDollar(1000000 + i * 37)));
+				std::shared_ptr<Account> a(new MoneyMarket(t, "mm" + std::to_string(i)));
+				a->setInterestType(i % InterestProductCount);
+				a->LastInterest = longAgo;
+				a->LastPayout = longAgo;
+				(copy == 0 ? serial : parallel).put(a);
+			}
+		}
+		std::shared_ptr<ThreadPool> pool(new ThreadPool(4));
+		EXPECT_EQ(Interest::AllAccounts(serial), Interest::AllAccounts(parallel, pool)); //same number of accounts changed
+		for (int i = 0; i < serial.getCount(); i++)
+		{
+			EXPECT_EQ(serial.get(i)->balance, parallel.get(i)->balance);
+			EXPECT_EQ(serial.get(i)->accruedInterest(), parallel.get(i)->accruedInterest());
+		}
+	}
+
+	//scheduler only runs the accounts that are due
+	TEST(InterestTest, SchedulerRunsDueOnly) {
+		std::shared_ptr<Database> db(new Database());
+		std::chrono::system_clock::time_point longAgo = std::chrono::system_clock::now() - std::chrono::hours(24 * 3);
+		std::shared_ptr<Transaction> t(new Deposit(USDollar(100000)));
+		std::shared_ptr<Transaction> t1(new Deposit(USDollar(100000)));
+		std::shared_ptr<Transaction> t2(new Deposit(USDollar(100000)));
+		std::shared_ptr<Account> none(new Checking(t, "c0001")); //no interest, never queued
+		std::shared_ptr<Account> due(new MoneyMarket(t1, "mm0001"));
+		std::shared_ptr<Account> fresh(new MoneyMarket(t2, "mm0002"));
+		due->setInterestType(9); //10% simple, paid daily
+		fresh->setInterestType(9);
+		due->LastPayout = longAgo;
+		EXPECT_TRUE(db->addAccount(none));
+		EXPECT_TRUE(db->addAccount(due));
+		EXPECT_TRUE(db->addAccount(fresh));
+		EXPECT_EQ(db->Schedule->queued(), 2);
+		EXPECT_EQ(db->bankProcesses(), 1); //only the due account
+		EXPECT_EQ(due->balance, 100006); //paid 2 cents for each of the three days missed
+		EXPECT_EQ(fresh->balance, 100000); //untouched
+		EXPECT_EQ(db->bankProcesses(), 0); //nothing due right after a run
+		std::chrono::system_clock::time_point next;
+		EXPECT_TRUE(InterestScheduler::nextDue(due, next));
+		EXPECT_GT(next, std::chrono::system_clock::now()); //requeued for later
+	}
+
+	//changing an account's product requeues it at the new product's due date
+	TEST(InterestTest, ProductChangeReschedules) {
+		std::shared_ptr<Database> db(new Database());
+		std::shared_ptr<Transaction> t(new Deposit(USDollar(100000)));
+		std::shared_ptr<Account> a(new MoneyMarket(t, "mm0001"));
+		a->LastPayout = std::chrono::system_clock::now() - std::chrono::hours(24 * 3);
+		EXPECT_TRUE(db->addAccount(a));
+		EXPECT_EQ(db->Schedule->queued(), 0); //no interest, nothing to queue
+		a->setInterestType(9); //10% simple, paid daily
+		EXPECT_EQ(db->Schedule->queued(), 1);
+		EXPECT_EQ(db->bankProcesses(), 1);
+		EXPECT_EQ(a->balance, 100000 + 3 * getProduct(9).payoutCents); //three days missed
+		a->setInterestType(0);
+		std::chrono::system_clock::time_point next;
+		EXPECT_FALSE(db->Schedule->nextTime(next)); //the entry from product 9 is stale now
+	}
+
+	//an account that missed a stretch of runs catches every period up in one run
+	TEST(InterestTest, CatchUpAccrual) {
+		const InterestProduct& daily = getProduct(7); //2% compound daily
+		const InterestProduct& simple = getProduct(9); //10% simple
+		EXPECT_EQ(accrualCents(10000000, daily, 1), USDollar(10000000).GetPercentage(daily.periodRate).getValue()); //one period is unchanged
+		EXPECT_EQ(accrualCents(10000000, simple, 3), 3 * accrualCents(10000000, simple, 1));
+		EXPECT_EQ(accrualCents(10000000, daily, 90), 90 * accrualCents(10000000, daily, 1)); //accruals don't move the balance, so periods add up
+		EXPECT_EQ(accrualCents(10000000, getProduct(0), 90), 0);
+
+		std::chrono::system_clock::time_point behind = std::chrono::system_clock::now() - std::chrono::hours(24 * 90 + 1);
+		std::shared_ptr<Transaction> t(new Deposit(USDollar(10000000)));
+		std::shared_ptr<Transaction> t1(new Deposit(USDollar(10000000)));
+		std::shared_ptr<Account> serial(new Saving(t, "s0001"));
+		std::shared_ptr<Account> batch(new Saving(t1, "s0002"));
+		LinkedList<Account> accs(batch);
+		for (std::shared_ptr<Account> a : { serial, batch })
+		{
+			a->setInterestType(8); //certificate rate, doesn't pay out
+			a->LastInterest = behind;
+		}
+		USDollar before = serial->accruedInterest();
+		Interest::IndividualAccount(serial);
+		EXPECT_EQ(Interest::AllAccounts(accs), 1);
+		EXPECT_EQ(serial->accruedInterest() - before, USDollar((int)accrualCents(10000000, getProduct(8), 90)));
+		EXPECT_EQ(batch->accruedInterest(), serial->accruedInterest());
+		Interest::IndividualAccount(serial); //caught up, nothing more due
+		EXPECT_EQ(serial->accruedInterest(), batch->accruedInterest());
+	}
+
+	//catching up N periods in one run gives what N runs a period apart would, & the part period left over isn't lost
+	TEST(InterestTest, CatchUpMatchesEveryRun) {
+		std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
+		for (int product : { 3, 5, 7, 8, 9 })
+		{
+			const std::chrono::hours period(getProduct(product).accrualHours);
+			std::shared_ptr<Transaction> t(new Deposit(USDollar(12345678)));
+			std::shared_ptr<Transaction> t1(new Deposit(USDollar(12345678)));
+			std::shared_ptr<Account> stepped(new CertOfDep(t, "cd0001")); //certificates don't pay out, so only accruals move
+			std::shared_ptr<Account> caught(new CertOfDep(t1, "cd0002"));
+			for (std::shared_ptr<Account> a : { stepped, caught })
+			{
+				a->setInterestType(product);
+				a->LastInterest = start;
+			}
+			const int runs = 6;
+			for (int k = 1; k <= runs; k++)
+			{
+				InterestBatch batch;
+				batch.gather(stepped);
+				batch.compute(start + period * k + period / 2);
+				EXPECT_EQ(batch.scatter(start + period * k + period / 2), 1);
+			}
+			InterestBatch batch;
+			batch.gather(caught);
+			batch.compute(start + period * runs + period / 2);
+			EXPECT_EQ(batch.scatter(start + period * runs + period / 2), 1);
+			EXPECT_EQ(stepped->accruedInterest(), caught->accruedInterest());
+			EXPECT_EQ(stepped->LastInterest, start + period * runs);
+			EXPECT_EQ(caught->LastInterest, start + period * runs); //the half period left over counts toward the next
+		}
+
+		std::shared_ptr<Transaction> t(new Deposit(USDollar(12345678)));
+		std::shared_ptr<Account> single(new CertOfDep(t, "cd0003"));
+		single->setInterestType(8);
+		single->LastInterest = std::chrono::system_clock::now() - std::chrono::hours(24 * 90 + 12);
+		std::chrono::system_clock::time_point was = single->LastInterest;
+		Interest::IndividualAccount(single);
+		EXPECT_EQ(single->LastInterest, was + std::chrono::hours(24 * 90)); //same for an account run on its own
+	}
+
+	//a daily payout product that missed days pays every missed day in one catch-up, the same as a run each day would have
+	TEST(InterestTest, CatchUpPaysEveryMissedPayout) {
+		std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
+		const std::chrono::hours day(24);
+		const int payout = getProduct(9).payoutCents;
+		ASSERT_GT(payout, 0);
+		std::shared_ptr<Account> stepped(new Saving(std::shared_ptr<Transaction>(new Deposit(USDollar(100000))), "sv0001"));
+		std::shared_ptr<Account> caught(new Saving(std::shared_ptr<Transaction>(new Deposit(USDollar(100000))), "sv0002"));
+		for (std::shared_ptr<Account> a : { stepped, caught })
+		{
+			a->setInterestType(9); //paid daily
+			a->LastInterest = start;
+			a->LastPayout = start;
+		}
+		const int days = 6;
+		for (int k = 1; k <= days; k++)
+		{
+			InterestBatch batch;
+			batch.gather(stepped);
+			batch.compute(start + day * k + day / 2);
+			EXPECT_EQ(batch.scatter(start + day * k + day / 2), 1);
+		}
+		InterestBatch batch;
+		batch.gather(caught);
+		batch.compute(start + day * days + day / 2);
+		EXPECT_EQ(batch.scatter(start + day * days + day / 2), 1);
+		EXPECT_EQ(stepped->balance, USDollar(100000 + days * payout));
+		EXPECT_EQ(caught->balance, stepped->balance);
+		EXPECT_EQ(caught->LastPayout, start + day * days); //the half day left over counts toward the next
+		EXPECT_EQ(stepped->LastPayout, caught->LastPayout);
+
+		std::shared_ptr<Account> single(new Saving(std::shared_ptr<Transaction>(new Deposit(USDollar(100000))), "sv0003"));
+		single->setInterestType(9);
+		single->LastPayout = std::chrono::system_clock::now() - day * days - day / 2;
+		std::chrono::system_clock::time_point was = single->LastPayout;
+		Interest::IndividualAccount(single);
+		EXPECT_EQ(single->balance, USDollar(100000 + days * payout)); //same for an account run on its own
+		EXPECT_EQ(single->LastPayout, was + day * days);
+	}
+
+	//an account that moved between gather & scatter is worked out again from what it holds now, not written over
+	TEST(InterestTest, ScatterRechecks) {
+		std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+		std::shared_ptr<Transaction> t(new Deposit(USDollar(10000000)));
+		std::shared_ptr<Account> a(new Saving(t, "s0001"));
+		a->setInterestType(7); //2% compound daily, paid daily
+		a->LastInterest = now - std::chrono::hours(24 * 10 + 1);
+		a->LastPayout = now;
+		InterestBatch first;
+		InterestBatch second;
+		first.gather(a);
+		second.gather(a);
+		first.compute(now);
+		second.compute(now);
+		EXPECT_TRUE(a->deposit(100000.00)); //posted after both gathers
+		USDollar before = a->accruedInterest();
+		EXPECT_EQ(first.scatter(now), 1);
+		USDollar accrued = before + USDollar((int)accrualCents(20000000, getProduct(7), 10)); //on the balance it has now
+		EXPECT_EQ(a->accruedInterest(), accrued);
+		EXPECT_EQ(second.scatter(now), 0); //the first run already took those periods
+		EXPECT_EQ(a->accruedInterest(), accrued);
+	}
+
+	//a batch run's payouts & interest records all go to disk in one sync
+	TEST(InterestTest, BatchSharesOneSync) {
+		std::remove("BatchSync.dat");
+		std::shared_ptr<Database> db(new Database());
+		db->enableLog("BatchSync.dat");
+		std::chrono::system_clock::time_point longAgo = std::chrono::system_clock::now() - std::chrono::hours(24 * 3);
+		for (int i = 0; i < 8; i++)
+		{
+			std::shared_ptr<Transaction> t(new Deposit(USDollar(100000)));
+			std::shared_ptr<Account> a(new MoneyMarket(t, "mm" + std::to_string(i)));
+			a->setInterestType(9); //10% simple, paid daily
+			a->LastPayout = longAgo;
+			EXPECT_TRUE(db->addAccount(a));
+		}
+		std::uint64_t records = db->Log->records();
+		std::uint64_t syncs = db->Log->syncs();
+		EXPECT_EQ(db->bankProcesses(), 8);
+		EXPECT_EQ(db->Log->records() - records, 16u); //a payout & an interest record each
+		EXPECT_EQ(db->Log->syncs() - syncs, 1u);
+		EXPECT_EQ(db->findAccount("mm0")->balance, 100000 + 3 * getProduct(9).payoutCents); //three days missed
+	}
+
+	//a simulated clock runs a year of daily payouts without waiting
+	TEST(ClockTest, SimulatedYear) {
+		std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
+		std::shared_ptr<SimulatedClock> clock(new SimulatedClock(start));
+		std::shared_ptr<Database> db(new Database());
+		std::shared_ptr<Database> other(new Database());
+		db->setClock(clock);
+		std::shared_ptr<Transaction> t(new Deposit(USDollar(100000)));
+		std::shared_ptr<Account> a(new MoneyMarket(t, "mm0001"));
+		a->setInterestType(9); //10% simple, paid daily
+		EXPECT_TRUE(db->addAccount(a));
+		int payout = getProduct(9).payoutCents;
+		//"more than 24 hours" makes the first due at hour 25; payouts move on by whole days, so one is due every 24 hours after that
+		EXPECT_EQ(db->fastForward(*clock, std::chrono::hours(24 * 365)), 364);
+		EXPECT_EQ(a->balance, 100000 + payout * 364);
+		EXPECT_EQ(db->now(), start + std::chrono::hours(24 * 365));
+		EXPECT_EQ(a->now(), db->now()); //accounts read their bank's clock
+		EXPECT_EQ(a->Transactions.get(a->Transactions.getCount() - 1)->Timestamp, start + std::chrono::hours(24 * 364 + 1)); //newest posting is in simulated time
+		EXPECT_LT(std::chrono::system_clock::now() - start, std::chrono::hours(1));
+		EXPECT_LT(other->now() - std::chrono::system_clock::now(), std::chrono::seconds(1)); //other banks keep the real clock
+		db->setClock(nullptr);
+		EXPECT_LT(db->now() - std::chrono::system_clock::now(), std::chrono::seconds(1)); //real clock is back
+	}
+
+	//an overdraft is covered with exact amounts, one transfer per sibling drawn on
+	TEST(OverdraftTest, ExactCover) {
+		std::shared_ptr<Database> db(new Database());
+		std::shared_ptr<Customer> c(new Customer("od", "pass"));
+		EXPECT_TRUE(db->addCustomer(c));
+		std::shared_ptr<Transaction> t(new Deposit(USDollar(1000)));
+		std::shared_ptr<Transaction> t1(new Deposit(USDollar(1500)));
+		std::shared_ptr<Transaction> t2(new Deposit(USDollar(10000)));
+		std::shared_ptr<Account> checking(new Checking(t, "c0001"));
+		std::shared_ptr<Account> saving(new Saving(t1, "s0001"));
+		std::shared_ptr<Account> mm(new MoneyMarket(t2, "mm0001"));
+		EXPECT_TRUE(db->addAccount(checking, c));
+		EXPECT_TRUE(db->addAccount(saving, c));
+		EXPECT_TRUE(db->addAccount(mm, c));
+		EXPECT_TRUE(checking->purchase(40.00, "Store", "Town")); //$30 short
+
+		std::vector<Overdraft::Cover> covers = Overdraft::plan({ checking, saving, mm });
+		ASSERT_EQ(covers.size(), 2u);
+		EXPECT_EQ(covers[0].from, saving);
+		EXPECT_EQ(covers[0].cents, 1500); //all the savings has
+		EXPECT_EQ(covers[1].from, mm);
+		EXPECT_EQ(covers[1].cents, 1500); //just the rest
+
+		EXPECT_TRUE(Overdraft::OnPurchase("od", db));
+		EXPECT_EQ(checking->balance, 0);
+		EXPECT_EQ(saving->balance, 0);
+		EXPECT_EQ(mm->balance, 8500);
+		EXPECT_EQ(saving->transactionCount(), 2); //one transfer out, not a string of small ones
+		EXPECT_EQ(mm->transactionCount(), 2);
+	}
+
+	//overdraft only runs when a purchase leaves the account negative
+	TEST(OverdraftTest, OnlyWhenOverdrawn) {
+		std::shared_ptr<Database> db(new Database());
+		std::shared_ptr<Customer> c(new Customer("od2", "pass"));
+		EXPECT_TRUE(db->addCustomer(c));
+		std::shared_ptr<Transaction> t(new Deposit(USDollar(1000)));
+		std::shared_ptr<Transaction> t1(new Deposit(USDollar(10000)));
+		std::shared_ptr<Account> checking(new Checking(t, "c0002"));
+		std::shared_ptr<Account> saving(new Saving(t1, "s0002"));
+		EXPECT_TRUE(db->addAccount(checking, c));
+		EXPECT_TRUE(db->addAccount(saving, c));
+		EXPECT_TRUE(db->purchase("c0002", "od2", 5.00, db)); //still positive
+		EXPECT_EQ(saving->transactionCount(), 1); //nothing drawn
+		EXPECT_TRUE(db->purchase("c0002", "od2", 7.50, db)); //$2.50 short
+		EXPECT_EQ(checking->balance, 0);
+		EXPECT_EQ(saving->balance, 9750);
+		EXPECT_FALSE(db->purchase("c0002", "nobody", 100.00, db)); //unknown user, no purchase & no overdraft
+		EXPECT_EQ(saving->transactionCount(), 2);
+	}
+
+	//an account already short doesn't draw on its siblings again with every purchase, only when it goes negative
+	TEST(OverdraftTest, OnlyOnTheEdge) {
+		std::shared_ptr<Database> db(new Database());
+		std::shared_ptr<Customer> c(new Customer("od3", "pass"));
+		EXPECT_TRUE(db->addCustomer(c));
+		std::shared_ptr<Transaction> t(new Deposit(USDollar(1000)));
+		std::shared_ptr<Transaction> t1(new Deposit(USDollar(100)));
+		std::shared_ptr<Account> checking(new Checking(t, "c0003"));
+		std::shared_ptr<Account> saving(new Saving(t1, "s0003"));
+		EXPECT_TRUE(db->addAccount(checking, c));
+		EXPECT_TRUE(db->addAccount(saving, c));
+		EXPECT_TRUE(db->purchase("c0003", "od3", 15.00, db)); //$5 short, savings covers $1 of it
+		EXPECT_EQ(checking->balance, -400);
+		EXPECT_EQ(saving->balance, 0);
+
+		EXPECT_TRUE(saving->deposit(50.00));
+		EXPECT_TRUE(db->purchase("c0003", "od3", 1.00, db)); //already negative
+		PurchaseRow row;
+		row.account = "c0003";
+		row.user = "od3";
+		row.val = 1.00;
+		EXPECT_EQ(db->purchaseBatch({ row }, db), 1);
+		EXPECT_EQ(checking->balance, -600);
+		EXPECT_EQ(saving->balance, 5000); //nothing drawn after the first time
+	}
+
+	//a database rebuilt from its log matches the one that wrote it
+	TEST(WalTest, ReplayRebuilds) {
+		std::remove("WalReplay.dat");
+		{
+			std::shared_ptr<Database> db(new Database());
+			EXPECT_EQ(db->enableLog("WalReplay.dat"), 0); //nothing to replay yet
+			std::shared_ptr<Customer> c(new Customer("wal", "pass"));
+			EXPECT_TRUE(db->addCustomer(c));
+			std::shared_ptr<Transaction> t(new Deposit(USDollar(10000)));
+			std::shared_ptr<Transaction> t1(new Deposit(USDollar(5000)));
+			std::shared_ptr<Account> saving(new Saving(t, "s0001"));
+			std::shared_ptr<Account> checking(new Checking(t1, "c0001"));
+			saving->setInterestType(9);
+			EXPECT_TRUE(db->addAccount(saving, c));
+			EXPECT_TRUE(db->addAccount(checking, c));
+			EXPECT_TRUE(c->transfer(db, "s0001", "c0001", 12.34));
+			EXPECT_TRUE(db->purchase("c0001", "wal", 99.99, db, "Store", "Town")); //overdraws & pulls from savings
+			saving->LastInterest = db->now() - std::chrono::hours(24 * 400);
+			Interest::IndividualAccount(saving);
+			EXPECT_EQ(db->Log->syncs(), db->Log->records()); //one writer at a time, nothing to group
+		}
+		std::shared_ptr<Database> db(new Database());
+		EXPECT_GT(db->enableLog("WalReplay.dat"), 0);
+		std::shared_ptr<Account> saving = db->findAccount("s0001");
+		std::shared_ptr<Account> checking = db->findAccount("c0001");
+		ASSERT_TRUE(saving && checking);
+		EXPECT_TRUE(db->owns(db->findCustomer("wal"), "s0001"));
+		EXPECT_EQ(checking->balance, 0);
+		EXPECT_EQ(saving->balance, 10000 + 5000 - 9999);
+		EXPECT_EQ(saving->product().id, 9);
+		EXPECT_GT(saving->accruedInterest(), 1);
+		EXPECT_EQ(saving->transactionCount(), 3);
+		EXPECT_EQ(checking->transactionCount(), 4);
+	}
+
+	//replay keeps every whole record & stops at a torn one
+	TEST(WalTest, TornTail) {
+		std::remove("WalTorn.dat");
+		{
+			std::shared_ptr<Database> db(new Database());
+			db->enableLog("WalTorn.dat");
+			EXPECT_TRUE(db->addCustomer(std::shared_ptr<Customer>(new Customer("torn", "pass"))));
+			std::shared_ptr<Transaction> t(new Deposit(USDollar(100)));
+			EXPECT_TRUE(db->addAccount(std::shared_ptr<Account>(new Saving(t, "s0001"))));
+		}
+		{
+			std::ofstream out("WalTorn.dat", std::ios::binary | std::ios::app);
+			out.write("\x40\x00\x00\x00\x01\x02", 6); //a record that never finished writing
+		}
+		std::shared_ptr<Database> db(new Database());
+		EXPECT_EQ(db->enableLog("WalTorn.dat"), 2);
+		EXPECT_TRUE(db->findCustomer("torn"));
+		EXPECT_TRUE(db->findAccount("s0001"));
+	}
+
+	//an intact record that can't be applied isn't a torn tail; the log is kept whole & not attached
+	TEST(WalTest, UnappliedRecordKeepsLog) {
+		std::remove("WalBad.dat");
+		{
+			WriteAheadLog log("WalBad.dat");
+			Customer first("first", "pass");
+			Customer after("after", "pass");
+			log.append(WriteAheadLog::customerRecord(first));
+			log.append(std::string(1, '\x7f')); //no such kind
+			log.append(WriteAheadLog::customerRecord(after));
+		}
+		std::uintmax_t size = std::filesystem::file_size("WalBad.dat");
+		std::shared_ptr<Database> db(new Database());
+		EXPECT_EQ(db->enableLog("WalBad.dat"), -1);
+		EXPECT_FALSE(db->Log);
+		EXPECT_TRUE(db->findCustomer("first"));
+		EXPECT_FALSE(db->findCustomer("after"));
+		EXPECT_EQ(std::filesystem::file_size("WalBad.dat"), size); //the record after it is still there
+	}
+
+	//password changes are logged, so a restart doesn't put the old password back
+	TEST(WalTest, PasswordChange) {
+		std::remove("WalPass.dat");
+		{
+			std::shared_ptr<Database> db(new Database());
+			db->enableLog("WalPass.dat");
+			EXPECT_TRUE(db->addCustomer(std::shared_ptr<Customer>(new Customer("pw", "old"))));
+			EXPECT_TRUE(db->addEmployee(std::shared_ptr<Employee>(new Employee("pwteller", "old"))));
+			EXPECT_TRUE(db->setPassword("pw", "new", ROLE_CUSTOMER));
+			EXPECT_FALSE(db->setPassword("pw", "new", ROLE_CUSTOMER)); //same again
+			EXPECT_FALSE(db->setPassword("pwteller", "other", ROLE_CUSTOMER)); //not a customer
+			EXPECT_TRUE(db->setPassword("pwteller", "new2", ROLE_EMPLOYEE));
+			EXPECT_FALSE(db->setPassword("nobody", "x"));
+			EXPECT_EQ(db->Log->records(), 4u);
+		}
+		std::shared_ptr<Database> db(new Database());
+		EXPECT_EQ(db->enableLog("WalPass.dat"), 4);
+		EXPECT_EQ(db->findCustomer("pw")->password, "new");
+		EXPECT_EQ(db->findEmployee("pwteller")->password, "new2");
+	}
+
+	//strings of any length survive the log, including ones past what a two-byte length can say
+	TEST(WalTest, LongStrings) {
+		std::remove("WalLong.dat");
+		std::string name(70000, 'n');
+		std::string edge(65535, 'e');
+		{
+			std::shared_ptr<Database> db(new Database());
+			db->enableLog("WalLong.dat");
+			EXPECT_TRUE(db->addCustomer(std::shared_ptr<Customer>(new Customer("long", name))));
+			EXPECT_TRUE(db->addCustomer(std::shared_ptr<Customer>(new Customer("edge", edge))));
+			EXPECT_TRUE(db->addCustomer(std::shared_ptr<Customer>(new Customer("short", "pw"))));
+		}
+		std::shared_ptr<Database> db(new Database());
+		EXPECT_EQ(db->enableLog("WalLong.dat"), 3);
+		EXPECT_EQ(db->findCustomer("long")->password, name);
+		EXPECT_EQ(db->findCustomer("edge")->password, edge);
+		EXPECT_EQ(db->findCustomer("short")->password, "pw");
+	}
+
+	//a batch run's payouts & interest states reach the log before the accounts change, & replay gives the same accounts back
+	TEST(WalTest, BatchInterestLoggedFirst) {
+		std::remove("WalBatch.dat");
+		std::shared_ptr<SimulatedClock> clock(new SimulatedClock());
+		std::shared_ptr<Database> db(new Database());
+		db->setClock(clock);
+		db->enableLog("WalBatch.dat");
+		for (int i = 0; i < 4; i++)
+		{
+			std::shared_ptr<Account> a(new Saving(std::shared_ptr<Transaction>(new Deposit(USDollar(1000000 + i))), "wb000" + std::to_string(i)));
+			a->setInterestType(9); //paid daily
+			EXPECT_TRUE(db->addAccount(a));
+		}
+		clock->advance(std::chrono::hours(25));
+		std::uint64_t before = db->Log->records();
+		EXPECT_EQ(db->bankProcesses(), 4);
+		EXPECT_EQ(db->Log->records(), before + 8); //a payout & an interest state each
+
+		std::shared_ptr<Database> replayed(new Database());
+		EXPECT_EQ(replayed->enableLog("WalBatch.dat"), (int)db->Log->records());
+		for (int i = 0; i < 4; i++)
+		{
+			std::shared_ptr<Account> a = db->findAccount("wb000" + std::to_string(i));
+			std::shared_ptr<Account> b = replayed->findAccount("wb000" + std::to_string(i));
+			ASSERT_TRUE(b);
+			EXPECT_EQ(a->InterestInFlight, 0u);
+			EXPECT_GT(a->balance, USDollar(1000000 + i));
+			EXPECT_EQ(b->balance, a->balance);
+			EXPECT_EQ(b->accruedInterest(), a->accruedInterest());
+			EXPECT_EQ(b->LastInterest, a->LastInterest);
+			EXPECT_EQ(b->LastPayout, a->LastPayout);
+		}
+	}
+
+	//records queued together go to disk in one sync
+	TEST(WalTest, GroupCommit) {
+		std::remove("WalGroup.dat");
+		WriteAheadLog log("WalGroup.dat");
+		std::uint64_t last = 0;
+		for (int i = 0; i < 10; i++) last = log.enqueue(WriteAheadLog::customerRecord(*std::shared_ptr<Customer>(new Customer("g" + std::to_string(i), "pass"))));
+		log.waitDurable(last);
+		EXPECT_EQ(log.records(), 10u);
+		EXPECT_EQ(log.syncs(), 1u);
+		log.append(WriteAheadLog::customerRecord(*std::shared_ptr<Customer>(new Customer("g10", "pass"))));
+		EXPECT_EQ(log.syncs(), 2u);
+	}
+
+	//a bank loaded from its snapshot matches the one that wrote it, & the log only adds what came after
+	TEST(SnapshotTest, RoundTrip) {
+		std::remove("SnapLog.dat");
+		std::remove("SnapArchive.dat");
+		std::remove("Snap.dat");
+		{
+			std::shared_ptr<Database> db(new Database("SnapArchive.dat", 2));
+			db->enableLog("SnapLog.dat");
+			std::shared_ptr<Customer> c(new Customer("snap", "pass"));
+			EXPECT_TRUE(db->addCustomer(c));
+			EXPECT_TRUE(db->addEmployee(std::shared_ptr<Employee>(new Employee("teller", "secret"))));
+			std::shared_ptr<Transaction> t(new Deposit(USDollar(100000)));
+			std::shared_ptr<Transaction> t1(new Deposit(USDollar(5000)));
+			std::shared_ptr<Account> saving(new Saving(t, "s0001"));
+			std::shared_ptr<Account> checking(new Checking(t1, "c0001"));
+			saving->setInterestType(9);
+			EXPECT_TRUE(db->addAccount(saving, c));
+			EXPECT_TRUE(db->addAccount(checking, c));
+			EXPECT_TRUE(db->saveSnapshot("Snap.dat"));
+			for (int i = 0; i < 6; i++) EXPECT_TRUE(c->transfer(db, "s0001", "c0001", 10.00)); //enough to spill to the archive
+			EXPECT_TRUE(db->saveSnapshot("Snap.dat")); //replaces the first one in place
+			EXPECT_FALSE(std::ifstream("Snap.dat.tmp").good());
+			EXPECT_TRUE(db->purchase("c0001", "snap", 25.00, db)); //after the snapshot, only in the log
+		}
+		std::shared_ptr<Database> db(new Database());
+		EXPECT_EQ(db->loadSnapshot("Snap.dat"), 2);
+		std::shared_ptr<Account> saving = db->findAccount("s0001");
+		std::shared_ptr<Account> checking = db->findAccount("c0001");
+		ASSERT_TRUE(saving && checking);
+		EXPECT_TRUE(db->owns(db->findCustomer("snap"), "c0001"));
+		EXPECT_TRUE(db->findEmployee("teller"));
+		EXPECT_EQ(saving->product().id, 9);
+		EXPECT_GT(saving->ArchivedSegments.size(), 0u);
+		EXPECT_EQ(saving->transactionCount(), 7);
+		EXPECT_EQ(checking->balance, 11000);
+		db->enableLog("SnapLog.dat");
+		EXPECT_EQ(saving->balance, 94000); //transfers weren't applied twice
+		EXPECT_EQ(checking->balance, 8500);
+		EXPECT_EQ(checking->transactionCount(), 8);
+		EXPECT_EQ(db->loadSnapshot("Missing.dat"), -1);
+	}
+
+	//a snapshot checkpoints the log: what it has is dropped from the log, & replay after it only reads what came later
+	TEST(SnapshotTest, CheckpointsLog) {
+		std::remove("CkptLog.dat");
+		std::remove("CkptLogFull.dat");
+		std::remove("Ckpt.dat");
+		std::uint64_t checkpoint = 0;
+		{
+			std::shared_ptr<Database> db(new Database());
+			db->enableLog("CkptLog.dat");
+			std::shared_ptr<Customer> c(new Customer("ckpt", "pass"));
+			EXPECT_TRUE(db->addCustomer(c));
+			std::shared_ptr<Transaction> t(new Deposit(USDollar(100000)));
+			std::shared_ptr<Transaction> t1(new Deposit(USDollar(5000)));
+			EXPECT_TRUE(db->addAccount(std::shared_ptr<Account>(new Saving(t, "s0001")), c));
+			EXPECT_TRUE(db->addAccount(std::shared_ptr<Account>(new Checking(t1, "c0001")), c));
+			for (int i = 0; i < 20; i++) EXPECT_TRUE(c->transfer(db, "s0001", "c0001", 1.00));
+			std::uintmax_t before = std::filesystem::file_size("CkptLog.dat");
+			std::filesystem::copy_file("CkptLog.dat", "CkptLogFull.dat"); //as if the rotation never happened
+			checkpoint = db->Log->records();
+			EXPECT_TRUE(db->saveSnapshot("Ckpt.dat"));
+			EXPECT_LT(std::filesystem::file_size("CkptLog.dat"), before / 10); //just the header left
+			EXPECT_TRUE(c->transfer(db, "s0001", "c0001", 5.00)); //after the snapshot, only in the log
+			EXPECT_EQ(db->Log->records(), checkpoint + 1); //numbering carries on
+		}
+		{
+			std::shared_ptr<Database> db(new Database());
+			EXPECT_EQ(db->loadSnapshot("Ckpt.dat"), 2);
+			EXPECT_EQ(db->enableLog("CkptLog.dat"), 1); //only the transfer after the snapshot
+			EXPECT_EQ(db->findAccount("s0001")->balance, 97500);
+			EXPECT_EQ(db->findAccount("c0001")->balance, 7500);
+			EXPECT_TRUE(db->findCustomer("ckpt")->transfer(db, "s0001", "c0001", 5.00));
+		}
+		{
+			std::shared_ptr<Database> db(new Database());
+			EXPECT_EQ(db->loadSnapshot("Ckpt.dat"), 2);
+			EXPECT_EQ(db->enableLog("CkptLog.dat"), 2); //one more, numbered after the first
+			EXPECT_EQ(db->findAccount("s0001")->balance, 97000);
+			EXPECT_EQ(db->findAccount("c0001")->balance, 8000);
+		}
+		//crashed after the snapshot but before the rotation: the whole log is there & everything the snapshot has is skipped
+		std::shared_ptr<Database> db(new Database());
+		EXPECT_EQ(db->loadSnapshot("Ckpt.dat"), 2);
+		EXPECT_EQ(db->enableLog("CkptLogFull.dat"), 0);
+		EXPECT_EQ(db->findAccount("s0001")->balance, 98000);
+		EXPECT_EQ(db->Log->records(), checkpoint);
+	}
+
+	//customers & accounts spread over shards by hash, & transfers work between accounts in different shards
+	TEST(ShardTest, CrossShardTransfer) {
+		std::shared_ptr<Database> db(new Database(4));
+		std::shared_ptr<Customer> c(new Customer("sharded", "pass"));
+		EXPECT_TRUE(db->addCustomer(c));
+		EXPECT_FALSE(db->addCustomer(std::shared_ptr<Customer>(new Customer("sharded", "again"))));
+		std::string first = "x0";
+		std::string other = "";
+		for (int i = 0; i < 8; i++)
+		{
+			std::string id = "x" + std::to_string(i);
+			std::shared_ptr<Transaction> t(new Deposit(USDollar(10000)));
+			EXPECT_TRUE(db->addAccount(std::shared_ptr<Account>(new Checking(t, id)), c));
+			if (other.empty() && &db->shardFor(id) != &db->shardFor(first)) other = id;
+		}
+		ASSERT_FALSE(other.empty()); //8 IDs over 4 shards can't all land in one
+		EXPECT_EQ(db->accountCount(), 8);
+		EXPECT_EQ(db->accountIDs(c).size(), 8u);
+		EXPECT_EQ(db->findCustomer("sharded"), c);
+		EXPECT_TRUE(db->owns(c, other));
+		EXPECT_TRUE(c->transfer(db, first, other, 25.00));
+		EXPECT_EQ(db->findAccount(first)->balance, 7500);
+		EXPECT_EQ(db->findAccount(other)->balance, 12500);
+		int total = 0;
+		db->forEachAccount([&](std::shared_ptr<Account> a)
+		{
+			total += a->balance.getValue();
+			return true;
+		});
+		EXPECT_EQ(total, 80000); //nothing created or lost
+	}
+
+	//the reverse index answers who owns an account, & joint ownership survives a replay
+	TEST(OwnerIndexTest, JointAccount) {
+		std::remove("OwnerLog.dat");
+		{
+			std::shared_ptr<Database> db(new Database());
+			db->enableLog("OwnerLog.dat");
+			std::shared_ptr<Customer> a(new Customer("ann", "pass"));
+			std::shared_ptr<Customer> b(new Customer("bob", "pass"));
+			EXPECT_TRUE(db->addCustomer(a));
+			EXPECT_TRUE(db->addCustomer(b));
+			std::shared_ptr<Transaction> t(new Deposit(USDollar(10000)));
+			EXPECT_TRUE(db->addAccount(std::shared_ptr<Account>(new Checking(t, "j0001")), a));
+			EXPECT_FALSE(db->isJoint("j0001"));
+			EXPECT_FALSE(db->owns(b, "j0001"));
+			EXPECT_TRUE(db->addOwner("j0001", b));
+			EXPECT_FALSE(db->addOwner("j0001", b)); //already an owner
+			EXPECT_FALSE(db->addOwner("nope", b)); //no such account
+			EXPECT_TRUE(db->owns(b, "j0001"));
+			EXPECT_TRUE(b->transfer(db, "j0001", "j0001", 1.00));
+		}
+		std::shared_ptr<Database> db(new Database());
+		db->enableLog("OwnerLog.dat");
+		std::vector<std::string> names = db->owners("j0001");
+		ASSERT_EQ(names.size(), 2u);
+		EXPECT_EQ(names[0], "ann");
+		EXPECT_EQ(names[1], "bob");
+		EXPECT_TRUE(db->isJoint("j0001"));
+		EXPECT_EQ(db->accountIDs(db->findCustomer("bob")).size(), 1u);
+		EXPECT_TRUE(db->owners("missing").empty());
+	}
+
+	//secondary indices follow accounts as their product changes & their balance crosses zero
+	TEST(IndexTest, TypeProductOverdrawn) {
+		std::shared_ptr<Database> db(new Database(4));
+		for (int i = 0; i < 12; i++)
+		{
+			std::shared_ptr<Transaction> t(new Deposit(USDollar(1000)));
+			std::shared_ptr<Account> a;
+			if (i % 3 == 0) a = std::shared_ptr<Account>(new MoneyMarket(t, "m" + std::to_string(i)));
+			else a = std::shared_ptr<Account>(new Checking(t, "k" + std::to_string(i)));
+			a->setInterestType(6);
+			EXPECT_TRUE(db->addAccount(a));
+		}
+		EXPECT_EQ(db->findAccounts(ACCOUNT_MONEYMARKET).size(), 4u);
+		EXPECT_EQ(db->findAccounts(ACCOUNT_CHECKING).size(), 8u);
+		EXPECT_EQ(db->findAccounts(-1, 6).size(), 12u);
+		EXPECT_TRUE(db->findAccounts(-1, -1, true).empty());
+
+		db->findAccount("m3")->setInterestType(8);
+		EXPECT_EQ(db->findAccounts(ACCOUNT_MONEYMARKET, 8).size(), 1u);
+		EXPECT_EQ(db->findAccounts(-1, 6).size(), 11u);
+
+		EXPECT_TRUE(db->findAccount("m6")->purchase(25.00, "Store", "Town"));
+		EXPECT_TRUE(db->findAccount("k1")->purchase(25.00, "Store", "Town"));
+		std::vector<std::shared_ptr<Account>> over = db->findAccounts(ACCOUNT_MONEYMARKET, -1, true);
+		ASSERT_EQ(over.size(), 1u);
+		EXPECT_EQ(over[0]->ID, "m6");
+		EXPECT_EQ(db->findAccounts(-1, -1, true).size(), 2u);
+		db->findAccount("m6")->deposit(50.00);
+		EXPECT_TRUE(db->findAccounts(ACCOUNT_MONEYMARKET, -1, true).empty());
+		EXPECT_EQ(db->findAccounts(-1).size(), 12u);
+	}
+
+	//the index doesn't keep its accounts alive; they hold it, so it only looks them up
+	TEST(IndexTest, DoesNotOwnAccounts) {
+		std::shared_ptr<SecondaryIndex> index(new SecondaryIndex());
+		std::shared_ptr<Account> a(new Checking(std::shared_ptr<Transaction>(new Deposit(USDollar(1000))), "k0001"));
+		a->Indices = index;
+		index->add(a);
+		EXPECT_EQ(index->find(ACCOUNT_CHECKING, -1, false).size(), 1u);
+		std::weak_ptr<Account> gone = a;
+		a.reset();
+		EXPECT_TRUE(gone.expired());
+		EXPECT_TRUE(index->find(ACCOUNT_CHECKING, -1, false).empty());
+		EXPECT_TRUE(index->find(-1, -1, false).empty());
+	}
+
+	//a pinned view keeps seeing the bank as it was, never half a transfer, & old versions go once it's released
+	TEST(MvccTest, ConsistentView) {
+		std::shared_ptr<Database> db(new Database());
+		std::shared_ptr<Employee> e = db->findEmployee("Admin");
+		for (int i = 0; i < 8; i++)
+		{
+			std::shared_ptr<Transaction> t(new Deposit(USDollar(100000)));
+			EXPECT_TRUE(db->addAccount(std::shared_ptr<Account>(new Checking(t, "v" + std::to_string(i)))));
+		}
+		auto total = [&](std::shared_ptr<ReadView> view)
+		{
+			int sum = 0;
+			db->forEachAccount([&](std::shared_ptr<Account> a)
+			{
+				std::shared_ptr<const AccountVersion> v = view->at(*a);
+				if (v) sum += v->balance;
+				return true;
+			});
+			return sum;
+		};
+
+		std::shared_ptr<ReadView> before = db->readView();
+		std::atomic<bool> done(false);
+		std::thread writer([&]()
+		{
+			for (int i = 0; i < 2000; i++) e->transfer(db, "v" + std::to_string(i % 8), "v" + std::to_string((i + 3) % 8), 1.00);
+			done = true;
+		});
+		bool alwaysWhole = true;
+		while (!done)
+		{
+			if (total(db->readView()) != 800000) alwaysWhole = false;
+		}
+		writer.join();
+		EXPECT_TRUE(alwaysWhole); //no view ever caught a transfer half done
+		EXPECT_EQ(before->at(*db->findAccount("v0"))->balance, 100000); //the old view still sees the start
+		EXPECT_EQ(total(before), 800000);
+		EXPECT_EQ(before->at(*db->findAccount("v0"))->transactions, 1);
+		EXPECT_EQ(db->readView()->at(*db->findAccount("v0"))->transactions, db->findAccount("v0")->transactionCount());
+		EXPECT_GT(VersionStore::retained(*db->findAccount("v0")), 1);
+
+		before.reset(); //nothing pinned now, the next commit drops the history
+		std::shared_ptr<Account> v0 = db->findAccount("v0");
+		EXPECT_TRUE(v0->deposit(1.00));
+		EXPECT_EQ(VersionStore::retained(*v0), 1);
+
+		std::shared_ptr<ReadView> view = db->readView();
+		std::shared_ptr<Transaction> t(new Deposit(USDollar(100)));
+		EXPECT_TRUE(db->addAccount(std::shared_ptr<Account>(new Checking(t, "v8"))));
+		EXPECT_FALSE(view->at(*db->findAccount("v8"))); //opened after the view
+	}
+
+	//writers on different accounts publish without a shared lock, & views still never see half a transfer or a view change under them
+	TEST(MvccTest, ConcurrentWriters) {
+		std::shared_ptr<Database> db(new Database());
+		std::shared_ptr<Employee> e = db->findEmployee("Admin");
+		for (int i = 0; i < 8; i++)
+		{
+			std::shared_ptr<Transaction> t(new Deposit(USDollar(100000)));
+			EXPECT_TRUE(db->addAccount(std::shared_ptr<Account>(new Checking(t, "w" + std::to_string(i)))));
+		}
+		std::uint64_t start = db->Versions->current();
+		std::atomic<int> running(4);
+		std::vector<std::thread> writers;
+		for (int w = 0; w < 4; w++)
+		{
+			writers.push_back(std::thread([&, w]()
+			{
+				for (int i = 0; i < 500; i++) e->transfer(db, "w" + std::to_string((i + w) % 8), "w" + std::to_string((i + w + 1 + w % 3) % 8), 1.00);
+				running--;
+			}));
+		}
+		bool alwaysWhole = true;
+		bool stable = true;
+		while (running > 0)
+		{
+			std::shared_ptr<ReadView> view = db->readView();
+			int first = 0;
+			int second = 0;
+			db->forEachAccount([&](std::shared_ptr<Account> a)
+			{
+				std::shared_ptr<const AccountVersion> v = view->at(*a);
+				if (v) first += v->balance;
+				return true;
+			});
+			db->forEachAccount([&](std::shared_ptr<Account> a)
+			{
+				std::shared_ptr<const AccountVersion> v = view->at(*a);
+				if (v) second += v->balance;
+				return true;
+			});
+			if (first != 800000) alwaysWhole = false;
+			if (first != second) stable = false;
+		}
+		for (std::thread& t : writers) t.join();
+		EXPECT_TRUE(alwaysWhole);
+		EXPECT_TRUE(stable); //the same view reads the same bank twice
+		EXPECT_EQ(db->Versions->current(), start + 2000); //one version per transfer, none lost
+	}
+
+	//the transfer primitive moves both legs together & keeps the incremental balances equal to a full recount
+	TEST(TransferTest, AtomicPrimitive) {
+		std::shared_ptr<Database> db(new Database());
+		std::shared_ptr<Transaction> t(new Deposit(USDollar(10000)));
+		std::shared_ptr<Transaction> t1(new Deposit(USDollar(10000)));
+		std::shared_ptr<Account> a(new Saving(t, "p0001"));
+		std::shared_ptr<Account> b(new Checking(t1, "p0002"));
+		EXPECT_TRUE(db->addAccount(a));
+		EXPECT_TRUE(db->addAccount(b));
+		EXPECT_TRUE(db->transfer("p0001", "p0002", 12.34));
+		EXPECT_TRUE(db->transfer("p0002", "p0001", 200.00)); //may overdraw, like the two-step transfer did
+		EXPECT_FALSE(db->transfer("p0001", "p0002", 0));
+		EXPECT_FALSE(db->transfer("p0001", "p0002", -5.00));
+		EXPECT_FALSE(db->transfer("p0001", "nope", 1.00));
+		EXPECT_EQ(a->transactionCount(), 3);
+		EXPECT_EQ(b->transactionCount(), 3);
+		EXPECT_EQ(a->balance, 10000 - 1234 + 20000);
+		EXPECT_EQ(b->balance, 10000 + 1234 - 20000);
+		a->updateBalance();
+		b->updateBalance();
+		EXPECT_EQ(a->balance, 28766); //a full recount agrees with the running balance
+		EXPECT_EQ(b->balance, -8766);
+	}
+
+	//a settlement posts every row a customer is entitled to, & overdraft runs once per customer afterwards
+	TEST(PurchaseBatchTest, Settlement) {
+		std::shared_ptr<Database> db(new Database());
+		std::shared_ptr<Customer> c(new Customer("card", "pass"));
+		std::shared_ptr<Customer> other(new Customer("other", "pass"));
+		EXPECT_TRUE(db->addCustomer(c));
+		EXPECT_TRUE(db->addCustomer(other));
+		std::shared_ptr<Transaction> t(new Deposit(USDollar(10000)));
+		std::shared_ptr<Transaction> t1(new Deposit(USDollar(50000)));
+		std::shared_ptr<Account> checking(new Checking(t, "b0001"));
+		std::shared_ptr<Account> saving(new Saving(t1, "b0002"));
+		EXPECT_TRUE(db->addAccount(checking, c));
+		EXPECT_TRUE(db->addAccount(saving, c));
+
+		std::vector<PurchaseRow> rows;
+		for (int i = 0; i < 30; i++) rows.push_back(PurchaseRow{ "b0001", "card", 5.00, "Store", "Town" });
+		rows.push_back(PurchaseRow{ "b0001", "other", 5.00 }); //not theirs
+		rows.push_back(PurchaseRow{ "nope", "card", 5.00 }); //no such account
+		rows.push_back(PurchaseRow{ "b0002", "card", 0 }); //nothing to post
+		rows.push_back(PurchaseRow{ "b0002", "card", 1.00 });
+		EXPECT_EQ(db->purchaseBatch(rows, db), 31);
+		EXPECT_EQ(checking->transactionCount(), 1 + 30 + 1); //the rows, then one covering transfer
+		EXPECT_EQ(checking->balance, 0); //150 spent on 100, covered from savings
+		EXPECT_EQ(saving->balance, 50000 - 100 - 5000);
+		checking->updateBalance();
+		EXPECT_EQ(checking->balance, 0);
+	}
+
+	TEST(BulkLoadTest, CsvAndFixedWidth) {
+		Database db(4);
+		std::shared_ptr<ThreadPool> pool(new ThreadPool(3));
+		BulkLoader loader(db, pool);
+		std::string text =
+			"C,bulk,pass\n"
+			"C,bulk,again\n" //duplicate
+			"A,m0001,bulk,1,0,100.00\n"
+			"A,m0002,bulk,0,2,25.5\n"
+			"A,m0001,bulk,1,0,1.00\n" //duplicate
+			"A,m0003,nobody,0,0,1.00\n" //unknown owner
+			"A,m0004,bulk,4,0,1.00\n" //unknown type
+			"A,m0005,bulk,256,0,1.00\n" //not a type code, not savings
+			"T,m0001,P,-10.25,Store,Town,1600000000\n"
+			"T,m0001,D,5,Deposit,ATM\n"
+			"T,m0002,T,-0.50,m0001,Bank\n"
+			"T,m0009,P,-1,Store,Town\n" //unknown account
+			"T,m0001,X,1,Bad,Kind\n" //unknown kind
+			"garbage\r\n";
+		BulkLoadResult r = loader.loadText(text);
+		EXPECT_EQ(r.customers, 1);
+		EXPECT_EQ(r.accounts, 2);
+		EXPECT_EQ(r.transactions, 3);
+		EXPECT_EQ(r.rejected, 8);
+		EXPECT_FALSE(db.findAccount("m0004"));
+		EXPECT_FALSE(db.findAccount("m0005"));
+		std::shared_ptr<Customer> c = db.findCustomer("bulk");
+		ASSERT_TRUE(c);
+		EXPECT_TRUE(db.owns(c, "m0001"));
+		EXPECT_TRUE(db.owns(c, "m0002"));
+		std::shared_ptr<Account> a = db.findAccount("m0001");
+		ASSERT_TRUE(a);
+		EXPECT_EQ(a->getType(), "Checking");
+		EXPECT_EQ(a->transactionCount(), 3);
+		EXPECT_EQ(a->balance, 10000 - 1025 + 500);
+		a->updateBalance();
+		EXPECT_EQ(a->balance, 10000 - 1025 + 500);
+		EXPECT_EQ(db.findAccounts(ACCOUNT_SAVING, 2).size(), 1u);
+
+		//same records in fixed-width columns
+		BulkLayout fixed;
+		fixed.widths = { 1, 8, 8, 8, 8, 8, 10 };
+		std::string columns =
+			"Cfixed   pass    \n"
+			"Af0001   fixed   1       0       50      \n"
+			"Tf0001   P       -2.00   Shop    Town    1600000000\n";
+		r = loader.loadText(columns, fixed);
+		EXPECT_EQ(r.customers, 1);
+		EXPECT_EQ(r.accounts, 1);
+		EXPECT_EQ(r.transactions, 1);
+		EXPECT_EQ(r.rejected, 0);
+		a = db.findAccount("f0001");
+		ASSERT_TRUE(a);
+		EXPECT_EQ(a->balance, 4800);
+	}
+
+	//month-end statements; balances at both ends of the period, lines only from inside it, archived history included
+	TEST(StatementTest, MonthEnd) {
+		auto at = [](long long secs) { return std::chrono::system_clock::time_point(std::chrono::seconds(secs)); };
+		Database db(2);
+		db.enableArchive("StatementArchive.dat", 2);
+		std::shared_ptr<Transaction> t(new Deposit(USDollar(100000), "Bank", at(1786795200))); //Aug 15
+		std::shared_ptr<Account> a(new Checking(t, "st0001"));
+		EXPECT_TRUE(db.addAccount(a));
+		EXPECT_TRUE(a->applyLogged(std::shared_ptr<Transaction>(new Purchase(USDollar(-1025), "Store", "Town", at(1788350400))))); //Sep 2
+		EXPECT_TRUE(a->applyLogged(std::shared_ptr<Transaction>(new Deposit(USDollar(500), "ATM", at(1789905600))))); //Sep 20
+		EXPECT_TRUE(a->applyLogged(std::shared_ptr<Transaction>(new Purchase(USDollar(-5), "Cafe", "Town", at(1791028800))))); //Oct 3
+		for (int i = 0; i < 4; i++) EXPECT_TRUE(a->applyLogged(std::shared_ptr<Transaction>(new Deposit(USDollar(1), "ATM", at(1791028800 + i)))));
+		EXPECT_FALSE(a->ArchivedSegments.empty());
+		std::shared_ptr<Transaction> t1(new Deposit(USDollar(7), "Bank", at(1786795200)));
+		EXPECT_TRUE(db.addAccount(std::shared_ptr<Account>(new Saving(t1, "st0002"))));
+
+		StatementExporter exporter(db, std::shared_ptr<ThreadPool>(new ThreadPool(2)), 64); //tiny buffer so it flushes mid-statement
+		EXPECT_EQ(exporter.exportAll(".", at(1788220800), at(1790812800)), 2); //Sep 1 to Oct 1
+		std::string all;
+		for (int s = 0; s < 2; s++)
+		{
+			std::ifstream in("statements-0" + std::to_string(s) + ".txt", std::ios::binary);
+			all += std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		}
+		EXPECT_NE(all.find("Statement: st0001 : Checking\nPeriod: 2026-09-01 to 2026-10-01\nOpening balance: $1000.00\n"
+			"2026-09-02  Purchase: Store - Town  -$10.25\n2026-09-20  Deposit: Deposit - ATM  $5.00\nClosing balance: $994.75\n"), std::string::npos);
+		EXPECT_NE(all.find("Statement: st0002 : Savings\nPeriod: 2026-09-01 to 2026-10-01\nOpening balance: $0.07\nClosing balance: $0.07\n"), std::string::npos);
+		EXPECT_EQ(all.find("Cafe"), std::string::npos); //after the period
+	}
+
+	//filter, group-by & aggregates across shards, including archived history
+	TEST(QueryTest, GroupAndAggregate) {
+		auto at = [](long long secs) { return std::chrono::system_clock::time_point(std::chrono::seconds(secs)); };
+		Database db(4);
+		db.enableArchive("QueryArchive.dat", 2);
+		std::vector<std::shared_ptr<Account>> accounts;
+		for (int i = 0; i < 6; i++)
+		{
+			std::shared_ptr<Transaction> t(new Deposit(USDollar(10000), "Bank", at(1786795200)));
+			std::shared_ptr<Account> a = i % 2 ? std::shared_ptr<Account>(new Checking(t, "q" + std::to_string(i))) : std::shared_ptr<Account>(new Saving(t, "q" + std::to_string(i)));
+			if (i % 2 == 0) a->setInterestType(2);
+			EXPECT_TRUE(db.addAccount(a));
+			accounts.push_back(a);
+			for (int k = 0; k < 3; k++) //Sep 2, 3 & 4
+			{
+				EXPECT_TRUE(a->applyLogged(std::shared_ptr<Transaction>(new Purchase(USDollar(-100 * (k + 1)), "Card", k ? "Shop" : "Cafe", at(1788350400 + 86400 * k)))));
+			}
+			EXPECT_TRUE(a->applyLogged(std::shared_ptr<Transaction>(new BankFunction(USDollar(50), "Interest payout", at(1788350400)))));
+		}
+		EXPECT_FALSE(accounts[0]->ArchivedSegments.empty());
+
+		QueryEngine engine(db, std::shared_ptr<ThreadPool>(new ThreadPool(3)));
+		TransactionQuery q;
+		q.type = "Purchase";
+		q.from = at(1788220800); //Sep 1
+		q.to = at(1790812800); //Oct 1
+		q.group = TransactionQuery::ORIGIN;
+		std::vector<QueryRow> rows = engine.run(q);
+		ASSERT_EQ(rows.size(), 2u);
+		EXPECT_EQ(rows[0].key, "Cafe");
+		EXPECT_EQ(rows[0].count, 6);
+		EXPECT_EQ(rows[0].sum, -600);
+		EXPECT_EQ(rows[1].key, "Shop");
+		EXPECT_EQ(rows[1].count, 12);
+		EXPECT_EQ(rows[1].sum, -6 * 500);
+		EXPECT_EQ(rows[1].min, -300);
+		EXPECT_EQ(rows[1].max, -200);
+
+		//interest paid per product
+		TransactionQuery interest;
+		interest.name = "Interest payout";
+		interest.group = TransactionQuery::PRODUCT;
+		rows = engine.run(interest);
+		ASSERT_EQ(rows.size(), 2u);
+		EXPECT_EQ(rows[0].key, "0");
+		EXPECT_EQ(rows[1].key, "2");
+		EXPECT_EQ(rows[1].sum, 150);
+
+		//type filter through the index, money in only, one total
+		TransactionQuery in;
+		in.accountType = ACCOUNT_CHECKING;
+		in.sign = 1;
+		rows = engine.run(in);
+		ASSERT_EQ(rows.size(), 1u);
+		EXPECT_EQ(rows[0].count, 6);
+		EXPECT_EQ(rows[0].sum, 3 * 10050);
+		EXPECT_EQ(QueryEngine::format(rows), "All : 6 : $301.50 : $0.50 : $100.00\n");
+	}
+
+	//accounts, customers & history made in the database's arena; anything made in it keeps it, so they outlive the bank safely
+	TEST(ArenaTest, BankObjectsInArena) {
+		std::shared_ptr<Database> db(new Database(4));
+		ASSERT_TRUE(db->Memory);
+		std::shared_ptr<Customer> c = arenaShared<Customer>(db->Memory.get(), "arena", "pass");
+		EXPECT_TRUE(db->addCustomer(c));
+		std::shared_ptr<Account> a = makeAccount(ACCOUNT_CHECKING, arenaShared<Deposit>(db->Memory.get(), USDollar(1000)), "ar0001", db->Memory.get());
+		EXPECT_TRUE(db->addAccount(a, c));
+		EXPECT_EQ(a->Memory, db->Memory);
+		for (int i = 0; i < 100; i++) EXPECT_TRUE(a->deposit(1.00));
+		EXPECT_EQ(a->balance, 11000);
+		EXPECT_EQ(a->transactionCount(), 101);
+		std::shared_ptr<Account> made(new Checking(std::shared_ptr<Transaction>(new Deposit(USDollar(100))), "ar0003")); //on the heap
+		EXPECT_TRUE(db->addAccount(made));
+		a.reset();
+		std::shared_ptr<Account> kept = db->findAccount("ar0001");
+		std::shared_ptr<Transaction> last = kept->Transactions.get(kept->Transactions.getCount() - 1);
+		std::weak_ptr<Arena> memory = db->Memory;
+		db.reset();
+		EXPECT_FALSE(memory.expired()); //what the bank made still holds it
+		EXPECT_TRUE(kept->deposit(1.00));
+		EXPECT_EQ(kept->balance, 11100);
+		EXPECT_TRUE(made->deposit(1.00)); //new history goes in the arena too
+		EXPECT_EQ(made->balance, 200);
+		last.reset();
+		EXPECT_EQ(c->name, "arena");
+		c.reset();
+
+		Database heap(1, false);
+		EXPECT_FALSE(heap.Memory);
+		std::shared_ptr<Account> b(new Saving(std::shared_ptr<Transaction>(new Deposit(USDollar(500))), "ar0002"));
+		EXPECT_TRUE(heap.addAccount(b));
+		EXPECT_TRUE(b->deposit(1.00));
+		EXPECT_EQ(b->balance, 600);
+	}
+
+	//old settled history folds into summaries per period; balances, counts by name & pending transactions survive
+	TEST(CompactionTest, FoldsOldHistory) {
+		auto at = [](long long secs) { return std::chrono::system_clock::time_point(std::chrono::seconds(secs)); };
+		const long long day = 86400;
+		const long long start = 1700000000;
+		Database db(2);
+		db.enableArchive("CompactArchive.dat", 16);
+		std::shared_ptr<Account> a(new MoneyMarket(std::shared_ptr<Transaction>(new Deposit(USDollar(100000), "Bank", at(start))), "mm0001"));
+		EXPECT_TRUE(db.addAccount(a));
+		for (int d = 1; d <= 120; d++) //four months of daily payouts
+		{
+			EXPECT_TRUE(a->applyLogged(std::shared_ptr<Transaction>(new BankFunction(USDollar(3), "Interest payout", at(start + d * day)))));
+		}
+		std::shared_ptr<Transaction> pending(new Purchase(USDollar(-500), "Hold", "Hotel", at(start + 10 * day)));
+		pending->Pending = true;
+		EXPECT_TRUE(a->applyLogged(pending));
+		EXPECT_TRUE(a->applyLogged(std::shared_ptr<Transaction>(new Purchase(USDollar(-250), "Store", "Town", at(start + 200 * day)))));
+		EXPECT_FALSE(a->ArchivedSegments.empty());
+		int balance = a->balance.getValue();
+		int available = a->available.getValue();
+		int before = a->transactionCount();
+
+		long long removed = db.compactHistory(at(start + 150 * day), std::chrono::hours(24 * 30));
+		EXPECT_GT(removed, 100);
+		EXPECT_EQ(a->transactionCount(), before - removed);
+		EXPECT_LT(a->transactionCount(), 12);
+		EXPECT_EQ(a->balance, balance);
+		EXPECT_EQ(a->available, available);
+		a->updateBalance();
+		EXPECT_EQ(a->balance, balance);
+
+		//the payouts still total the same by name, & the pending & recent ones are untouched
+		QueryEngine engine(db);
+		TransactionQuery q;
+		q.name = "Interest payout";
+		std::vector<QueryRow> rows = engine.run(q);
+		ASSERT_EQ(rows.size(), 1u);
+		EXPECT_EQ(rows[0].sum, 360);
+		bool sawPending = false;
+		bool sawRecent = false;
+		a->Transactions.forEach([&](std::shared_ptr<Transaction> t)
+		{
+			if (t->Pending) sawPending = true;
+			if (t->Origin == "Town") sawRecent = true;
+			return true;
+		});
+		EXPECT_TRUE(sawPending);
+		EXPECT_TRUE(sawRecent);
+		for (size_t i = 1; i < a->ArchivedSegments.size(); i++) EXPECT_LE(a->ArchivedSegments[i - 1].first, a->ArchivedSegments[i].first); //still oldest first
+		size_t blocks = a->ArchivedSegments.size();
+		EXPECT_EQ(db.compactHistory(at(start + 150 * day), std::chrono::hours(24 * 30)), 0); //already compact
+		EXPECT_EQ(a->ArchivedSegments.size(), blocks); //& the archive wasn't touched
+	}
+
+	//customers & employees share one directory; a name resolves to its role in one lookup & can't be taken twice across roles
+	TEST(DirectoryTest, OneLookupForEitherRole) {
+		Database db;
+		EXPECT_TRUE(db.addCustomer(std::shared_ptr<Customer>(new Customer("alice", "pw"))));
+		EXPECT_TRUE(db.addEmployee(std::shared_ptr<Employee>(new Employee("bob", "pw2"))));
+
+		DirectoryEntry c = db.findUser("alice");
+		EXPECT_EQ(c.role, ROLE_CUSTOMER);
+		ASSERT_TRUE(c.customer());
+		EXPECT_FALSE(c.employee());
+		DirectoryEntry e = db.findUser("bob");
+		EXPECT_EQ(e.role, ROLE_EMPLOYEE);
+		ASSERT_TRUE(e.employee());
+		EXPECT_FALSE(e.customer());
+		EXPECT_EQ(db.findUser("Admin").role, ROLE_EMPLOYEE); //the default employee is in it from the start
+		EXPECT_EQ(db.findUser("nobody").role, -1);
+		EXPECT_FALSE(db.findUser("nobody").user);
+
+		EXPECT_TRUE(db.findCustomer("alice"));
+		EXPECT_FALSE(db.findEmployee("alice"));
+		EXPECT_TRUE(db.findEmployee("bob"));
+		EXPECT_FALSE(db.findCustomer("bob"));
+
+		EXPECT_FALSE(db.addEmployee(std::shared_ptr<Employee>(new Employee("alice", "x"))));
+		EXPECT_FALSE(db.addCustomer(std::shared_ptr<Customer>(new Customer("bob", "x"))));
+		EXPECT_FALSE(db.addCustomer(std::shared_ptr<Customer>(new Customer("Admin", "x"))));
+		EXPECT_EQ(db.findUser("bob").role, ROLE_EMPLOYEE);
+	}
+
+	//a server over a fresh bank, with the default employee & one customer with one account
+	static std::shared_ptr<Serv::Server> sessionServer(std::shared_ptr<Database> db)
+	{
+		std::shared_ptr<Serv::Server> server(new Serv::Server(db));
+		std::string admin = server->login("Admin", "defaultPassPleaseChange", ROLE_EMPLOYEE);
+		EXPECT_TRUE(server->userCreation(admin, "carol", "pw", "ca0001", 25.00));
+		EXPECT_TRUE(server->userCreation(admin, "dave", "pw", "da0001", 40.00));
+		server->logout(admin);
+		return server;
+	}
+
+	//logging in checks the credentials for the role once; the token then acts as that user & no one else
+	TEST(SessionTest, LoginBindsTheUser) {
+		std::shared_ptr<Database> db(new Database(2));
+		std::shared_ptr<Serv::Server> server = sessionServer(db);
+		EXPECT_EQ(server->login("carol", "wrong", ROLE_CUSTOMER), "");
+		EXPECT_EQ(server->login("carol", "pw", ROLE_EMPLOYEE), "");
+		std::string token = server->login("carol", "pw", ROLE_CUSTOMER);
+		EXPECT_EQ(token.size(), 32u);
+		EXPECT_NE(server->login("carol", "pw", ROLE_CUSTOMER), token);
+		EXPECT_EQ(server->sessionValidation(token), ROLE_CUSTOMER);
+
+		EXPECT_EQ(server->accountsCount(token), 1);
+		EXPECT_NE(server->accountDisplay(token, "ca0001"), "");
+		EXPECT_EQ(server->accountDisplay(token, "da0001"), ""); //someone else's
+		EXPECT_EQ(server->accountTransactions(token, "da0001"), "");
+		EXPECT_FALSE(server->accountsTransfer(token, "da0001", "ca0001", 5.00));
+		EXPECT_FALSE(server->userCreation(token, "eve", "pw", "ev0001")); //employees only
+		EXPECT_EQ(server->transactionReport(token), "");
+
+		EXPECT_EQ(server->sessionValidation("not a token"), -1);
+		EXPECT_EQ(server->accountsCount("not a token"), 0);
+		EXPECT_EQ(server->accountsDisplay(""), "");
+
+		std::string admin = server->login("Admin", "defaultPassPleaseChange", ROLE_EMPLOYEE);
+		EXPECT_EQ(server->accountsCount(admin), 2);
+		EXPECT_NE(server->accountDisplay(admin, "da0001"), "");
+	}
+
+	//sessions idle out on the bank's clock; every use pushes the expiry back
+	TEST(SessionTest, Expiry) {
+		std::shared_ptr<SimulatedClock> clock(new SimulatedClock());
+		std::shared_ptr<Database> db(new Database(2));
+		db->setClock(clock);
+		std::shared_ptr<Serv::Server> server = sessionServer(db);
+		std::string token = server->login("carol", "pw", ROLE_CUSTOMER);
+		clock->advance(std::chrono::minutes(14));
+		EXPECT_EQ(server->sessionValidation(token), ROLE_CUSTOMER);
+		clock->advance(std::chrono::minutes(14));
+		EXPECT_EQ(server->sessionValidation(token), ROLE_CUSTOMER); //still inside the window from the last use
+		clock->advance(std::chrono::minutes(16));
+		EXPECT_EQ(server->sessionValidation(token), -1);
+		EXPECT_EQ(server->accountsCount(token), 0);
+		clock->advance(std::chrono::minutes(-60));
+		EXPECT_EQ(server->sessionValidation(token), -1); //dropped once found expired
+	}
+
+	//logging out ends that session only
+	TEST(SessionTest, Logout) {
+		std::shared_ptr<Database> db(new Database(2));
+		std::shared_ptr<Serv::Server> server = sessionServer(db);
+		std::string first = server->login("carol", "pw", ROLE_CUSTOMER);
+		std::string second = server->login("carol", "pw", ROLE_CUSTOMER);
+		server->logout(first);
+		EXPECT_EQ(server->sessionValidation(first), -1);
+		EXPECT_EQ(server->accountDisplay(first, "ca0001"), "");
+		EXPECT_EQ(server->sessionValidation(second), ROLE_CUSTOMER);
+		server->logout(first); //twice is harmless
+		EXPECT_EQ(server->sessionValidation(second), ROLE_CUSTOMER);
+	}
+
+	//a password change ends the user's other sessions, keeping the one that made it; an employee's reset ends all of them
+	TEST(SessionTest, PasswordChangeRevokes) {
+		std::shared_ptr<Database> db(new Database(2));
+		std::shared_ptr<Serv::Server> server = sessionServer(db);
+		std::string mine = server->login("carol", "pw", ROLE_CUSTOMER);
+		std::string other = server->login("carol", "pw", ROLE_CUSTOMER);
+		std::string dave = server->login("dave", "pw", ROLE_CUSTOMER);
+		EXPECT_FALSE(server->passwordChange(mine, "wrong", "pw2"));
+		EXPECT_EQ(server->sessionValidation(other), ROLE_CUSTOMER);
+		EXPECT_FALSE(server->passwordChange("not a token", "pw", "pw2"));
+
+		EXPECT_TRUE(server->passwordChange(mine, "pw", "pw2"));
+		EXPECT_EQ(server->sessionValidation(mine), ROLE_CUSTOMER);
+		EXPECT_EQ(server->sessionValidation(other), -1);
+		EXPECT_EQ(server->sessionValidation(dave), ROLE_CUSTOMER);
+		EXPECT_EQ(server->login("carol", "pw", ROLE_CUSTOMER), "");
+		EXPECT_NE(server->login("carol", "pw2", ROLE_CUSTOMER), "");
+
+		EXPECT_FALSE(server->passwordReset(dave, "carol", "pw3")); //customers can't reset anyone's
+		std::string admin = server->login("Admin", "defaultPassPleaseChange", ROLE_EMPLOYEE);
+		EXPECT_TRUE(server->passwordReset(admin, "carol", "pw3"));
+		EXPECT_EQ(server->sessionValidation(mine), -1);
+		EXPECT_EQ(server->sessionValidation(admin), ROLE_EMPLOYEE);
+		EXPECT_EQ(server->sessionValidation(dave), ROLE_CUSTOMER);
+
+		std::string admin2 = server->login("Admin", "defaultPassPleaseChange", ROLE_EMPLOYEE);
+		EXPECT_TRUE(server->passwordChange(admin, "defaultPassPleaseChange", "changed"));
+		EXPECT_EQ(server->sessionValidation(admin2), -1);
+		EXPECT_EQ(server->sessionValidation(admin), ROLE_EMPLOYEE);
+	}
+
+	//a settlement file only posts for an employee
+	TEST(SessionTest, PurchaseBatchNeedsEmployee) {
+		std::shared_ptr<Database> db(new Database(2));
+		std::shared_ptr<Serv::Server> server = sessionServer(db);
+		{
+			std::ofstream out("SessionBatch.csv");
+			out << "carol,ca0001,5.00,Store,Town\n";
+		}
+		std::string carol = server->login("carol", "pw", ROLE_CUSTOMER);
+		EXPECT_EQ(server->purchaseBatch(carol, "SessionBatch.csv"), -1);
+		EXPECT_EQ(server->purchaseBatch("not a token", "SessionBatch.csv"), -1);
+		EXPECT_EQ(db->findAccount("ca0001")->balance, 2500);
+		std::string admin = server->login("Admin", "defaultPassPleaseChange", ROLE_EMPLOYEE);
+		EXPECT_EQ(server->purchaseBatch(admin, "SessionBatch.csv"), 1);
+		EXPECT_EQ(db->findAccount("ca0001")->balance, 2000);
+	}
+
+	//a portfolio file only loads for an employee
+	TEST(SessionTest, BulkLoadNeedsEmployee) {
+		std::shared_ptr<Database> db(new Database(2));
+		std::shared_ptr<Serv::Server> server = sessionServer(db);
+		{
+			std::ofstream out("SessionBulk.csv");
+			out << "C,erin,pw\nA,er0001,erin,0,0,10.00\n";
+		}
+		std::string carol = server->login("carol", "pw", ROLE_CUSTOMER);
+		EXPECT_EQ(server->bulkLoad(carol, "SessionBulk.csv"), -1);
+		EXPECT_FALSE(db->findAccount("er0001"));
+		std::string admin = server->login("Admin", "defaultPassPleaseChange", ROLE_EMPLOYEE);
+		EXPECT_EQ(server->bulkLoad(admin, "SessionBulk.csv"), 1);
+		EXPECT_TRUE(db->findAccount("er0001"));
+	}
+
+	//bank processes only run for an employee
+	TEST(SessionTest, BankProcessesNeedEmployee) {
+		std::shared_ptr<SimulatedClock> clock(new SimulatedClock());
+		std::shared_ptr<Database> db(new Database(2));
+		db->setClock(clock);
+		std::shared_ptr<Serv::Server> server = sessionServer(db);
+		std::shared_ptr<Account> a = db->findAccount("ca0001");
+		a->setInterestType(9); //paid daily
+		clock->advance(std::chrono::hours(25));
+		std::string carol = server->login("carol", "pw", ROLE_CUSTOMER);
+		EXPECT_FALSE(server->runBankProccesses(carol));
+		EXPECT_EQ(a->balance, 2500);
+		std::string admin = server->login("Admin", "defaultPassPleaseChange", ROLE_EMPLOYEE);
+		EXPECT_TRUE(server->runBankProccesses(admin));
+		EXPECT_EQ(a->balance, 2500 + getProduct(9).payoutCents);
+	}
+
+	//accounts opened on a clock ahead of the real one start their interest & history there; none of the gap is paid for
+	TEST(ClockTest, OpensOnTheBanksClock) {
+		std::shared_ptr<SimulatedClock> clock(new SimulatedClock(std::chrono::system_clock::now() + std::chrono::hours(24 * 365 * 5)));
+		std::shared_ptr<Database> db(new Database(2));
+		db->setClock(clock);
+		std::shared_ptr<Serv::Server> server = sessionServer(db);
+		std::shared_ptr<Account> direct(new Saving(std::shared_ptr<Transaction>(new Deposit(USDollar(100000))), "sv0001"));
+		direct->setInterestType(4);
+		EXPECT_TRUE(db->addAccount(direct));
+		std::shared_ptr<ThreadPool> pool(new ThreadPool(2));
+		BulkLoader loader(*db, pool);
+		EXPECT_EQ(loader.loadText("A,bl0001,,0,4,1000.00\n").accounts, 1);
+		const std::chrono::system_clock::time_point opened = clock->now();
+		for (std::string id : { "ca0001", "sv0001", "bl0001" })
+		{
+			std::shared_ptr<Account> a = db->findAccount(id);
+			ASSERT_TRUE(a);
+			EXPECT_EQ(a->LastInterest, opened) << id;
+			EXPECT_EQ(a->LastPayout, opened) << id;
+		}
+		EXPECT_EQ(db->findAccount("ca0001")->Transactions.get(0)->Timestamp, opened); //opening deposits too
+		EXPECT_EQ(db->findAccount("bl0001")->Transactions.get(0)->Timestamp, opened);
+		USDollar accrued = direct->accruedInterest();
+		EXPECT_EQ(db->bankProcesses(), 0);
+		EXPECT_EQ(direct->balance, 100000);
+		EXPECT_EQ(direct->accruedInterest(), accrued);
+	}
 }
\ No newline at end of file
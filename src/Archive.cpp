@@ -0,0 +1,86 @@
+#include "BankDB.h"
+
+using namespace DB;
+
+//block layout: magic, account ID, count, then one transaction per record (see writeTransaction)
+static const std::uint32_t BLOCK_MAGIC = 0x43524142; //"BARC"
+
+/// <summary>
+/// Constructor; starts a fresh archive file unless told to keep the blocks already in it
+/// </summary>
+/// <param name="p">archive file path</param>
+/// <param name="keep">keep existing blocks, for a snapshot that still points at them</param>
+TransactionArchive::TransactionArchive(std::string p, bool keep)
+{
+	path = p;
+	if (keep) file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+	if (!file.is_open()) file.open(path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc); //fresh, or nothing there to keep
+}
+
+/// <summary>
+/// appends a block of transactions to the end of the archive
+/// </summary>
+/// <param name="id">owning account ID</param>
+/// <param name="block">transactions to store, oldest first</param>
+/// <returns>location of the block</returns>
+ArchiveSegment TransactionArchive::append(std::string id, LinkedList<Transaction>& block)
+{
+	ArchiveSegment seg;
+	std::string out; //build the whole block first so it's a single write
+	writeRaw<std::uint32_t>(out, BLOCK_MAGIC);
+	writeString(out, id);
+	writeRaw<std::int32_t>(out, block.getCount());
+	bool firstSet = false;
+	block.forEach([&](std::shared_ptr<Transaction> t)
+	{
+		writeTransaction(out, *t);
+		if (!firstSet)
+		{
+			seg.first = t->Timestamp;
+			firstSet = true;
+		}
+		seg.last = t->Timestamp;
+		seg.count++;
+		return true;
+	});
+	seg.bytes = (std::uint32_t)out.size();
+
+	std::lock_guard<std::mutex> guard(lock);
+	file.clear();
+	file.seekp(0, std::ios::end);
+	seg.offset = (std::uint64_t)file.tellp();
+	if (!file.write(out.data(), out.size()) || !file.flush())
+	{
+		throw ExArchiveIO("TransactionArchive::append");
+	}
+	return seg;
+}
+
+/// <summary>
+/// reads one block back out of the archive
+/// </summary>
+/// <param name="seg">block location</param>
+/// <returns>the block's transactions, oldest first</returns>
+LinkedList<Transaction> TransactionArchive::load(const ArchiveSegment& seg)
+{
+	std::string in(seg.bytes, '\0');
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		file.clear();
+		file.seekg(seg.offset);
+		if (!in.empty() && !file.read(&in[0], in.size())) throw ExArchiveIO("TransactionArchive::load");
+	}
+
+	LinkedList<Transaction> block;
+	RecordReader r(in);
+	if (r.read<std::uint32_t>() != BLOCK_MAGIC) throw ExArchiveIO("TransactionArchive::load");
+	r.readString(); //account ID, only needed when inspecting the file by hand
+	int count = r.read<std::int32_t>();
+	for (int i = 0; i < count; i++)
+	{
+		std::shared_ptr<Transaction> t = r.readTransaction();
+		if (!t) throw ExArchiveIO("TransactionArchive::load");
+		block.put(t);
+	}
+	return block;
+}
@@ -127,11 +127,13 @@ void MnuCustomerLogin::logic()
 		std::cout << "Please supply your";
 		std::string user     = TextInput(" Username: "); //get the username
 		std::string password = TextInput(" Password: "); //get the password
-		if (server->userValidation(user, password) == 0)
+		std::string token = server->login(user, password, 0); //credentials are checked once, here
+		if (!token.empty())
 		{
 			clearScreen();
 			clearScreenANSI();
-			MnuCustomerStart cs(user, password);
+			MnuCustomerStart cs(token);
+			server->logout(token);
 			login = false;
 		}
 		else
@@ -153,11 +155,13 @@ void MnuEmployeeLogin::logic()
 		std::cout << "Please supply your";
 		std::string user     = TextInput(" Username: "); //get the username
 		std::string password = TextInput(" Password: "); //get the password
-		if (server->userValidation(user, password) == 1)
+		std::string token = server->login(user, password, 1); //credentials are checked once, here
+		if (!token.empty())
 		{
 			clearScreen();
 			clearScreenANSI();
-			MnuEmployeeStart es(user, password);
+			MnuEmployeeStart es(token);
+			server->logout(token);
 			login = false;
 		}
 		else
@@ -172,7 +176,7 @@ void MnuEmployeeLogin::logic()
 /// </summary>
 void MnuCustomerStart::logic()
 {
-	if (server->userValidation(user, pass) == 0)
+	if (server->sessionValidation(token) == 0)
 	{
 		std::cout << "Welcome, valued customer\n"; //give quick menu landing
 		bool running = true; //we're starting to grab input
@@ -183,21 +187,21 @@ void MnuCustomerStart::logic()
 			i = DynamicOptions(TextInput()); //ask for input, convert to int with option function
 			if (i == 0)
 			{
-				MnuGetAccounts ga(user, pass); //get accounts summary
+				MnuGetAccounts ga(token); //get accounts summary
 				
 			}
 			else if (i == 1)
 			{
-				MnuTransferBetweenAccounts trnsfr(user, pass); //transfer between accounts
+				MnuTransferBetweenAccounts trnsfr(token); //transfer between accounts
 			}
 			else if (i == 2)
 			{
 				std::string id = TextInput("Account ID: "); //grab account ID
-				MnuGetAccountHistory ah(user, pass, id); //show account history
+				MnuGetAccountHistory ah(token, id); //show account history
 			}
 			else if (i == 3)
 			{
-				MnuChangePassword ch(user, pass); //change password
+				MnuChangePassword ch(token); //change password
 			}
 			else if (i == 4)
 			{
@@ -216,7 +220,7 @@ void MnuCustomerStart::logic()
 /// </summary>
 void MnuEmployeeStart::logic()
 {
-	if (server->userValidation(user, pass) == 1)
+	if (server->sessionValidation(token) == 1)
 	{
 		std::cout << "Welcome, valued employee.\n"; //give quick menu landing
 		bool running = true; //we're starting to grab input
@@ -227,45 +231,45 @@ void MnuEmployeeStart::logic()
 			i = DynamicOptions(TextInput()); //ask for input, convert to int with option function
 			if (i == 0)
 			{
-				MnuTransferBetweenAccounts trnsfr(user, pass); //start the transfer menu
+				MnuTransferBetweenAccounts trnsfr(token); //start the transfer menu
 			}
 			else if (i == 1)
 			{
-				MnuDeposit dep(user, pass); //start the deposit menu
+				MnuDeposit dep(token); //start the deposit menu
 			}
 			else if (i == 2)
 			{
-				MnuCustomerCreation cc(user, pass); //start customer creation
+				MnuCustomerCreation cc(token); //start customer creation
 				clearScreen();
 				clearScreenANSI();
 			}
 			else if (i == 3)
 			{
-				MnuAccountCreation ac(user, pass); //start making a new account
+				MnuAccountCreation ac(token); //start making a new account
 			}
 			else if (i == 4)
 			{
-				MnuEmployeeCreation ec(user, pass); //start making anew employee entry
+				MnuEmployeeCreation ec(token); //start making anew employee entry
 				clearScreen();
 				clearScreenANSI();
 			}
 			else if (i == 5)
 			{
-				MnuGetAccounts ga(user, pass); //get accounts summaries
+				MnuGetAccounts ga(token); //get accounts summaries
 			}
 			else if (i == 6)
 			{
 				std::string id = TextInput("Account ID: "); //grab account ID
-				MnuGetAccountHistory ah(user, pass, id); //show account history
+				MnuGetAccountHistory ah(token, id); //show account history
 			}
 
 			else if (i == 7)
 			{
-				MnuManualBankOperations bo(user,pass); //manual operations
+				MnuManualBankOperations bo(token); //manual operations
 			}
 			else if (i == 8)
 			{
-				MnuChangePassword ch(user, pass); //change password
+				MnuChangePassword ch(token); //change password
 			}
 			else if (i == 9)
 			{
@@ -285,7 +289,7 @@ void MnuEmployeeStart::logic()
 /// </summary>
 void MnuEmployeeCreation::logic()
 {
-	if (server->userValidation(user, pass) == 1)
+	if (server->sessionValidation(token) == 1)
 	{
 		std::cout << "You are trying to create an Employee.";
 		bool create = true; //we are running the login functionality
@@ -294,7 +298,7 @@ void MnuEmployeeCreation::logic()
 			std::cout << "Please supply the";
 			std::string userC     = TextInput(" Username: "); //get the username
 			std::string passwordC = TextInput(" Password: "); //get the password
-			if (server->employeeCreation(userC,passwordC)) //make employee
+			if (server->employeeCreation(token, userC, passwordC)) //make employee
 			{
 				create = false;
 			}
@@ -310,7 +314,7 @@ void MnuEmployeeCreation::logic()
 /// </summary>
 void MnuCustomerCreation::logic()
 {
-	if (server->userValidation(user, pass) == 1)
+	if (server->sessionValidation(token) == 1)
 	{
 		std::cout << "You are trying to create a Customer.";
 		bool create = true; //we are running the login functionality
@@ -331,7 +335,7 @@ void MnuCustomerCreation::logic()
 				std::cout << "Not a number or an error occured.";
 				return;
 			}
-			if (server->userCreation(userC, passwordC, accC, d)) //make user
+			if (server->userCreation(token, userC, passwordC, accC, d)) //make user
 			{
 				create = false;
 			}
@@ -348,7 +352,7 @@ void MnuCustomerCreation::logic()
 /// </summary>
 void MnuChangePassword::logic()
 {
-	if (server->userValidation(user, pass) == 1) //employee
+	if (server->sessionValidation(token) == 1) //employee
 	{
 		std::cout << "You are changing the password as an Employee\nPlease supply the";
 		int type = DynamicOptions(TextInput(" Account Type (O, Customer; 1, Current Employee): "));
@@ -357,7 +361,7 @@ void MnuChangePassword::logic()
 			std::cout << "You are changing a customer's password. Please supply";
 			std::string userC = TextInput(" Username: "); //get the username
 			std::string passwordC = TextInput(" New Password: "); //get the password
-			if (server->userPassword(userC, passwordC, 1))
+			if (server->passwordReset(token, userC, passwordC))
 			{
 				clearScreen();
 				clearScreenANSI();
@@ -375,24 +379,15 @@ void MnuChangePassword::logic()
 			std::cout << "You are changing your own password. Please supply";
 			std::string passwordOld = TextInput(" Old Password: "); //get the password
 			std::string passwordNew = TextInput(" New Password: "); //get the new password
-			if (passwordOld == pass)
+			if (server->passwordChange(token, passwordOld, passwordNew)) //the server checks the old one again
 			{
-				if (server->userPassword(user, passwordNew, 2))
-				{
-					clearScreen();
-					clearScreenANSI();
-					std::cout << "You have successfully changed your password.\n";
-				}
-				else
-				{
-					clearScreen();
-					clearScreenANSI();
-					std::cout << "The change was not successful\n";
-				}
+				clearScreen();
+				clearScreenANSI();
+				std::cout << "You have successfully changed your password.\n";
 			}
 			else
 			{
-				std::cout << "Credentials problem, exiting.";
+				std::cout << "Credentials problem or the change was not successful, exiting.";
 			}
 		}
 		else
@@ -401,29 +396,20 @@ void MnuChangePassword::logic()
 		}
 		
 	}
-	else if (server->userValidation(user, pass) == 0) //user
+	else if (server->sessionValidation(token) == 0) //user
 	{
 		std::cout << "You are changing the password as a Customer\nPlease supply the";
 		std::string passwordOld = TextInput(" Old Password: "); //get the password
 		std::string passwordNew = TextInput(" New Password: "); //get the new password
-		if (passwordOld == pass)
+		if (server->passwordChange(token, passwordOld, passwordNew)) //the server checks the old one again
 		{
-			if (server->userPassword(user, passwordNew, 0))
-			{
-				clearScreen();
-				clearScreenANSI();
-				std::cout << "You have successfully changed your password.\n";
-			}
-			else
-			{
-				clearScreen();
-				clearScreenANSI();
-				std::cout << "The change was not successful\n";
-			}
+			clearScreen();
+			clearScreenANSI();
+			std::cout << "You have successfully changed your password.\n";
 		}
 		else
 		{
-			std::cout << "Credentials problem, exiting.\n";
+			std::cout << "Credentials problem or the change was not successful, exiting.\n";
 		}
 	}
 }
@@ -433,10 +419,10 @@ void MnuChangePassword::logic()
 /// </summary>
 void MnuAccountCreation::logic()
 {
-	if (server->userValidation(user, pass) == 1)
+	if (server->sessionValidation(token) == 1)
 	{
 		bool create = true; //we are running the login functionality
-		if (server->accountsCount(user) < 1) create = false; //fail if we don't have any accounts
+		if (server->accountsCount(token) < 1) create = false; //fail if we don't have any accounts
 		while (create) //run until we get success
 		{
 			std::cout << "Please supply the";
@@ -454,7 +440,7 @@ void MnuAccountCreation::logic()
 				std::cout << "Not a number or an error occured.";
 				return;
 			}
-			if (server->accountCreation(userC, accC, i, d)) //make account
+			if (server->accountCreation(token, userC, accC, i, d)) //make account
 			{
 				create = false;
 			}
@@ -471,23 +457,13 @@ void MnuAccountCreation::logic()
 /// </summary>
 void MnuTransferBetweenAccounts::logic()
 {
-	int i = server->userValidation(user, pass);
+	int i = server->sessionValidation(token);
 	if (i >= 0)
 	{
 		bool create = true; //we are running the login functionality
-		std::string userC = user;
 		while (create) //run until we get success
 		{
-			std::cout << "Please supply the";
-			if (i == 1)
-			{
-				userC = TextInput(" Username: "); //get the username
-				if (userC == "")
-				{
-					userC = user;
-					std::cout << "No username supplied, assuming transfer between users.\n";
-				}
-			}
+			std::cout << "Please supply the"; //the server goes by who's logged in; employees can move between anyone's accounts
 			std::string accC = TextInput(" Account ID: "); //get the account ID
 			std::string acc2C = TextInput(" 2nd Account ID: "); //get the account ID again
 			//get the transfer amount, convert to double
@@ -502,7 +478,7 @@ void MnuTransferBetweenAccounts::logic()
 				return;
 			}
 			if (d < 0) d = -d; //make sure it's positive
-			if (server->accountsTransfer(userC, accC, acc2C, d)) //make transfers
+			if (server->accountsTransfer(token, accC, acc2C, d)) //make transfers
 			{
 				create = false;
 			}
@@ -519,7 +495,7 @@ void MnuTransferBetweenAccounts::logic()
 /// </summary>
 void MnuDeposit::logic()
 {
-	if (server->userValidation(user, pass) == 1)
+	if (server->sessionValidation(token) == 1)
 	{
 		bool create = true; //we are running the login functionality
 		while (create) //run until we get success
@@ -539,7 +515,7 @@ void MnuDeposit::logic()
 				return;
 			}
 			if (d < 0) d = -d; //make sure it's positive
-			if (server->accountDeposit(userC, accC, d)) //make deposit
+			if (server->accountDeposit(token, userC, accC, d)) //make deposit
 			{
 				create = false;
 			}
@@ -556,11 +532,11 @@ void MnuDeposit::logic()
 /// </summary>
 void MnuGetAccounts::logic()
 {
-	int access = server->userValidation(user, pass); //validate & get privlege
+	int access = server->sessionValidation(token); //validate & get privlege
 	if (access >= 0)
 	{
-		std::cout << server->accountsDisplay(user); //display the accounts
-		std::cout << "Amount of accounts: " << server->accountsCount(user) << "\n"; //also get count of accounts
+		std::cout << server->accountsDisplay(token); //display the accounts
+		std::cout << "Amount of accounts: " << server->accountsCount(token) << "\n"; //also get count of accounts
 	}
 }
 
@@ -569,10 +545,10 @@ void MnuGetAccounts::logic()
 /// </summary>
 void MnuGetAccountHistory::logic()
 {
-	if (server->userValidation(user, pass) >= 0)
+	if (server->sessionValidation(token) >= 0)
 	{
-		std::cout << server->accountDisplay(user, account);
-		std::cout << server->accountTransactions(user, account);
+		std::cout << server->accountDisplay(token, account);
+		std::cout << server->accountTransactions(token, account);
 	}
 }
 
@@ -581,7 +557,7 @@ void MnuGetAccountHistory::logic()
 /// </summary>
 void MnuManualBankOperations::logic()
 {
-	if (server->userValidation(user, pass) == 1) //make sure you're an employee
+	if (server->sessionValidation(token) == 1) //make sure you're an employee
 	{
 		std::cout << "Manual bank functions are available.\n";
 		bool running = true;
@@ -607,12 +583,12 @@ void MnuManualBankOperations::logic()
 				}
 				if (d < 0) d = -d; //make sure it's positive
 				std::string originAndName = "Manual Purchase";
-				server->purchase(us,acc,d,originAndName,originAndName); //purchase
+				server->purchase(token, us, acc, d, originAndName, originAndName); //purchase
 			}
 			else if (i == 1)
 			{
 				std::cout << "Running banking tasks.";
-				server->runBankProccesses(); //run said banking tasks
+				server->runBankProccesses(token); //run said banking tasks
 			}
 			else if (i == 2)
 			{
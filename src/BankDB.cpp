@@ -1,76 +1,65 @@
 
 #include "BankDB.h"
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <set>
+#include <tuple>
 
 using namespace DB;
 
 bool Customer::transfer(std::shared_ptr<Database> d, std::string acc1, std::string acc2, double v)
 //Transfer between accounts; int for return code. Customers need to own/have access to account
 {
-	if (AccountIDs.find(acc1) >= 0 && AccountIDs.find(acc2) >= 0) //if the customer has access to both accounts (find returns -1 if it can't find anything)
+	std::shared_ptr<Customer> self = d->findCustomer(name); //ownership is checked through the database so it's safe against concurrent account creation
+	if (d->owns(self, acc1) && d->owns(self, acc2)) //if the customer has access to both accounts
 	{
-		std::shared_ptr<Account> Account1 = d->Accounts.get(acc1); //grab account 1
-		std::shared_ptr<Account> Account2 = d->Accounts.get(acc2); //grab account 2
+		std::shared_ptr<Account> Account1 = d->findAccount(acc1); //grab account 1
+		std::shared_ptr<Account> Account2 = d->findAccount(acc2); //grab account 2
 
-		//bool can be converted to int, so i can return it. SendTransfer creates the dollar amount & puts a negative transaction in Account 1,
-		// passing dollar amount to Account 2 which will also confirm the transaction completed successfully when done
+		//both legs post as one commit; a transfer that can't be made durable changes neither account
 		if (Account1 && Account2)
 		{
-			bool b = Account2->receiveTransfer(Account1->sendTransfer(v), acc1);
-			return b;
+			return Database::transfer(Account1, Account2, USDollar(v));
 		}
 		
 	}
-	else
-	{
-		return false;
-	}
+	return false;
 }
 
 bool Customer::deposit(std::shared_ptr<Database> d, std::string acc, double v)
 {
-	if (AccountIDs.find(acc) >= 0)
+	if (d->owns(d->findCustomer(name), acc))
 	{
-		std::shared_ptr<Account> accountToDep = d->Accounts.get(acc); //grab account
+		std::shared_ptr<Account> accountToDep = d->findAccount(acc); //grab account
 		if (accountToDep)
 		{
 			bool b = accountToDep->deposit(v); //get deposit
 			return b; //return success/fail
 		}
 	}
-	else
-	{
-		return false;
-	}
+	return false;
 }
 
 bool Employee::transfer(std::shared_ptr<Database> d, std::string acc1, std::string acc2, double v)
 //Transfer between accounts; int for return code. Employees don't care about account ownership
 {
-	if (d->Accounts.find(acc1) >= 0 && d->Accounts.find(acc2) >= 0)
-		//check if both accounts exist (find returns -1 if it can't find anything)
-	{
-		std::shared_ptr<Account> Account1 = d->Accounts.get(acc1); //grab account 1
-		std::shared_ptr<Account> Account2 = d->Accounts.get(acc2); //grab account 2
+	std::shared_ptr<Account> Account1 = d->findAccount(acc1); //grab account 1
+	std::shared_ptr<Account> Account2 = d->findAccount(acc2); //grab account 2
 
-		//bool can be converted to int, so i can return it. SendTransfer creates the dollar amount & puts a negative transaction in Account 1,
-		// passing dollar amount to Account 2 which will also confirm the transaction completed successfully when done
-		if (Account1 && Account2)
-		{
-			bool b = Account2->receiveTransfer(Account1->sendTransfer(v), acc1);
-			return b;
-		}
-	}
-	else
+	//both legs post as one commit; a transfer that can't be made durable changes neither account
+	if (Account1 && Account2) //check if both accounts exist
 	{
-		return false;
+		return Database::transfer(Account1, Account2, USDollar(v));
 	}
+	return false;
 }
 
 bool Employee::deposit(std::shared_ptr<Database> d, std::string acc, double v)
 {
-	if (d->Accounts.find(acc) >= 0)
+	std::shared_ptr<Account> accountToDep = d->findAccount(acc); //grab account
+	if (accountToDep)
 	{
-		std::shared_ptr<Account> accountToDep = d->Accounts.get(acc); //grab account
 		return accountToDep->deposit(v);
 	}
 	else
@@ -79,77 +68,377 @@ bool Employee::deposit(std::shared_ptr<Database> d, std::string acc, double v)
 	}
 }
 
+/// <summary>
+/// resolves a customer's accounts, without holding the catalog while we transfer
+/// </summary>
+/// <param name="cust">customer</param>
+/// <param name="d">database</param>
+/// <param name="skip">account ID to leave out, already resolved by the caller</param>
+/// <returns>the accounts that exist</returns>
+static std::vector<std::shared_ptr<Account>> ownedAccounts(std::shared_ptr<Customer> cust, std::shared_ptr<Database> d, std::string skip = "")
+{
+	std::vector<std::shared_ptr<Account>> accs;
+	for (std::string& id : d->accountIDs(cust))
+	{
+		if (id == skip) continue;
+		std::shared_ptr<Account> a = d->findAccount(id);
+		if (a) accs.push_back(a);
+	}
+	return accs;
+}
+
 /// <summary>
 /// Handles overdraft for a specific user
 /// </summary>
 /// <param name="c">Customer shared pointer</param>
-/// <returns>was successful?, bool</returns>
+/// <returns>was every account covered?, bool</returns>
 bool Overdraft::OnPurchase(std::string user, std::shared_ptr<Database> d)
 {
-	bool success = false;
-	std::shared_ptr<Customer> cust = d->Customers.get(user);
-	if (cust)
+	std::shared_ptr<Customer> cust = d->findCustomer(user);
+	if (!cust) return false;
+	std::vector<std::shared_ptr<Account>> accs = ownedAccounts(cust, d);
+	post(plan(accs));
+	for (std::shared_ptr<Account>& a : accs)
+	{
+		if (a->balance < 0) return false; //siblings didn't have enough
+	}
+	return true;
+}
+
+/// <summary>
+/// covers one account that just went negative from its owner's other accounts
+/// </summary>
+/// <param name="acc">account that went negative</param>
+/// <param name="owner">its owner</param>
+/// <param name="d">database</param>
+/// <returns>was the account covered?, bool</returns>
+bool Overdraft::OnOverdrawn(std::shared_ptr<Account> acc, std::shared_ptr<Customer> owner, std::shared_ptr<Database> d)
+{
+	if (!acc || !owner || !d) return false;
+	std::vector<std::shared_ptr<Account>> accs = ownedAccounts(owner, d, acc->ID);
+	accs.insert(accs.begin(), acc); //the handle we were given, not a fresh lookup
+	post(plan(accs));
+	return !(acc->balance < 0);
+}
+
+/// <summary>
+/// plans covering transfers for every overdrawn account
+/// </summary>
+/// <param name="accs">a customer's accounts</param>
+/// <returns>transfers to make, in order</returns>
+std::vector<Overdraft::Cover> Overdraft::plan(const std::vector<std::shared_ptr<Account>>& accs)
+{
+	//snapshot what each account is short or can spare, in cents
+	std::vector<int> shortBy(accs.size(), 0);
+	std::vector<int> spare(accs.size(), 0);
+	for (size_t i = 0; i < accs.size(); i++)
+	{
+		std::lock_guard<std::recursive_mutex> guard(accs[i]->Lock);
+		if (accs[i]->balance < 0) shortBy[i] = -accs[i]->balance.getValue();
+		else if (accs[i]->available > 0) spare[i] = accs[i]->available.getValue();
+	}
+
+	std::vector<Cover> covers;
+	size_t from = 0; //next sibling with money left; only ever moves forward
+	for (size_t to = 0; to < accs.size(); to++)
+	{
+		while (shortBy[to] > 0)
+		{
+			while (from < accs.size() && spare[from] == 0) from++;
+			if (from == accs.size()) return covers; //nothing left to draw on
+			int amt = spare[from] < shortBy[to] ? spare[from] : shortBy[to];
+			covers.push_back(Cover{ accs[from], accs[to], amt });
+			spare[from] -= amt;
+			shortBy[to] -= amt;
+		}
+	}
+	return covers;
+}
+
+/// <summary>
+/// posts planned covering transfers
+/// </summary>
+/// <param name="covers">transfers from plan</param>
+/// <returns>transfers posted</returns>
+int Overdraft::post(const std::vector<Cover>& covers)
+{
+	int posted = 0;
+	for (const Cover& c : covers)
+	{
+		AccountPairLock locks(c.from, c.to); //held across the clamp & the transfer, which takes them again
+		//clamp to what's still needed & still there
+		int amt = c.cents;
+		if (-c.to->balance.getValue() < amt) amt = -c.to->balance.getValue();
+		if (c.from->available.getValue() < amt) amt = c.from->available.getValue();
+		if (amt <= 0) continue;
+
+		if (Database::transfer(c.from, c.to, USDollar(amt))) posted++;
+	}
+	return posted;
+}
+
+/// <summary>
+/// Posts a card settlement. Rows are grouped by account so each account is resolved, checked for ownership & locked once, & all its
+/// rows go to the log together with a single wait for the disk. Overdraft runs once per customer who left an account short, after
+/// everything is posted. Accounts are spread over the worker threads when there are any
+/// </summary>
+/// <param name="rows">settlement rows, in the order they should post</param>
+/// <param name="db">this database, for overdraft</param>
+/// <returns>rows posted; rows for unknown accounts, accounts the user doesn't own or for $0 are skipped</returns>
+int Database::purchaseBatch(const std::vector<PurchaseRow>& rows, std::shared_ptr<Database> db)
+{
+	//group row numbers by account, keeping their order
+	std::unordered_map<std::string, size_t> groupOf;
+	std::vector<std::vector<size_t>> groups;
+	for (size_t i = 0; i < rows.size(); i++)
+	{
+		std::unordered_map<std::string, size_t>::iterator it = groupOf.find(rows[i].account);
+		if (it == groupOf.end())
+		{
+			groupOf[rows[i].account] = groups.size();
+			groups.push_back(std::vector<size_t>(1, i));
+		}
+		else groups[it->second].push_back(i);
+	}
+
+	std::atomic<int> posted(0);
+	std::mutex affectedLock;
+	std::set<std::string> affected; //customers who left an account negative
+	auto postGroup = [&](size_t g)
 	{
-		for (int i = 0; i < cust->AccountIDs.getCount(); i++)
+		const std::vector<size_t>& rowsHere = groups[g];
+		std::string id = rows[rowsHere[0]].account;
+		std::shared_ptr<Account> a = findAccount(id);
+		if (!a) return;
+		std::vector<std::string> names = owners(id);
+		std::vector<std::shared_ptr<Transaction>> ts;
+		std::vector<std::string> users;
+		for (size_t i : rowsHere)
 		{
-			//pointer to account, from account get -> dereferenced pointer to AccountID string
-			std::shared_ptr<Account> a;
-			std::string accID = "";
-			if (cust->AccountIDs.get(i))
+			const PurchaseRow& r = rows[i];
+			if (std::find(names.begin(), names.end(), r.user) == names.end()) continue; //not theirs
+			std::shared_ptr<Transaction> t = a->makeTransaction<Purchase>(USDollar(-r.val), r.name, r.origin, a->now());
+			if (t->Val == 0) continue;
+			ts.push_back(t);
+			users.push_back(r.user);
+		}
+		if (ts.empty()) return;
+
+		std::lock_guard<std::recursive_mutex> held(a->Lock);
+		VersionBatch commit(a, a); //readers see the account's rows as one commit
+		bool covered = !(a->balance < 0);
+		std::shared_ptr<WriteAheadLog> log = a->Log;
+		if (log)
+		{
+			try
 			{
-				accID = *cust->AccountIDs.get(i);
+				std::uint64_t last = 0;
+				for (std::shared_ptr<Transaction>& t : ts) last = log->enqueue(WriteAheadLog::postingRecord(a->ID, *t));
+				log->waitDurable(last);
+				a->LoggedSeq = last;
 			}
-			a = d->Accounts.get(accID);
-			//check if we actually got the account
-			if (a)
+			catch (Exception& ex)
 			{
-				//if so, continue & see if account's balance is less than 0
-				if (a->balance < 0)
-				{
-					//check accounts again
-					for (int j = 0; j < cust->AccountIDs.getCount(); j++)
-					{
-						std::shared_ptr<Account> b;
-						std::string accID2 = "";
-						if (cust->AccountIDs.get(j))
-						{
-							accID2 = *cust->AccountIDs.get(j);
-						}
-						b = d->Accounts.get(accID2);
-						//make sure b exists
-						if (b)
-						{
-							//extra if to skip trying to pull money from itself, Just In Case; preemptive bug fix
-							if (!(accID2 == accID))
-							{
-								//go until account balance is fixed
-								while (a->balance < 0 && b->available > 0)
-								{
-									//make amount to sub, starting at 5 bucks
-									double amtToSub = 5.00;
-									//scale amount to sub based on amount currently missing
-									if (a->balance < USDollar(20.00))
-									{
-										amtToSub = 50.00;
-									}
-									else if (a->balance < USDollar(10.00))
-									{
-										amtToSub = 20.00;
-									}
-									else if (a->balance < USDollar(5.00))
-									{
-										amtToSub = 10.00;
-									}
-
-									//send from account b to account A
-									success = cust->transfer(d, accID2, accID, amtToSub) == 0;
-								}
-							}
-						}
-					}
-				}
+				ex.printError();
+				return; //not durable, none of this account's rows post
 			}
 		}
+		int n = 0;
+		for (std::shared_ptr<Transaction>& t : ts)
+		{
+			if (a->applyLogged(t)) n++;
+		}
+		posted += n;
+		if (covered && a->balance < 0) //only the rows that took it negative; an account already short was handled then
+		{
+			std::lock_guard<std::mutex> guard(affectedLock);
+			affected.insert(users.begin(), users.end());
+		}
+	};
+
+	std::shared_ptr<ThreadPool> pool = Workers;
+	if (pool && groups.size() > 1)
+	{
+		int tasks = pool->size() * 4; //a few chunks per thread evens out big & small accounts
+		if ((size_t)tasks > groups.size()) tasks = (int)groups.size();
+		pool->parallelFor(tasks, [&](int task)
+		{
+			for (size_t g = task; g < groups.size(); g += tasks) postGroup(g);
+		});
+	}
+	else
+	{
+		for (size_t g = 0; g < groups.size(); g++) postGroup(g);
+	}
+
+	for (const std::string& user : affected) Overdraft::OnPurchase(user, db);
+	return posted;
+}
+
+/// <summary>
+/// Folds settled transactions older than the horizon into summary records, one per period, transaction type & name, so years of
+/// daily interest payouts become a row a period. Periods are fixed windows counted from the epoch, not calendar months.
+/// Summaries keep the type & name of what they replace & carry only the sum, so balances, interest checkpoints & sums by type or
+/// name are unchanged, but counts, mins & maxes over folded history are of the summaries. Archived blocks entirely older than the horizon are folded too, &
+/// the summaries go back into the archive as one block in their place; the old blocks' space in the file isn't reused. Pending
+/// transactions are left in place
+/// </summary>
+/// <param name="horizon">transactions from before this are folded</param>
+/// <param name="period">length of each summary's period, counted from the epoch</param>
+/// <returns>how many fewer transactions the account holds</returns>
+int Account::compact(std::chrono::system_clock::time_point horizon, std::chrono::system_clock::duration period)
+{
+	if (period.count() <= 0) return 0;
+	std::lock_guard<std::recursive_mutex> guard(Lock);
+
+	/// <summary>
+	/// transactions being folded into one summary
+	/// </summary>
+	struct Group
+	{
+		std::vector<std::shared_ptr<Transaction>> members;
+		int cents = 0;
+	};
+	std::map<std::tuple<long long, std::string, std::string>, Group> groups; //period, type, name; ordered so summaries come out oldest first
+	auto fold = [&](std::shared_ptr<Transaction> t)
+	{
+		std::chrono::system_clock::duration since = t->Timestamp.time_since_epoch();
+		long long bucket = since / period;
+		if (since % period < std::chrono::system_clock::duration(0)) bucket--; //round down for times before the epoch
+		Group& g = groups[std::make_tuple(bucket, t->TransactionType(), t->Name)];
+		g.members.push_back(t);
+		g.cents += t->Val.getValue();
+	};
+
+	//archived blocks wholly before the horizon, skipping ones a past run already left compact; everything archived is settled
+	size_t firstBlock = 0;
+	while (firstBlock < ArchivedSegments.size() && ArchivedSegments[firstBlock].last < CompactedBefore) firstBlock++;
+	size_t oldBlocks = firstBlock;
+	int archivedFolded = 0;
+	USDollar archivedSum(0);
+	while (oldBlocks < ArchivedSegments.size() && ArchivedSegments[oldBlocks].last < horizon)
+	{
+		LinkedList<Transaction> block = loadArchived((int)oldBlocks);
+		if (block.getCount() != ArchivedSegments[oldBlocks].count) return 0; //couldn't read it back, leave everything alone
+		block.forEach([&](std::shared_ptr<Transaction> t)
+		{
+			fold(t);
+			archivedSum = archivedSum + t->Val;
+			return true;
+		});
+		archivedFolded += ArchivedSegments[oldBlocks].count;
+		oldBlocks++;
+	}
+	LinkedList<Transaction> keep; //hot transactions staying as they are
+	keep.setArena(Memory);
+	Transactions.forEach([&](std::shared_ptr<Transaction> t)
+	{
+		if (t->Timestamp < horizon && !t->Pending) fold(t);
+		else keep.put(t);
+		return true;
+	});
+
+	bool folding = false;
+	for (std::pair<const std::tuple<long long, std::string, std::string>, Group>& g : groups) folding = folding || g.second.members.size() > 1;
+	if (!folding) //already compact; nothing changes, so the archive isn't touched
+	{
+		if (horizon > CompactedBefore) CompactedBefore = horizon;
+		return 0;
 	}
-	return success;
-}
\ No newline at end of file
+
+	//the summaries, oldest period first
+	LinkedList<Transaction> summaries;
+	summaries.setArena(Memory);
+	USDollar summarySum(0);
+	int before = transactionCount();
+	for (std::pair<const std::tuple<long long, std::string, std::string>, Group>& g : groups)
+	{
+		summarySum = summarySum + USDollar(g.second.cents);
+		if (g.second.members.size() == 1)
+		{
+			summaries.put(g.second.members[0]);
+			continue;
+		}
+		const std::string& type = std::get<1>(g.first);
+		const std::string& name = std::get<2>(g.first);
+		std::chrono::system_clock::time_point ts = g.second.members[0]->Timestamp; //newest member; inside the period, so range queries still find it
+		for (std::shared_ptr<Transaction>& m : g.second.members) if (m->Timestamp > ts) ts = m->Timestamp;
+		std::string origin = "Summary of " + std::to_string(g.second.members.size());
+		std::shared_ptr<Transaction> summary;
+		if (type == "Purchase") summary = makeTransaction<Purchase>(USDollar(g.second.cents), name, origin, ts);
+		else if (type == "Transfer") summary = makeTransaction<Transfer>(USDollar(g.second.cents), name, ts);
+		else if (type == "Deposit") summary = makeTransaction<Deposit>(USDollar(g.second.cents), origin, ts);
+		else summary = makeTransaction<BankFunction>(USDollar(g.second.cents), name, ts);
+		summary->Name = name;
+		summary->Origin = origin;
+		summaries.put(summary);
+	}
+
+	if (Archive)
+	{
+		//the summaries take the folded blocks' place in the archive, so blocks stay oldest first
+		try
+		{
+			ArchiveSegment seg = Archive->append(ID, summaries);
+			ArchivedSegments.erase(ArchivedSegments.begin() + firstBlock, ArchivedSegments.begin() + oldBlocks);
+			ArchivedSegments.insert(ArchivedSegments.begin() + firstBlock, seg);
+		}
+		catch (Exception& ex)
+		{
+			ex.printError(); //leave everything as it was
+			return 0;
+		}
+		archivedCount += summaries.getCount() - archivedFolded;
+		archivedBalance = archivedBalance + summarySum - archivedSum;
+		Transactions = keep;
+	}
+	else
+	{
+		//no archive, so nothing was archived; the summaries go in front of what's kept
+		keep.forEach([&](std::shared_ptr<Transaction> t)
+		{
+			summaries.put(t);
+			return true;
+		});
+		Transactions = summaries;
+	}
+	if (horizon > CompactedBefore) CompactedBefore = horizon;
+	balanceChanged(); //same balances, fewer transactions
+	return before - transactionCount();
+}
+
+/// <summary>
+/// Compacts every account's history, in parallel when the bank has workers. Compaction isn't logged; the next snapshot keeps it,
+/// & replaying an older snapshot just brings back the uncompacted history with the same balances
+/// </summary>
+/// <param name="horizon">transactions from before this are folded</param>
+/// <param name="period">length of each summary's period, counted from the epoch</param>
+/// <returns>how many fewer transactions the bank holds</returns>
+long long Database::compactHistory(std::chrono::system_clock::time_point horizon, std::chrono::system_clock::duration period)
+{
+	std::vector<std::shared_ptr<Account>> accounts;
+	accounts.reserve(accountCount());
+	forEachAccount([&](std::shared_ptr<Account> a)
+	{
+		accounts.push_back(a);
+		return true;
+	});
+	std::atomic<long long> removed(0);
+	std::shared_ptr<ThreadPool> pool = Workers;
+	if (pool && accounts.size() > 1)
+	{
+		int tasks = pool->size() * 4; //a few chunks per thread evens out long & short histories
+		if ((size_t)tasks > accounts.size()) tasks = (int)accounts.size();
+		pool->parallelFor(tasks, [&](int task)
+		{
+			long long mine = 0;
+			for (size_t i = task; i < accounts.size(); i += tasks) mine += accounts[i]->compact(horizon, period);
+			removed += mine;
+		});
+	}
+	else
+	{
+		for (std::shared_ptr<Account>& a : accounts) removed += a->compact(horizon, period);
+	}
+	return removed;
+}
@@ -1,11 +1,38 @@
-
 #include "BankDB.h"
 #include "BankServer.h"
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <unordered_map>
 
 using namespace Serv;
 
-//pointer to a new Database
-std::shared_ptr<DB::Database> db = std::shared_ptr<DB::Database>(new DB::Database);
+//sessions end after this long without being used
+static const std::chrono::minutes SessionIdle(15);
+
+/// <summary>
+/// the bank on disk; starts from the last snapshot, old transaction history is tiered out to the archive file,
+/// bank processes use every core & every change goes to the log, which is replayed on top of the snapshot on startup.
+/// Made the first time a Server needs it
+/// </summary>
+static std::shared_ptr<DB::Database> bank()
+{
+	static std::shared_ptr<DB::Database> d = []()
+	{
+		std::shared_ptr<DB::Database> d(new DB::Database());
+		d->loadSnapshot("BankSnapshot.dat");
+		if (!d->Archive) d->enableArchive("BankArchive.dat"); //the snapshot brings its archive along
+		d->setThreads(0);
+		d->enableLog("BankLog.dat");
+		return d;
+	}();
+	return d;
+}
+
+Server::Server() : db(bank())
+{
+}
 
 /// <summary>
 /// validates user & gives their access level
@@ -16,113 +43,174 @@ std::shared_ptr<DB::Database> db = std::shared_ptr<DB::Database>(new DB::Databas
 int Server::userValidation(std::string user, std::string pass)
 {
 	int result = -1;
-	int i = db->Customers.find(user);
-	if (i != -1)
+	DB::DirectoryEntry u = db->findUser(user); //one lookup for customers & employees alike
+	if (u.user)
 	{
-		std::shared_ptr<DB::Customer> c = db->Customers.get(i); //grab customer
-		if (c)
-		{
-			if(c->password == pass) result = 0; //will be replaced with password hash comparison later
-		}
+		if(u.user->password == pass) result = u.role; //will be replaced with password hash comparison later
+	}
+	return result;
+}
+
+/// <summary>
+/// Checks the credentials once & issues a session token for them. Tokens are 128 random bits, so they can't be guessed from
+/// the user or from each other
+/// </summary>
+/// <param name="user">username</param>
+/// <param name="pass">password</param>
+/// <param name="role">access level being logged in to; 0 customer, 1 employee</param>
+/// <returns>the token, empty if the credentials are wrong for that role</returns>
+std::string Server::login(std::string user, std::string pass, int role)
+{
+	if (userValidation(user, pass) != role) return "";
+	std::random_device random;
+	static const char hex[] = "0123456789abcdef";
+	std::string token;
+	for (int i = 0; i < 4; i++)
+	{
+		std::uint32_t bits = random();
+		for (int k = 0; k < 8; k++) token.push_back(hex[(bits >> (k * 4)) & 15]);
 	}
-	else
+	std::chrono::system_clock::time_point now = db->now();
+	std::lock_guard<std::mutex> guard(sessionLock);
+	if (sessions.size() >= sweepAt) //drop expired sessions now & then, so abandoned ones don't pile up
 	{
-		int j = db->Employees.find(user);
-		if (j != -1)
+		for (std::unordered_map<std::string, Session>::iterator it = sessions.begin(); it != sessions.end();)
 		{
-			std::shared_ptr<DB::Employee> e = db->Employees.get(j);
-			if (e)
-			{
-				if(e->password == pass) result = 1; //will be replaced with password hash comparison later
-			}
+			if (it->second.expires < now) it = sessions.erase(it);
+			else it++;
 		}
+		sweepAt = sessions.size() * 2 > 64 ? sessions.size() * 2 : 64;
+	}
+	sessions[token] = Session{ user, role, now + SessionIdle };
+	return token;
+}
+
+/// <summary>
+/// finds a live session & keeps it alive; expired ones are dropped when they're found
+/// </summary>
+/// <param name="token">token from login</param>
+/// <returns>copy of the session; role is -1 if it's unknown or expired</returns>
+Session Server::session(std::string token)
+{
+	std::chrono::system_clock::time_point now = db->now();
+	std::lock_guard<std::mutex> guard(sessionLock);
+	std::unordered_map<std::string, Session>::iterator it = sessions.find(token);
+	if (it == sessions.end()) return Session();
+	if (it->second.expires < now)
+	{
+		sessions.erase(it);
+		return Session();
+	}
+	it->second.expires = now + SessionIdle;
+	return it->second;
+}
+
+/// <summary>
+/// validates a session by token alone
+/// </summary>
+/// <param name="token">token from login</param>
+/// <returns>access level the session has, 0-1 (user, employee); -1 if it's unknown or expired</returns>
+int Server::sessionValidation(std::string token)
+{
+	return session(token).role;
+}
+
+/// <summary>
+/// ends a session; the token stops working straight away
+/// </summary>
+/// <param name="token">token from login</param>
+void Server::logout(std::string token)
+{
+	std::lock_guard<std::mutex> guard(sessionLock);
+	sessions.erase(token);
+}
+
+/// <summary>
+/// ends a user's sessions, like after their password changes
+/// </summary>
+/// <param name="user">username</param>
+/// <param name="role">which of their logins; a customer & an employee can't share a name, but the role keeps it exact</param>
+/// <param name="keep">token to leave alone, empty for none</param>
+void Server::revoke(std::string user, int role, std::string keep)
+{
+	std::lock_guard<std::mutex> guard(sessionLock);
+	for (std::unordered_map<std::string, Session>::iterator it = sessions.begin(); it != sessions.end();)
+	{
+		if (it->second.user == user && it->second.role == role && it->first != keep) it = sessions.erase(it);
+		else it++;
 	}
-	return result;
 }
 
 /// <summary>
 /// creating a user
 /// </summary>
+/// <param name="token">employee's session</param>
 /// <param name="user">username</param>
 /// <param name="pass">pass</param>
 /// <param name="acc">first account name</param>
 /// <param name="deposit">initial deposit</param>
 /// <returns>was it successful, bool</returns>
-bool Server::userCreation(std::string user, std::string pass, std::string acc, double deposit)
+bool Server::userCreation(std::string token, std::string user, std::string pass, std::string acc, double deposit)
 {
 	bool b = false;
-	if (db->Customers.find(user) == -1 && db->Accounts.find(acc) == -1) //make sure user & acc don't already exist
+	if (session(token).role != DB::ROLE_EMPLOYEE) return b;
+	if (!db->findUser(user).user && !db->findAccount(acc)) //make sure user & acc don't already exist
 	{
 		std::shared_ptr<DB::Customer> u = std::shared_ptr<DB::Customer>(new DB::Customer(user, pass));
-		std::shared_ptr<DB::Transaction> t(new DB::Deposit(deposit));
+		std::shared_ptr<DB::Transaction> t(new DB::Deposit(deposit, "Bank", db->now())); //opened on the bank's clock
 		std::shared_ptr<DB::Account> a = std::shared_ptr<DB::Account>(new DB::Saving(t, acc));
 		t.reset(); //clear extra transaction early
-		std::shared_ptr<std::string> s = std::shared_ptr<std::string>(new std::string(acc));
-		b = (u->AccountIDs.put(s) && db->Accounts.put(a) && db->Customers.put(u));
+		b = (db->addCustomer(u) && db->addAccount(a, u)); //the database re-checks both under its lock
 	}
 	return b;
 }
 
 /// <summary>
-/// Allows users to change passwords
+/// Allows users to change their own password. Their other sessions end, as they may be whoever had the old one; this one stays
 /// </summary>
-/// <param name="user">User to change</param>
-/// <param name="pass">pass to change</param>
+/// <param name="token">session of the user changing it</param>
+/// <param name="oldPass">current password, checked again</param>
+/// <param name="newPass">pass to change to</param>
 /// <returns>were we successful? bool</returns>
-bool Server::userPassword(std::string user, std::string pass, int type)
+bool Server::passwordChange(std::string token, std::string oldPass, std::string newPass)
 {
-	bool b = false;
-	int i = -1;
-	int j = -1;
-	switch (type)
-	{
-	case 2:
-		j = db->Employees.find(user);
-		if (j != -1)
-		{
-			std::shared_ptr<DB::Employee> e = db->Employees.get(j); //grab employee
-			if (e)
-			{
-				if (e->password != pass) //make sure to soft error if they set the same pass again
-				{
-					b = true;
-					e->password = pass;
-				}
-			}
-		}
-		break;
-	default:
-		i = db->Customers.find(user);
-		if (i != -1)
-		{
-			std::shared_ptr<DB::Customer> c = db->Customers.get(i); //grab customer
-			if (c)
-			{
-				if (c->password != pass) //make sure to soft error if they set the same pass again
-				{
-					b = true;
-					c->password = pass;
-				}
-			}
-		}
-		break;
-	}
+	Session s = session(token);
+	if (s.role < 0 || userValidation(s.user, oldPass) != s.role) return false;
+	bool b = db->setPassword(s.user, newPass, s.role); //soft error if they set the same pass again
+	if (b) revoke(s.user, s.role, token);
+	return b;
+}
+
+/// <summary>
+/// Lets employees set a customer's password; whoever is logged in as that customer is logged out
+/// </summary>
+/// <param name="token">employee's session</param>
+/// <param name="user">customer to change</param>
+/// <param name="pass">pass to change to</param>
+/// <returns>were we successful? bool</returns>
+bool Server::passwordReset(std::string token, std::string user, std::string pass)
+{
+	if (session(token).role != DB::ROLE_EMPLOYEE) return false;
+	bool b = db->setPassword(user, pass, DB::ROLE_CUSTOMER); //soft error if they set the same pass again
+	if (b) revoke(user, DB::ROLE_CUSTOMER);
 	return b;
 }
 
 /// <summary>
 /// Creates an employee account. just needs user & pass
 /// </summary>
+/// <param name="token">employee's session</param>
 /// <param name="user">username</param>
 /// <param name="pass">password</param>
 /// <returns>were we successful? bool </returns>
-bool Server::employeeCreation(std::string user, std::string pass)
+bool Server::employeeCreation(std::string token, std::string user, std::string pass)
 {
 	bool b = false;
-	if (db->Customers.find(user) == -1)
+	if (session(token).role != DB::ROLE_EMPLOYEE) return b;
+	if (!db->findUser(user).user)
 	{
 		std::shared_ptr<DB::Employee> u = std::shared_ptr<DB::Employee>(new DB::Employee(user, pass));
-		b = db->Employees.put(u);
+		b = db->addEmployee(u);
 	}
 	return b;
 }
@@ -130,50 +218,47 @@ bool Server::employeeCreation(std::string user, std::string pass)
 /// <summary>
 /// creating a new account for an existing user
 /// </summary>
+/// <param name="token">employee's session</param>
 /// <param name="user">existing user</param>
 /// <param name="acc">account name to make</param>
 /// <param name="t">type code</param>
 /// <param name="deposit">deposit amount</param>
 /// <returns>were we successful, bool</returns>
-bool Server::accountCreation(std::string user, std::string acc, int t, double deposit)
+bool Server::accountCreation(std::string token, std::string user, std::string acc, int t, double deposit)
 {
 	bool b = false;
-	int i = db->Customers.find(user);
-	if (i != -1)
+	if (session(token).role != DB::ROLE_EMPLOYEE) return b;
+	std::shared_ptr<DB::Customer> c = db->findCustomer(user);
+	if (c)
 	{
-		std::shared_ptr<DB::Customer> c = db->Customers.get(i);
-		if (c)
+		std::shared_ptr<DB::Transaction> tr(new DB::Deposit(deposit, "Bank", db->now()));
+		if (!db->owns(c, acc) && !db->findAccount(acc))
 		{
-			std::shared_ptr<DB::Transaction> tr(new DB::Deposit(deposit));
-			if (c->AccountIDs.find(acc) == -1 && db->Accounts.find(acc) == -1)
+			std::shared_ptr<DB::Account> a; //make empty pointer
+			switch (t) //switch based on #
+			{
+				case 0:
+					a = std::shared_ptr<DB::Account>(new DB::Saving(tr, acc));
+					a->setInterestType(4); //normal interest
+					break;
+				case 1:
+					a = std::shared_ptr<DB::Account>(new DB::Checking(tr, acc));
+					a->setInterestType(0); //no interest
+					break;
+				case 2:
+					a = std::shared_ptr<DB::Account>(new DB::CertOfDep(tr, acc));
+					a->setInterestType(8); //extra good interest
+					break;
+				case 3:
+					a = std::shared_ptr<DB::Account>(new DB::MoneyMarket(tr, acc));
+					a->setInterestType(6); //daily, okay interest
+					break;
+				default:
+					break;
+			}
+			if (a) //make sure our pointer isn't empty
 			{
-				std::shared_ptr<DB::Account> a; //make empty pointer
-				switch (t) //switch based on #
-				{
-					case 0:
-						a = std::shared_ptr<DB::Account>(new DB::Saving(tr, acc));
-						a->setInterestType(4); //normal interest
-						break;
-					case 1:
-						a = std::shared_ptr<DB::Account>(new DB::Checking(tr, acc));
-						a->setInterestType(0); //no interest
-						break;
-					case 2:
-						a = std::shared_ptr<DB::Account>(new DB::CertOfDep(tr, acc));
-						a->setInterestType(8); //extra good interest
-						break;
-					case 3:
-						a = std::shared_ptr<DB::Account>(new DB::MoneyMarket(tr, acc));
-						a->setInterestType(6); //daily, okay interest
-						break;
-					default:
-						break;
-				}
-				if (a) //make sure our pointer isn't empty
-				{
-					std::shared_ptr<std::string> id(new std::string(a->ID)); //make ID
-					b = c->AccountIDs.put(id) && db->Accounts.put(a); //put ID & account
-				}
+				b = db->addAccount(a, c); //put ID & account
 			}
 		}
 	}
@@ -181,32 +266,24 @@ bool Server::accountCreation(std::string user, std::string acc, int t, double de
 }
 
 /// <summary>
-/// transfer between accounts
+/// transfer between accounts; customers only between their own, employees between any
 /// </summary>
-/// <param name="user">user to transfer for</param>
+/// <param name="token">session to transfer for</param>
 /// <param name="acc">account 1</param>
 /// <param name="acc2">account 2</param>
 /// <param name="amnt">amount to transfer</param>
 /// <returns>were we successful, bool</returns>
-bool Server::accountsTransfer(std::string user, std::string acc, std::string acc2, double amnt)
+bool Server::accountsTransfer(std::string token, std::string acc, std::string acc2, double amnt)
 {
 	bool b = false;
-	int i = db->Customers.find(user);
-	if (i != -1)
+	DB::DirectoryEntry u = db->findUser(session(token).user);
+	if (u.role == DB::ROLE_CUSTOMER)
 	{
-		std::shared_ptr<DB::Customer> c = db->Customers.get(i);
-		if (c)
-		{
-			b = c->transfer(db, acc, acc2, amnt);
-		}
+		b = u.customer()->transfer(db, acc, acc2, amnt);
 	}
-	else
+	else if (u.role == DB::ROLE_EMPLOYEE)
 	{
-		std::shared_ptr<DB::Employee> e = db->Employees.get(user);
-		if (e)
-		{
-			b = e->transfer(db, acc, acc2, amnt);
-		}
+		b = u.employee()->transfer(db, acc, acc2, amnt);
 	}
 	return b;
 }
@@ -214,21 +291,19 @@ bool Server::accountsTransfer(std::string user, std::string acc, std::string acc
 /// <summary>
 /// Depositing into account
 /// </summary>
+/// <param name="token">employee's session</param>
 /// <param name="user">user to deposit for</param>
 /// <param name="acc">account to deposit in</param>
 /// <param name="deposit">amount to deposit</param>
 /// <returns>were we successful? bool</returns>
-bool Server::accountDeposit(std::string user, std::string acc, double deposit)
+bool Server::accountDeposit(std::string token, std::string user, std::string acc, double deposit)
 {
 	bool b = false;
-	int i = db->Customers.find(user);
-	if (i != -1)
+	if (session(token).role != DB::ROLE_EMPLOYEE) return b;
+	std::shared_ptr<DB::Customer> c = db->findCustomer(user);
+	if (c)
 	{
-		std::shared_ptr<DB::Customer> c = db->Customers.get(i);
-		if (c)
-		{
-			b = c->deposit(db, acc, deposit);
-		}
+		b = c->deposit(db, acc, deposit);
 	}
 	return b;
 }
@@ -236,22 +311,18 @@ bool Server::accountDeposit(std::string user, std::string acc, double deposit)
 /// <summary>
 /// get the count of accounts. For customers, their accounts. for Employees, all accounts.
 /// </summary>
-/// <param name="user">user to get</param>
+/// <param name="token">session to count for</param>
 /// <returns>count of accounts, int</returns>
-int Server::accountsCount(std::string user)
+int Server::accountsCount(std::string token)
 {
-	int i = db->Customers.find(user);
-	if (i != -1)
+	DB::DirectoryEntry u = db->findUser(session(token).user);
+	if (u.role == DB::ROLE_CUSTOMER)
 	{
-		return db->Customers.get(i)->AccountIDs.getCount();
+		return (int)db->accountIDs(u.customer()).size();
 	}
-	else
+	else if (u.role == DB::ROLE_EMPLOYEE)
 	{
-		int j = db->Employees.find(user);
-		if (j != -1)
-		{
-			return db->Accounts.getCount();
-		}
+		return db->accountCount();
 	}
 	return 0;
 }
@@ -259,19 +330,17 @@ int Server::accountsCount(std::string user)
 /// <summary>
 /// account display, displays a summary of 1 account
 /// </summary>
-/// <param name="user">user to check account against</param>
+/// <param name="token">session to check account against</param>
 /// <param name="acc">account to find</param>
 /// <returns>text for account display, string</returns>
-std::string Server::accountDisplay(std::string user, std::string acc)
+std::string Server::accountDisplay(std::string token, std::string acc)
 {
-	int i = db->Customers.find(user); //get user 
-	if (i != -1)
+	DB::DirectoryEntry u = db->findUser(session(token).user); //get user 
+	if (u.role == DB::ROLE_CUSTOMER)
 	{
-		std::shared_ptr<DB::Customer> c = db->Customers.get(i);
-		if (c && c->AccountIDs.find(acc) >= 0)
+		if (db->owns(u.customer(), acc))
 		{
-			int z = db->Accounts.find(acc);
-			std::shared_ptr<DB::Account> a = db->Accounts.get(z);
+			std::shared_ptr<DB::Account> a = db->findAccount(acc);
 			if (a)
 			{
 				std::string s = a->preview();
@@ -279,14 +348,10 @@ std::string Server::accountDisplay(std::string user, std::string acc)
 			}
 		}
 	}
-	else
+	else if (u.role == DB::ROLE_EMPLOYEE)
 	{
-		int j = db->Employees.find(user);
-		if (j != -1)
-		{
-			int k = db->Accounts.find(acc);
-			if (k > -1) return db->Accounts.get(k)->preview();
-		}
+		std::shared_ptr<DB::Account> a = db->findAccount(acc);
+		if (a) return a->preview();
 	}
 
 	return "";
@@ -295,33 +360,29 @@ std::string Server::accountDisplay(std::string user, std::string acc)
 /// <summary>
 /// displays all accounts; all of customers, or all of them for employees
 /// </summary>
-/// <param name="user">user to check against</param>
+/// <param name="token">session to check against</param>
 /// <returns>a combined string of all the accounts</returns>
-std::string Server::accountsDisplay(std::string user)
+std::string Server::accountsDisplay(std::string token)
 {
 	std::string s = "";
-	int i = db->Customers.find(user); //get user 
-	if (i != -1)
+	DB::DirectoryEntry u = db->findUser(session(token).user); //get user 
+	if (u.role == DB::ROLE_CUSTOMER)
 	{
-		std::shared_ptr<DB::Customer> c = db->Customers.get(i);
-		if (c)
+		for (std::string& id : db->accountIDs(u.customer()))
 		{
-			for (int j = 0; j < c->AccountIDs.getCount(); j++)
-			{
-				s += accountDisplay(user, *c->AccountIDs.get(j));
-			}
+			std::shared_ptr<DB::Account> a = db->findAccount(id);
+			if (a) s += a->preview();
 		}
 	}
-	else
+	else if (u.role == DB::ROLE_EMPLOYEE)
 	{
-		int j = db->Employees.find(user);
-		if (j != -1)
+		std::shared_ptr<DB::ReadView> view = db->readView(); //one consistent bank, without holding up postings
+		db->forEachAccount([&](std::shared_ptr<DB::Account> a)
 		{
-			for (int j = 0; j < db->Accounts.getCount(); j++)
-			{
-				s += accountDisplay(user, db->Accounts.get(j)->ID);
-			}
-		}
+			std::shared_ptr<const DB::AccountVersion> v = view->at(*a);
+			if (v) s += a->preview(*v); //accounts opened after the view aren't in it
+			return true;
+		});
 	}
 
 	return s;
@@ -330,30 +391,24 @@ std::string Server::accountsDisplay(std::string user)
 /// <summary>
 /// list of account transactions
 /// </summary>
-/// <param name="user">user to check against</param>
+/// <param name="token">session to check against</param>
 /// <param name="acc">account to get</param>
 /// <returns>list of all transactions, string</returns>
-std::string Server::accountTransactions(std::string user, std::string acc)
+std::string Server::accountTransactions(std::string token, std::string acc)
 {
-	int i = db->Customers.find(user); //get user 
-	if (i != -1)
+	DB::DirectoryEntry u = db->findUser(session(token).user); //get user 
+	if (u.role == DB::ROLE_CUSTOMER)
 	{
-		std::shared_ptr<DB::Customer> c = db->Customers.get(i);
-		if (c && c->AccountIDs.find(acc) >= 0)
+		if (db->owns(u.customer(), acc))
 		{
-			int z = db->Accounts.find(acc);
-			std::shared_ptr<DB::Account> a = db->Accounts.get(z);
+			std::shared_ptr<DB::Account> a = db->findAccount(acc);
 			if (a) return a->transactionHistory();
 		}
 	}
-	else
+	else if (u.role == DB::ROLE_EMPLOYEE)
 	{
-		int j = db->Employees.find(user);
-		if (j != -1)
-		{
-			int k = db->Accounts.find(acc);
-			if (k != -1) return db->Accounts.get(k)->transactionHistory();
-		}
+		std::shared_ptr<DB::Account> a = db->findAccount(acc);
+		if (a) return a->transactionHistory();
 	}
 
 	return "";
@@ -362,26 +417,130 @@ std::string Server::accountTransactions(std::string user, std::string acc)
 /// <summary>
 /// Purchases
 /// </summary>
+/// <param name="token">employee's session</param>
 /// <param name="user">user</param>
 /// <param name="acc">account</param>
 /// <param name="val">purchase value</param>
 /// <param name="name">Purchase information</param>
 /// <param name="origin">Purchase origin</param>
 /// <returns>were we successful, bool</returns>
-bool Server::purchase(std::string user, std::string acc, double val, std::string name, std::string origin)
+bool Server::purchase(std::string token, std::string user, std::string acc, double val, std::string name, std::string origin)
 {
 	bool b = false;
-	int i = db->Customers.find(user); //make sure user exists
-	if (i != -1)
+	if (session(token).role != DB::ROLE_EMPLOYEE) return b;
+	if (db->findCustomer(user)) //make sure user exists
 	{
 		b = db->purchase(acc, user, val, db, name, origin); //pass purchase to DB (has its own function for overdraft)
 	}
 	return b;
 }
 /// <summary>
-/// runs the bank processes
+/// Posts a card settlement file, one purchase per line: user,account,amount[,name[,origin]]. Lines that don't parse are skipped
+/// </summary>
+/// <param name="token">employee's session</param>
+/// <param name="path">settlement file</param>
+/// <returns>rows posted, -1 if the file can't be opened or it's not an employee</returns>
+int Server::purchaseBatch(std::string token, std::string path)
+{
+	if (session(token).role != DB::ROLE_EMPLOYEE) return -1;
+	std::ifstream in(path);
+	if (!in) return -1;
+	std::vector<DB::PurchaseRow> rows;
+	std::string line;
+	while (std::getline(in, line))
+	{
+		if (!line.empty() && line.back() == '\r') line.pop_back(); //files from Windows
+		std::vector<std::string> fields;
+		size_t start = 0;
+		while (fields.size() < 4) //name & origin are the last two, the origin keeps any commas it has
+		{
+			size_t comma = line.find(',', start);
+			if (comma == std::string::npos) break;
+			fields.push_back(line.substr(start, comma - start));
+			start = comma + 1;
+		}
+		fields.push_back(line.substr(start));
+		if (fields.size() < 3) continue;
+
+		DB::PurchaseRow r;
+		r.user = fields[0];
+		r.account = fields[1];
+		try
+		{
+			r.val = std::stod(fields[2]);
+		}
+		catch (std::exception&)
+		{
+			continue; //header line or a bad amount
+		}
+		if (fields.size() > 3) r.name = fields[3];
+		if (fields.size() > 4) r.origin = fields[4];
+		rows.push_back(r);
+	}
+	return db->purchaseBatch(rows, db);
+}
+
+/// <summary>
+/// loads a migrated portfolio (see BulkLoader for the format). The loader doesn't write the log, so a snapshot is taken straight after
+/// </summary>
+/// <param name="token">employee's session</param>
+/// <param name="path">file to load</param>
+/// <returns>accounts loaded, -1 if the file couldn't be read, the snapshot failed or it's not an employee</returns>
+int Server::bulkLoad(std::string token, std::string path)
+{
+	if (session(token).role != DB::ROLE_EMPLOYEE) return -1;
+	try
+	{
+		DB::BulkLoadResult r = DB::BulkLoader(*db, db->Workers).load(path);
+		if (!db->saveSnapshot("BankSnapshot.dat"))
+		{
+			//nothing else has the loaded accounts; a restart would drop them & every posting made to them since
+			std::cout << "Loaded " << r.accounts << " accounts, but they aren't saved; take a snapshot before relying on them\n";
+			return -1;
+		}
+		return r.accounts;
+	}
+	catch (DB::ExBulkLoad& e)
+	{
+		e.printError();
+		return -1;
+	}
+}
+
+/// <summary>
+/// totals the bank's transactions, like purchases by origin this month or interest paid per product; employees only. History
+/// older than a year is compacted, so counts, mins & maxes reaching back that far are of its summaries
+/// </summary>
+/// <param name="token">employee's session</param>
+/// <param name="type">transaction type to total, like Purchase; empty for all</param>
+/// <param name="groupBy">origin, name, type, account, product or accounttype; anything else gives one total</param>
+/// <param name="days">how far back to look</param>
+/// <returns>one line per group: key : count : sum : min : max, empty if not an employee</returns>
+std::string Server::transactionReport(std::string token, std::string type, std::string groupBy, int days)
+{
+	if (session(token).role != DB::ROLE_EMPLOYEE) return "";
+	DB::TransactionQuery q;
+	q.type = type;
+	q.from = db->now() - std::chrono::hours(24) * days;
+	if (groupBy == "origin") q.group = DB::TransactionQuery::ORIGIN;
+	else if (groupBy == "name") q.group = DB::TransactionQuery::NAME;
+	else if (groupBy == "type") q.group = DB::TransactionQuery::TYPE;
+	else if (groupBy == "account") q.group = DB::TransactionQuery::ACCOUNT;
+	else if (groupBy == "product") q.group = DB::TransactionQuery::PRODUCT;
+	else if (groupBy == "accounttype") q.group = DB::TransactionQuery::ACCOUNT_TYPE;
+	return DB::QueryEngine::format(DB::QueryEngine(*db, db->Workers).run(q));
+}
+
+/// <summary>
+/// runs the bank processes; employees only
 /// </summary>
-void Server::runBankProccesses()
+/// <param name="token">employee's session</param>
+/// <returns>were they run, bool</returns>
+bool Server::runBankProccesses(std::string token)
 {
+	if (session(token).role != DB::ROLE_EMPLOYEE) return false;
 	db->bankProcesses(); //uses the database bank processes function
+	db->compactHistory(db->now() - std::chrono::hours(24 * 365)); //history older than a year is kept as one summary per 30 days
+	db->saveSnapshot("BankSnapshot.dat"); //periodic snapshot, so startup doesn't replay the whole log
+	return true;
 }
\ No newline at end of file
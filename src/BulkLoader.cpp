@@ -0,0 +1,368 @@
+#include "BankDB.h"
+#include <fstream>
+#include <string_view>
+
+using namespace DB;
+
+namespace
+{
+	/// <summary>
+	/// what one slice of a chunk parsed into, in file order
+	/// </summary>
+	struct Parsed
+	{
+		std::vector<std::shared_ptr<Customer>> customers;
+		std::vector<std::pair<std::shared_ptr<Account>, std::string>> accounts; //account & owner name
+		std::vector<std::pair<std::string, std::shared_ptr<Transaction>>> postings; //account ID & transaction
+		long long rejected = 0;
+	};
+
+	/// <summary>
+	/// parses dollars like -12.34 into cents without going through floating point
+	/// </summary>
+	/// <param name="s">text</param>
+	/// <param name="cents">set to the amount</param>
+	/// <returns>was it a number, bool</returns>
+	bool parseCents(std::string_view s, int& cents)
+	{
+		size_t i = 0;
+		bool negative = false;
+		if (i < s.size() && (s[i] == '-' || s[i] == '+')) negative = s[i++] == '-';
+		long long whole = 0;
+		int digits = 0;
+		while (i < s.size() && s[i] >= '0' && s[i] <= '9')
+		{
+			whole = whole * 10 + (s[i++] - '0');
+			digits++;
+		}
+		int frac = 0;
+		if (i < s.size() && s[i] == '.')
+		{
+			i++;
+			for (int k = 0; k < 2; k++) //cents; anything past that is dropped
+			{
+				frac *= 10;
+				if (i < s.size() && s[i] >= '0' && s[i] <= '9')
+				{
+					frac += s[i++] - '0';
+					digits++;
+				}
+			}
+			while (i < s.size() && s[i] >= '0' && s[i] <= '9') i++;
+		}
+		if (digits == 0 || i != s.size() || whole > 20000000) return false; //must fit in cents
+		cents = (int)(whole * 100 + frac) * (negative ? -1 : 1);
+		return true;
+	}
+
+	//parses a whole number, false if it isn't one
+	bool parseInt(std::string_view s, long long& v)
+	{
+		if (s.empty()) return false;
+		size_t i = s[0] == '-' ? 1 : 0;
+		if (i == s.size()) return false;
+		v = 0;
+		for (; i < s.size(); i++)
+		{
+			if (s[i] < '0' || s[i] > '9') return false;
+			v = v * 10 + (s[i] - '0');
+		}
+		if (s[0] == '-') v = -v;
+		return true;
+	}
+
+	/// <summary>
+	/// splits a line into fields by the layout
+	/// </summary>
+	/// <param name="line">the line</param>
+	/// <param name="layout">delimiter or widths</param>
+	/// <param name="fields">filled with views into the line</param>
+	void split(std::string_view line, const BulkLayout& layout, std::vector<std::string_view>& fields)
+	{
+		fields.clear();
+		if (layout.widths.empty())
+		{
+			size_t start = 0;
+			while (true)
+			{
+				size_t end = line.find(layout.delimiter, start);
+				if (end == std::string_view::npos)
+				{
+					fields.push_back(line.substr(start));
+					return;
+				}
+				fields.push_back(line.substr(start, end - start));
+				start = end + 1;
+			}
+		}
+		size_t at = 0;
+		for (int w : layout.widths)
+		{
+			if (at >= line.size()) return;
+			std::string_view f = line.substr(at, w);
+			while (!f.empty() && f.back() == ' ') f.remove_suffix(1);
+			fields.push_back(f);
+			at += w;
+		}
+	}
+
+	/// <summary>
+	/// parses one line into out; postings without a time of their own are stamped with now
+	/// </summary>
+	void parseLine(std::string_view line, const BulkLayout& layout, std::vector<std::string_view>& f, Parsed& out, Arena* arena, std::chrono::system_clock::time_point now)
+	{
+		if (!line.empty() && line.back() == '\r') line.remove_suffix(1); //files from Windows
+		if (line.empty()) return;
+		split(line, layout, f);
+		int cents = 0;
+		long long n = 0;
+		switch (f[0].empty() ? ' ' : f[0][0])
+		{
+			case 'C':
+				if (f.size() < 3 || f[1].empty()) break;
+				out.customers.push_back(arenaShared<Customer>(arena, std::string(f[1]), std::string(f[2])));
+				return;
+			case 'A':
+			{
+				long long type = 0;
+				if (f.size() < 6 || f[1].empty() || !parseInt(f[3], type) || !parseInt(f[4], n) || !parseCents(f[5], cents)) break;
+				if (type < 0 || type > UINT8_MAX) break; //not a type code at all
+				std::shared_ptr<Transaction> first = arenaShared<Deposit>(arena, USDollar(cents), "Bank", now);
+				std::shared_ptr<Account> a = makeAccount((std::uint8_t)type, first, std::string(f[1]), arena);
+				if (!a) break; //no such type
+				a->setInterestType((int)n);
+				out.accounts.push_back(std::make_pair(a, std::string(f[2])));
+				return;
+			}
+			case 'T':
+			{
+				if (f.size() < 6 || f[1].empty() || f[2].empty() || !parseCents(f[3], cents)) break;
+				std::chrono::system_clock::time_point ts = now;
+				if (f.size() > 6 && !f[6].empty())
+				{
+					if (!parseInt(f[6], n)) break;
+					ts = std::chrono::system_clock::time_point(std::chrono::seconds(n));
+				}
+				std::string name(f[4]);
+				std::string origin(f[5]);
+				std::shared_ptr<Transaction> t;
+				switch (f[2][0])
+				{
+					case 'P':
+						t = arenaShared<Purchase>(arena, USDollar(cents), name, origin, ts);
+						break;
+					case 'T':
+						t = arenaShared<Transfer>(arena, USDollar(cents), name, ts);
+						break;
+					case 'D':
+						t = arenaShared<Deposit>(arena, USDollar(cents), origin, ts);
+						break;
+					case 'B':
+						t = arenaShared<BankFunction>(arena, USDollar(cents), name, ts);
+						break;
+					default:
+						break;
+				}
+				if (!t || t->Val == USDollar(0)) break;
+				t->Name = name;
+				t->Origin = origin;
+				out.postings.push_back(std::make_pair(std::string(f[1]), t));
+				return;
+			}
+			default:
+				break;
+		}
+		out.rejected++;
+	}
+}
+
+/// <summary>
+/// Loads a file chunk by chunk; a chunk ends at its last full line & the rest carries into the next
+/// </summary>
+/// <param name="path">file to load</param>
+/// <param name="layout">how fields are split</param>
+/// <returns>what was loaded</returns>
+BulkLoadResult BulkLoader::load(std::string path, BulkLayout layout)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in) throw ExBulkLoad("BulkLoader::load");
+	BulkLoadResult total;
+	std::string chunk;
+	std::string carry;
+	std::vector<char> buffer(chunkBytes);
+	while (in)
+	{
+		in.read(buffer.data(), buffer.size());
+		std::streamsize got = in.gcount();
+		if (got <= 0) break;
+		chunk.swap(carry);
+		chunk.append(buffer.data(), (size_t)got);
+		size_t end = chunk.rfind('\n');
+		if (end == std::string::npos)
+		{
+			carry.swap(chunk); //one line longer than a chunk, keep reading
+			chunk.clear();
+			continue;
+		}
+		carry.assign(chunk, end + 1, std::string::npos);
+		chunk.resize(end + 1);
+		BulkLoadResult r = loadText(chunk, layout);
+		total.customers += r.customers;
+		total.accounts += r.accounts;
+		total.transactions += r.transactions;
+		total.rejected += r.rejected;
+	}
+	if (!carry.empty()) //last line with no newline
+	{
+		BulkLoadResult r = loadText(carry, layout);
+		total.customers += r.customers;
+		total.accounts += r.accounts;
+		total.transactions += r.transactions;
+		total.rejected += r.rejected;
+	}
+	return total;
+}
+
+/// <summary>
+/// Parses & applies a block of whole lines. Parsing is split into slices on line boundaries; customers & accounts then go in under
+/// every shard's lock, in file order, & transactions are handed to one task per shard
+/// </summary>
+/// <param name="text">whole lines</param>
+/// <param name="layout">how fields are split</param>
+/// <returns>what was loaded</returns>
+BulkLoadResult BulkLoader::loadText(const std::string& text, BulkLayout layout)
+{
+	BulkLoadResult result;
+	//cut into slices that end on a newline
+	int slices = pool ? pool->size() * 2 : 1;
+	std::vector<size_t> bounds(1, 0);
+	for (int i = 1; i < slices; i++)
+	{
+		size_t at = text.find('\n', text.size() * i / slices);
+		if (at == std::string::npos) break;
+		if (at + 1 > bounds.back()) bounds.push_back(at + 1);
+	}
+	bounds.push_back(text.size());
+	std::vector<Parsed> parsed(bounds.size() - 1);
+	std::chrono::system_clock::time_point now = db.now(); //the bank's clock, read once for the whole file
+	auto parseSlice = [&](int s)
+	{
+		std::vector<std::string_view> fields;
+		std::string_view all(text);
+		size_t at = bounds[s];
+		while (at < bounds[s + 1])
+		{
+			size_t end = all.find('\n', at);
+			if (end == std::string_view::npos || end > bounds[s + 1]) end = bounds[s + 1];
+			parseLine(all.substr(at, end - at), layout, fields, parsed[s], db.Memory.get(), now);
+			at = end + 1;
+		}
+	};
+	if (pool && parsed.size() > 1) pool->parallelFor((int)parsed.size(), parseSlice);
+	else for (size_t s = 0; s < parsed.size(); s++) parseSlice((int)s);
+
+	//customers & accounts, straight into the shards; the hash indices are the only duplicate check
+	{
+		std::shared_lock<std::shared_mutex> settings(db.Catalog);
+		std::vector<std::unique_lock<std::shared_mutex>> shards;
+		for (std::shared_ptr<Shard>& sh : db.Shards) shards.push_back(std::unique_lock<std::shared_mutex>(sh->Catalog));
+		for (Parsed& p : parsed)
+		{
+			for (std::shared_ptr<Customer>& c : p.customers)
+			{
+				Shard& sh = db.shardFor(c->name);
+				if (sh.Directory.count(c->name))
+				{
+					result.rejected++;
+					continue;
+				}
+				c->AccountIDs.setArena(db.Memory);
+				sh.Customers.put(c);
+				sh.Directory[c->name] = DirectoryEntry{ ROLE_CUSTOMER, c };
+				result.customers++;
+			}
+			for (std::pair<std::shared_ptr<Account>, std::string>& na : p.accounts)
+			{
+				std::shared_ptr<Account>& a = na.first;
+				Shard& sh = db.shardFor(a->ID);
+				std::shared_ptr<Customer> owner;
+				if (!na.second.empty())
+				{
+					Shard& os = db.shardFor(na.second);
+					std::unordered_map<std::string, DirectoryEntry>::iterator it = os.Directory.find(na.second);
+					if (it != os.Directory.end()) owner = it->second.customer();
+				}
+				if (sh.AccountIndex.count(a->ID) || (!na.second.empty() && !owner)) //taken, or an owner we've never seen
+				{
+					result.rejected++;
+					continue;
+				}
+				a->Archive = db.Archive;
+				a->HotWindow = db.HotWindow;
+				a->Log = db.Log;
+				a->setArena(db.Memory);
+				sh.Accounts.put(a);
+				sh.AccountIndex[a->ID] = a;
+				if (owner)
+				{
+					owner->AccountIDs.put(arenaShared<std::string>(db.Memory.get(), a->ID));
+					sh.Owners[a->ID].push_back(owner->name);
+				}
+				a->Indices = sh.Indices;
+				sh.Indices->add(a);
+				db.publishFirst(a);
+				a->Scheduler = db.Schedule;
+				a->Time = db.Time;
+				a->startClock();
+				db.Schedule->schedule(a);
+				result.accounts++;
+			}
+			result.rejected += p.rejected;
+		}
+	}
+
+	//transactions, one task per shard; each account gets its whole share of the chunk at once
+	std::vector<long long> applied(db.Shards.size(), 0);
+	std::vector<long long> missing(db.Shards.size(), 0);
+	auto applyShard = [&](int s)
+	{
+		Shard& sh = *db.Shards[s];
+		std::unordered_map<std::string, size_t> slot; //account ID to its place in batches
+		std::vector<std::pair<std::shared_ptr<Account>, std::vector<std::shared_ptr<Transaction>>>> batches;
+		{
+			std::shared_lock<std::shared_mutex> guard(sh.Catalog);
+			for (Parsed& p : parsed)
+			{
+				for (std::pair<std::string, std::shared_ptr<Transaction>>& post : p.postings)
+				{
+					if (&db.shardFor(post.first) != &sh) continue;
+					std::unordered_map<std::string, size_t>::iterator it = slot.find(post.first);
+					if (it == slot.end())
+					{
+						std::unordered_map<std::string, std::shared_ptr<Account>>::iterator acc = sh.AccountIndex.find(post.first);
+						if (acc == sh.AccountIndex.end())
+						{
+							missing[s]++;
+							continue;
+						}
+						it = slot.emplace(post.first, batches.size()).first;
+						batches.push_back(std::make_pair(acc->second, std::vector<std::shared_ptr<Transaction>>()));
+					}
+					batches[it->second].second.push_back(post.second);
+				}
+			}
+		}
+		for (std::pair<std::shared_ptr<Account>, std::vector<std::shared_ptr<Transaction>>>& b : batches)
+		{
+			applied[s] += b.first->appendHistory(b.second);
+		}
+	};
+	if (pool && db.Shards.size() > 1) pool->parallelFor((int)db.Shards.size(), applyShard);
+	else for (size_t s = 0; s < db.Shards.size(); s++) applyShard((int)s);
+	for (size_t s = 0; s < db.Shards.size(); s++)
+	{
+		result.transactions += applied[s];
+		result.rejected += missing[s];
+	}
+	return result;
+}
@@ -0,0 +1,312 @@
+#include "InterestEngine.h"
+
+using namespace DB;
+
+//due flags
+static const std::uint8_t DUE_ACCRUE = 1;
+static const std::uint8_t DUE_PAYOUT = 2;
+
+/// <summary>
+/// a product's due checks, worked out once per product. "More than H whole hours have passed" is the same as "at least H+1
+/// hours of ticks", so each check is a single subtraction & compare
+/// </summary>
+struct DueRule
+{
+	std::uint8_t accrues; //1 if the product accrues at all
+	std::uint8_t pays; //1 if its payouts are at least a cent
+	std::int64_t accrueAfter; //ticks since LastInterest before an accrual is due
+	std::int64_t payAfter; //ticks since LastPayout before a payout is due
+	std::int64_t period; //ticks in one accrual period
+};
+
+/// <summary>
+/// builds the due checks for a product
+/// </summary>
+/// <param name="p">interest product</param>
+/// <returns>its rule</returns>
+static DueRule dueRule(const InterestProduct& p)
+{
+	const std::int64_t hour = std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::hours(1)).count();
+	DueRule r;
+	r.accrues = p.accrualHours > 0 ? 1 : 0;
+	r.pays = p.payoutCents >= 1 ? 1 : 0; //payouts under a cent never post
+	r.accrueAfter = (std::int64_t)(p.accrualHours + 1) * hour;
+	r.payAfter = (std::int64_t)(p.payoutHours + 1) * hour;
+	r.period = (std::int64_t)p.accrualHours * hour;
+	return r;
+}
+
+/// <summary>
+/// what one account has due; the same check for the column loop & for an account rechecked at scatter
+/// </summary>
+/// <param name="r">the product's rule</param>
+/// <param name="p">the product</param>
+/// <param name="balance">balance in cents</param>
+/// <param name="lastInterest">LastInterest ticks</param>
+/// <param name="lastPayout">LastPayout ticks</param>
+/// <param name="blocked">1 if payouts are blocked (certificates)</param>
+/// <param name="nowTicks">time to run interest as of</param>
+/// <param name="accrual">set to the cents to accrue, every missed period at once</param>
+/// <returns>due flags</returns>
+static inline std::uint8_t dueFor(const DueRule& r, const InterestProduct& p, std::int32_t balance, std::int64_t lastInterest, std::int64_t lastPayout,
+	std::uint8_t blocked, std::int64_t nowTicks, std::int32_t& accrual)
+{
+	std::uint8_t a = r.accrues & (std::uint8_t)(nowTicks - lastInterest >= r.accrueAfter);
+	std::uint8_t py = r.pays & (std::uint8_t)(nowTicks - lastPayout >= r.payAfter) & (std::uint8_t)(blocked ^ 1);
+	accrual = a ? (std::int32_t)accrualCents(balance, p, accruablePeriods(balance, p, (nowTicks - lastInterest) / r.period)) : 0;
+	return a | (std::uint8_t)(py << 1);
+}
+
+/// <summary>
+/// Goes through & handles interest for all accounts; same results as calling Interest::IndividualAccount on each
+/// </summary>
+/// <param name="accs">list of accounts to go through</param>
+/// <returns>accounts changed</returns>
+int Interest::AllAccounts(LinkedList<Account> accs)
+{
+	InterestBatch batch;
+	std::shared_ptr<Account> first = accs.getCount() ? accs.get(0) : nullptr;
+	return batch.run(accs, first ? first->now() : std::chrono::system_clock::now()); //a list is one bank's accounts, so one clock
+}
+
+/// <summary>
+/// partitioned interest run over every account
+/// </summary>
+/// <param name="accs">list of accounts to go through</param>
+/// <param name="pool">threads to use</param>
+/// <returns>accounts changed</returns>
+int Interest::AllAccounts(LinkedList<Account> accs, std::shared_ptr<ThreadPool> pool)
+{
+	if (!pool || pool->size() < 2) return AllAccounts(accs);
+
+	//flatten once so partitions can be cut by index
+	std::vector<std::shared_ptr<Account>> all;
+	all.reserve(accs.getCount());
+	accs.forEach([&](std::shared_ptr<Account> a)
+	{
+		all.push_back(a);
+		return true;
+	});
+	return Batch(all, pool, all.empty() ? std::chrono::system_clock::now() : all[0]->now());
+}
+
+/// <summary>
+/// interest for a set of accounts; with a pool, each partition gets its own batch & result slot, merged in partition order
+/// </summary>
+/// <param name="accs">accounts to go through</param>
+/// <param name="pool">threads to use, may be null</param>
+/// <param name="now">time to run interest as of; every partition uses the same one</param>
+/// <returns>accounts changed</returns>
+int Interest::Batch(std::vector<std::shared_ptr<Account>>& accs, std::shared_ptr<ThreadPool> pool, std::chrono::system_clock::time_point now)
+{
+	if (accs.empty()) return 0;
+	int parts = pool ? pool->size() * 4 : 1; //a few partitions per thread evens out uneven ones
+	if (parts > (int)accs.size()) parts = (int)accs.size();
+	std::vector<int> changed(parts, 0); //per partition results
+	auto partition = [&](int part)
+	{
+		size_t begin = accs.size() * part / parts;
+		size_t end = accs.size() * (part + 1) / parts;
+		InterestBatch batch;
+		for (size_t i = begin; i < end; i++) batch.gather(accs[i]);
+		batch.compute(now);
+		changed[part] = batch.scatter(now);
+	};
+	if (parts > 1) pool->parallelFor(parts, partition);
+	else partition(0);
+
+	int total = 0;
+	for (int c : changed) total += c; //merge in partition order
+	return total;
+}
+
+/// <summary>
+/// Constructor; one empty column group per product
+/// </summary>
+InterestBatch::InterestBatch()
+{
+	groups = std::vector<Columns>(InterestProductCount);
+}
+
+/// <summary>
+/// copies an account's interest fields into its product's columns
+/// </summary>
+/// <param name="acc">account to gather</param>
+void InterestBatch::gather(std::shared_ptr<Account> acc)
+{
+	if (!acc) return;
+	std::lock_guard<std::recursive_mutex> guard(acc->Lock);
+	Columns& g = groups[acc->product().id];
+	g.accounts.push_back(acc);
+	g.balance.push_back(acc->balance.getValue());
+	g.lastInterest.push_back(acc->LastInterest.time_since_epoch().count());
+	g.lastPayout.push_back(acc->LastPayout.time_since_epoch().count());
+	g.payoutBlocked.push_back(dynamic_cast<CertOfDep*>(acc.get()) ? 1 : 0);
+	count++;
+}
+
+/// <summary>
+/// gathers every account in a list
+/// </summary>
+/// <param name="accs">accounts</param>
+void InterestBatch::gather(LinkedList<Account>& accs)
+{
+	accs.forEach([&](std::shared_ptr<Account> a)
+	{
+		gather(a);
+		return true;
+	});
+}
+
+/// <summary>
+/// works out accruals & payouts due, see dueFor. Accounts that missed several periods accrue all of them here, see accrualCents
+/// </summary>
+/// <param name="now">time to run interest as of</param>
+void InterestBatch::compute(std::chrono::system_clock::time_point now)
+{
+	const std::int64_t nowTicks = now.time_since_epoch().count();
+	for (int id = 0; id < (int)groups.size(); id++)
+	{
+		Columns& g = groups[id];
+		const InterestProduct& p = getProduct(id);
+		const DueRule rule = dueRule(p);
+
+		const size_t n = g.balance.size();
+		g.accrual.resize(n);
+		g.due.resize(n);
+		const std::int32_t* balance = g.balance.data();
+		const std::int64_t* lastInterest = g.lastInterest.data();
+		const std::int64_t* lastPayout = g.lastPayout.data();
+		const std::uint8_t* blocked = g.payoutBlocked.data();
+		std::int32_t* accrual = g.accrual.data();
+		std::uint8_t* due = g.due.data();
+		for (size_t i = 0; i < n; i++)
+		{
+			due[i] = dueFor(rule, p, balance[i], lastInterest[i], lastPayout[i], blocked[i], nowTicks, accrual[i]);
+		}
+	}
+}
+
+/// <summary>
+/// Writes accruals & payouts back to the accounts that have any. Accounts aren't held between gather & scatter, so each one is
+/// checked again under its lock; if a posting, a product change or another interest run moved it in between, what it has due
+/// is worked out again from what it holds now rather than written over it. Like any other posting, a change is logged before
+/// it's made: every account's payout & interest state are queued first, one sync makes them all durable, & only then are they
+/// made. If the sync fails none of them are
+/// </summary>
+/// <param name="now">time to run interest as of; LastInterest & LastPayout move on by whole periods</param>
+/// <returns>accounts changed</returns>
+int InterestBatch::scatter(std::chrono::system_clock::time_point now)
+{
+	/// <summary>
+	/// one account's change, worked out & queued under its lock, made once the log has it
+	/// </summary>
+	struct Change
+	{
+		std::shared_ptr<Account> acc;
+		std::chrono::system_clock::time_point fromInterest, fromPayout; //what it was worked out from
+		std::int32_t soFar; //interest accrued afterwards, cents
+		std::chrono::system_clock::time_point lastInterest, lastPayout; //afterwards
+		std::shared_ptr<Transaction> pay; //payout posting, null for none
+		std::uint64_t seq; //its interest record, 0 with no log
+	};
+	std::vector<Change> changes;
+	const std::int64_t nowTicks = now.time_since_epoch().count();
+	std::shared_ptr<WriteAheadLog> log; //log the accounts write to, if any
+	std::uint64_t logged = 0; //newest record queued
+	bool durable = true;
+	for (int id = 0; id < (int)groups.size() && durable; id++)
+	{
+		Columns& g = groups[id];
+		for (size_t i = 0; i < g.due.size() && durable; i++)
+		{
+			if (!g.due[i]) continue;
+			std::shared_ptr<Account> acc = g.accounts[i];
+			std::lock_guard<std::recursive_mutex> guard(acc->Lock);
+			if (acc->InterestInFlight) continue; //another run's change is waiting on its sync
+			const InterestProduct& p = acc->product();
+			std::uint8_t due = g.due[i];
+			std::int32_t accrual = g.accrual[i];
+			if (p.id != id || acc->balance.getValue() != g.balance[i] || acc->LastInterest.time_since_epoch().count() != g.lastInterest[i]
+				|| acc->LastPayout.time_since_epoch().count() != g.lastPayout[i]) //changed since gather
+			{
+				due = dueFor(dueRule(p), p, acc->balance.getValue(), acc->LastInterest.time_since_epoch().count(),
+					acc->LastPayout.time_since_epoch().count(), g.payoutBlocked[i], nowTicks, accrual);
+				if (!due) continue;
+			}
+			Change c{ acc, acc->LastInterest, acc->LastPayout, acc->interestSoFar.getValue(), acc->LastInterest, acc->LastPayout, nullptr, 0 };
+			if (due & DUE_ACCRUE)
+			{
+				//move on by the periods accrued, not to now, so the part period left over isn't lost
+				std::chrono::hours period(p.accrualHours);
+				c.soFar += accrual;
+				c.lastInterest = acc->LastInterest + period * accruablePeriods(acc->balance.getValue(), p, (now - acc->LastInterest) / period);
+			}
+			if (due & DUE_PAYOUT)
+			{
+				//every payout missed since the last one, in one posting; the part period left over counts toward the next
+				std::chrono::hours period(p.payoutHours);
+				std::int64_t periods = payablePeriods(p, (now - acc->LastPayout) / period);
+				c.pay = acc->makeTransaction<BankFunction>(USDollar((int)(periods * p.payoutCents)), "Interest payout", now);
+				c.lastPayout = acc->LastPayout + period * periods;
+			}
+			if (acc->Log) //queued rather than journaled, so the batch shares one sync instead of waiting account by account
+			{
+				try
+				{
+					std::uint64_t first = 0;
+					if (c.pay) first = acc->Log->enqueue(WriteAheadLog::postingRecord(acc->ID, *c.pay));
+					c.seq = acc->Log->enqueue(WriteAheadLog::interestRecord(acc->ID, c.soFar, c.lastInterest, c.lastPayout));
+					acc->InterestInFlight = first ? first : c.seq;
+					logged = c.seq;
+					log = acc->Log;
+				}
+				catch (Exception& ex)
+				{
+					ex.printError();
+					durable = false; //part of the run may be queued; make none of it
+					continue;
+				}
+			}
+			changes.push_back(c);
+		}
+	}
+	try
+	{
+		if (log) log->waitDurable(logged);
+	}
+	catch (Exception& ex)
+	{
+		ex.printError();
+		durable = false;
+	}
+
+	int changed = 0;
+	for (Change& c : changes)
+	{
+		Account& acc = *c.acc;
+		std::lock_guard<std::recursive_mutex> guard(acc.Lock);
+		acc.InterestInFlight = 0;
+		if (!durable) continue;
+		if (acc.LastInterest != c.fromInterest || acc.LastPayout != c.fromPayout) continue; //moved without us; nothing else should
+		acc.interestSoFar = USDollar(c.soFar);
+		acc.LastInterest = c.lastInterest;
+		if (c.pay && acc.applyLogged(c.pay)) acc.LastPayout = c.lastPayout;
+		if (c.seq > acc.LoggedSeq) acc.LoggedSeq = c.seq;
+		changed++;
+	}
+	return changed;
+}
+
+/// <summary>
+/// gather, compute & scatter in one go
+/// </summary>
+/// <param name="accs">accounts</param>
+/// <param name="now">time to run interest as of</param>
+/// <returns>accounts changed</returns>
+int InterestBatch::run(LinkedList<Account>& accs, std::chrono::system_clock::time_point now)
+{
+	gather(accs);
+	compute(now);
+	return scatter(now);
+}
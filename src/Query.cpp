@@ -0,0 +1,144 @@
+#include "BankDB.h"
+#include <algorithm>
+
+using namespace DB;
+
+namespace
+{
+	//adds one value to a group
+	void addTo(QueryRow& r, int v)
+	{
+		if (r.count == 0 || v < r.min) r.min = v;
+		if (r.count == 0 || v > r.max) r.max = v;
+		r.count++;
+		r.sum += v;
+	}
+
+	//folds one group into another
+	void merge(QueryRow& into, const QueryRow& r)
+	{
+		if (r.count == 0) return;
+		if (into.count == 0 || r.min < into.min) into.min = r.min;
+		if (into.count == 0 || r.max > into.max) into.max = r.max;
+		into.count += r.count;
+		into.sum += r.sum;
+	}
+
+	//cents as dollars, like -$12.34; sums can outgrow USDollar's int
+	std::string dollars(long long cents)
+	{
+		long long v = cents < 0 ? -cents : cents;
+		std::string c = std::to_string(v % 100);
+		return std::string(cents < 0 ? "-$" : "$") + std::to_string(v / 100) + (c.size() < 2 ? ".0" : ".") + c;
+	}
+
+	//does a transaction pass the transaction-level filters
+	bool matches(const TransactionQuery& q, Transaction& t)
+	{
+		if (t.Timestamp < q.from || t.Timestamp >= q.to) return false;
+		int v = t.Val.getValue();
+		if ((q.sign > 0 && v <= 0) || (q.sign < 0 && v >= 0)) return false;
+		if (!q.name.empty() && t.Name != q.name) return false;
+		if (!q.origin.empty() && t.Origin != q.origin) return false;
+		return q.type.empty() || t.TransactionType() == q.type;
+	}
+}
+
+/// <summary>
+/// Runs a query over the whole bank. A shard's candidate accounts are listed under its lock, then each is scanned under its own
+/// lock only, so postings elsewhere carry on while the report runs
+/// </summary>
+/// <param name="q">the query</param>
+/// <returns>one row per group, sorted by key; no rows if nothing matched</returns>
+std::vector<QueryRow> QueryEngine::run(const TransactionQuery& q)
+{
+	std::vector<std::unordered_map<std::string, QueryRow>> partial(db.Shards.size());
+	auto scanShard = [&](int s)
+	{
+		Shard& sh = *db.Shards[s];
+		std::vector<std::shared_ptr<Account>> accounts;
+		if (q.accountType >= 0 || q.product >= 0) accounts = sh.Indices->find(q.accountType, q.product, false);
+		else
+		{
+			std::shared_lock<std::shared_mutex> guard(sh.Catalog);
+			accounts.reserve(sh.AccountIndex.size());
+			sh.Accounts.forEach([&](std::shared_ptr<Account> a)
+			{
+				accounts.push_back(a);
+				return true;
+			});
+		}
+		std::unordered_map<std::string, QueryRow>& groups = partial[s];
+		for (std::shared_ptr<Account>& a : accounts)
+		{
+			std::lock_guard<std::recursive_mutex> held(a->Lock);
+			//account-level keys are the same for every transaction, so they're worked out once
+			std::string accountKey;
+			if (q.group == TransactionQuery::ACCOUNT) accountKey = a->ID;
+			else if (q.group == TransactionQuery::PRODUCT) accountKey = std::to_string(a->ProductID);
+			else if (q.group == TransactionQuery::ACCOUNT_TYPE) accountKey = a->getType();
+			QueryRow* accountRow = nullptr; //that key's group, once it has one
+			auto visit = [&](std::shared_ptr<Transaction> t)
+			{
+				if (!t || !matches(q, *t)) return true;
+				int v = t->Val.getValue();
+				switch (q.group)
+				{
+					case TransactionQuery::ORIGIN:
+						addTo(groups[t->Origin], v);
+						break;
+					case TransactionQuery::NAME:
+						addTo(groups[t->Name], v);
+						break;
+					case TransactionQuery::TYPE:
+						addTo(groups[t->TransactionType()], v);
+						break;
+					default:
+						if (!accountRow) accountRow = &groups[accountKey];
+						addTo(*accountRow, v);
+						break;
+				}
+				return true;
+			};
+			for (int i = 0; i < (int)a->ArchivedSegments.size(); i++)
+			{
+				if (a->ArchivedSegments[i].last < q.from || a->ArchivedSegments[i].first >= q.to) continue; //block can't have anything for us
+				a->loadArchived(i).forEach(visit);
+			}
+			a->Transactions.forEach(visit);
+		}
+	};
+	if (pool && db.Shards.size() > 1) pool->parallelFor((int)db.Shards.size(), scanShard);
+	else for (size_t s = 0; s < db.Shards.size(); s++) scanShard((int)s);
+
+	std::unordered_map<std::string, QueryRow> all;
+	for (std::unordered_map<std::string, QueryRow>& groups : partial)
+	{
+		for (std::pair<const std::string, QueryRow>& g : groups) merge(all[g.first], g.second);
+	}
+	std::vector<QueryRow> rows;
+	rows.reserve(all.size());
+	for (std::pair<const std::string, QueryRow>& g : all)
+	{
+		g.second.key = g.first;
+		rows.push_back(g.second);
+	}
+	std::sort(rows.begin(), rows.end(), [](const QueryRow& a, const QueryRow& b) { return a.key < b.key; });
+	return rows;
+}
+
+/// <summary>
+/// renders rows for display
+/// </summary>
+/// <param name="rows">query result</param>
+/// <returns>one line per row: key : count : sum : min : max, in dollars</returns>
+std::string QueryEngine::format(const std::vector<QueryRow>& rows)
+{
+	std::string s = "";
+	for (const QueryRow& r : rows)
+	{
+		s.append((r.key.empty() ? std::string("All") : r.key) + " : " + std::to_string(r.count) + " : ");
+		s.append(dollars(r.sum) + " : " + dollars(r.min) + " : " + dollars(r.max) + "\n");
+	}
+	return s;
+}
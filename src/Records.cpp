@@ -0,0 +1,155 @@
+#include "BankDB.h"
+
+using namespace DB;
+
+//transaction type codes; kept stable because they are written to disk
+static const std::uint8_t TYPE_PURCHASE = 0;
+static const std::uint8_t TYPE_TRANSFER = 1;
+static const std::uint8_t TYPE_DEPOSIT = 2;
+static const std::uint8_t TYPE_BANKFUNCTION = 3;
+
+//two-byte length that says a four-byte one follows
+static const std::uint16_t LONG_STRING = 0xFFFF;
+
+/// <summary>
+/// writes a length-prefixed string. Short ones keep a two-byte length, so files written before long strings were allowed
+/// read the same; longer ones get LONG_STRING & then a four-byte length
+/// </summary>
+/// <param name="out">buffer to append to</param>
+/// <param name="s">string to write</param>
+void DB::writeString(std::string& out, const std::string& s)
+{
+	if (s.size() < LONG_STRING) writeRaw<std::uint16_t>(out, (std::uint16_t)s.size());
+	else
+	{
+		writeRaw<std::uint16_t>(out, LONG_STRING);
+		writeRaw<std::uint32_t>(out, (std::uint32_t)s.size());
+	}
+	out.append(s);
+}
+
+/// <summary>
+/// writes a transaction
+/// </summary>
+/// <param name="out">buffer to append to</param>
+/// <param name="t">transaction to write</param>
+void DB::writeTransaction(std::string& out, Transaction& t)
+{
+	std::string type = t.TransactionType();
+	std::uint8_t code = TYPE_BANKFUNCTION;
+	if (type == "Purchase") code = TYPE_PURCHASE;
+	else if (type == "Transfer") code = TYPE_TRANSFER;
+	else if (type == "Deposit") code = TYPE_DEPOSIT;
+
+	writeRaw<std::int64_t>(out, t.Timestamp.time_since_epoch().count());
+	writeRaw<std::int32_t>(out, t.Val.getValue());
+	writeRaw<std::uint8_t>(out, code);
+	writeRaw<std::uint8_t>(out, (std::uint8_t)((t.Pending ? 1 : 0) | (t.Suspicious ? 2 : 0)));
+	writeString(out, t.Name);
+	writeString(out, t.Origin);
+}
+
+/// <summary>
+/// stable code for an account's type
+/// </summary>
+/// <param name="a">account</param>
+/// <returns>type code</returns>
+std::uint8_t DB::accountTypeCode(Account& a)
+{
+	std::string type = a.getType();
+	if (type == "Checking") return ACCOUNT_CHECKING;
+	if (type == "Certificate of Deposit") return ACCOUNT_CD;
+	if (type == "Money Market") return ACCOUNT_MONEYMARKET;
+	return ACCOUNT_SAVING;
+}
+
+/// <summary>
+/// builds an account of a stored type
+/// </summary>
+/// <param name="code">type code from accountTypeCode</param>
+/// <param name="first">first transaction</param>
+/// <param name="id">account ID</param>
+/// <param name="arena">arena to make it in, null for the heap</param>
+/// <returns>the account, null for an unknown code</returns>
+std::shared_ptr<Account> DB::makeAccount(std::uint8_t code, std::shared_ptr<Transaction> first, std::string id, Arena* arena)
+{
+	switch (code)
+	{
+		case ACCOUNT_CHECKING:
+			return arenaShared<Checking>(arena, first, id);
+		case ACCOUNT_CD:
+			return arenaShared<CertOfDep>(arena, first, id);
+		case ACCOUNT_MONEYMARKET:
+			return arenaShared<MoneyMarket>(arena, first, id);
+		case ACCOUNT_SAVING:
+			return arenaShared<Saving>(arena, first, id);
+		default:
+			return std::shared_ptr<Account>();
+	}
+}
+
+/// <summary>
+/// reads a run of raw bytes
+/// </summary>
+/// <param name="n">byte count</param>
+/// <returns>the bytes, empty if there weren't enough</returns>
+std::string RecordReader::readBytes(size_t n)
+{
+	if (!ok || size - pos < n)
+	{
+		ok = false;
+		return "";
+	}
+	std::string s(data + pos, n);
+	pos += n;
+	return s;
+}
+
+/// <summary>
+/// reads a length-prefixed string
+/// </summary>
+/// <returns>the string, empty if the bytes ran out</returns>
+std::string RecordReader::readString()
+{
+	std::uint16_t n = read<std::uint16_t>();
+	if (n == LONG_STRING) return readBytes(read<std::uint32_t>());
+	return readBytes(n);
+}
+
+/// <summary>
+/// reads a transaction back, keeping its original time
+/// </summary>
+/// <param name="arena">arena to make it in, null for the heap</param>
+/// <returns>the transaction, null if the bytes ran out</returns>
+std::shared_ptr<Transaction> RecordReader::readTransaction(Arena* arena)
+{
+	std::chrono::system_clock::time_point ts{ std::chrono::system_clock::duration(read<std::int64_t>()) };
+	USDollar val(read<std::int32_t>());
+	std::uint8_t code = read<std::uint8_t>();
+	std::uint8_t flags = read<std::uint8_t>();
+	std::string name = readString();
+	std::string origin = readString();
+	if (!ok) return std::shared_ptr<Transaction>();
+
+	std::shared_ptr<Transaction> t;
+	switch (code)
+	{
+		case TYPE_PURCHASE:
+			t = arenaShared<Purchase>(arena, val, name, origin, ts);
+			break;
+		case TYPE_TRANSFER:
+			t = arenaShared<Transfer>(arena, val, name, ts);
+			break;
+		case TYPE_DEPOSIT:
+			t = arenaShared<Deposit>(arena, val, origin, ts);
+			break;
+		default:
+			t = arenaShared<BankFunction>(arena, val, name, ts);
+			break;
+	}
+	t->Name = name;
+	t->Origin = origin;
+	t->Pending = (flags & 1) != 0;
+	t->Suspicious = (flags & 2) != 0;
+	return t;
+}
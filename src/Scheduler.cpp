@@ -0,0 +1,88 @@
+#include "BankDB.h"
+
+using namespace DB;
+
+/// <summary>
+/// works out when an account next has interest work. An accrual is due once more than accrualHours whole hours have passed,
+/// which first happens at LastInterest + accrualHours + 1 hours; payouts work the same way
+/// </summary>
+/// <param name="acc">account to check</param>
+/// <param name="due">set to the due time</param>
+/// <returns>does the account ever have interest work, bool</returns>
+bool InterestScheduler::nextDue(std::shared_ptr<Account> acc, std::chrono::system_clock::time_point& due)
+{
+	if (!acc) return false;
+	std::lock_guard<std::recursive_mutex> guard(acc->Lock);
+	const InterestProduct& p = acc->product();
+	bool found = false;
+	if (p.accrualHours > 0)
+	{
+		due = acc->LastInterest + std::chrono::hours(p.accrualHours + 1);
+		found = true;
+	}
+	if (p.payoutCents >= 1 && !dynamic_cast<CertOfDep*>(acc.get())) //certificates & sub-cent payouts never pay out
+	{
+		std::chrono::system_clock::time_point pay = acc->LastPayout + std::chrono::hours(p.payoutHours + 1);
+		if (!found || pay < due) due = pay;
+		found = true;
+	}
+	return found;
+}
+
+/// <summary>
+/// queues an account at its next due time, replacing any entry it already had
+/// </summary>
+/// <param name="acc">account to schedule</param>
+void InterestScheduler::schedule(std::shared_ptr<Account> acc)
+{
+	if (!acc) return;
+	std::chrono::system_clock::time_point due;
+	bool scheduled = nextDue(acc, due);
+	std::lock_guard<std::mutex> guard(lock);
+	std::uint64_t version = ++acc->ScheduledVersion; //any older entry is stale now
+	if (scheduled)
+	{
+		queue.push(Entry{ due.time_since_epoch().count(), version, acc });
+	}
+}
+
+/// <summary>
+/// earliest live due time; stale entries on top are dropped on the way
+/// </summary>
+/// <param name="t">set to the due time</param>
+/// <returns>is anything queued, bool</returns>
+bool InterestScheduler::nextTime(std::chrono::system_clock::time_point& t)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	while (!queue.empty() && queue.top().version != queue.top().acc->ScheduledVersion) queue.pop();
+	if (queue.empty()) return false;
+	t = std::chrono::system_clock::time_point(std::chrono::system_clock::duration(queue.top().due));
+	return true;
+}
+
+/// <summary>
+/// runs interest for the due accounts only, then requeues them at their next due time
+/// </summary>
+/// <param name="now">time to run interest as of</param>
+/// <param name="pool">threads to use, may be null</param>
+/// <returns>accounts changed</returns>
+int InterestScheduler::tick(std::chrono::system_clock::time_point now, std::shared_ptr<ThreadPool> pool)
+{
+	std::vector<std::shared_ptr<Account>> due;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		const std::int64_t nowTicks = now.time_since_epoch().count();
+		while (!queue.empty() && queue.top().due <= nowTicks)
+		{
+			Entry e = queue.top();
+			queue.pop();
+			std::uint64_t& live = e.acc->ScheduledVersion;
+			if (e.version != live) continue; //replaced by a later schedule
+			live++; //consumed; the account gets a fresh entry below
+			due.push_back(e.acc);
+		}
+	}
+	int changed = Interest::Batch(due, pool, now);
+	for (std::shared_ptr<Account>& acc : due) schedule(acc);
+	return changed;
+}
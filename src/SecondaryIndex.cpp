@@ -0,0 +1,97 @@
+#include "BankDB.h"
+
+using namespace DB;
+
+/// <summary>
+/// lists a new account; its overdrawn flag is taken under its lock so later balance changes report against the right state
+/// </summary>
+/// <param name="acc">account to list</param>
+void SecondaryIndex::add(std::shared_ptr<Account> acc)
+{
+	if (!acc) return;
+	std::lock_guard<std::recursive_mutex> held(acc->Lock);
+	acc->ListedNegative = acc->balance < 0;
+	Entry e{ acc, accountTypeCode(*acc), acc->ProductID, acc->ListedNegative };
+	std::lock_guard<std::mutex> guard(lock);
+	members[acc->ID] = e;
+	byType[e.type].insert(acc->ID);
+	byProduct[e.product].insert(acc->ID);
+	if (e.negative) negatives.insert(acc->ID);
+}
+
+/// <summary>
+/// moves an account to another product's set
+/// </summary>
+/// <param name="id">account ID</param>
+/// <param name="product">its new product</param>
+void SecondaryIndex::productChanged(const std::string& id, int product)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	std::unordered_map<std::string, Entry>::iterator it = members.find(id);
+	if (it == members.end() || it->second.product == product) return;
+	byProduct[it->second.product].erase(id);
+	byProduct[product].insert(id);
+	it->second.product = product;
+}
+
+/// <summary>
+/// moves an account in or out of the overdrawn set
+/// </summary>
+/// <param name="id">account ID</param>
+/// <param name="negative">is its balance below zero now</param>
+void SecondaryIndex::negativeChanged(const std::string& id, bool negative)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	std::unordered_map<std::string, Entry>::iterator it = members.find(id);
+	if (it == members.end()) return;
+	it->second.negative = negative;
+	if (negative) negatives.insert(id);
+	else negatives.erase(id);
+}
+
+/// <summary>
+/// Finds accounts by any mix of keys. Only the smallest set named is walked; the other keys are checked on its entries
+/// </summary>
+/// <param name="type">account type code, -1 for any</param>
+/// <param name="product">product ID, -1 for any</param>
+/// <param name="overdrawnOnly">only accounts with a negative balance</param>
+/// <returns>matching accounts, in no particular order</returns>
+std::vector<std::shared_ptr<Account>> SecondaryIndex::find(int type, int product, bool overdrawnOnly)
+{
+	std::vector<std::shared_ptr<Account>> found;
+	std::lock_guard<std::mutex> guard(lock);
+	const std::unordered_set<std::string>* smallest = nullptr;
+	auto consider = [&](const std::unordered_set<std::string>& set)
+	{
+		if (!smallest || set.size() < smallest->size()) smallest = &set;
+	};
+	static const std::unordered_set<std::string> none;
+	if (type >= 0)
+	{
+		std::unordered_map<int, std::unordered_set<std::string>>::iterator it = byType.find(type);
+		consider(it == byType.end() ? none : it->second);
+	}
+	if (product >= 0)
+	{
+		std::unordered_map<int, std::unordered_set<std::string>>::iterator it = byProduct.find(product);
+		consider(it == byProduct.end() ? none : it->second);
+	}
+	if (overdrawnOnly) consider(negatives);
+
+	auto keep = [&](const Entry& e)
+	{
+		std::shared_ptr<Account> acc = e.acc.lock();
+		if (acc) found.push_back(acc);
+	};
+	auto check = [&](const Entry& e)
+	{
+		if ((type < 0 || e.type == type) && (product < 0 || e.product == product) && (!overdrawnOnly || e.negative)) keep(e);
+	};
+	if (!smallest) //no keys, everything
+	{
+		for (std::pair<const std::string, Entry>& m : members) keep(m.second);
+		return found;
+	}
+	for (const std::string& id : *smallest) check(members[id]);
+	return found;
+}
@@ -0,0 +1,389 @@
+#include "BankDB.h"
+#include <cstdio>
+#include <unordered_map>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace DB;
+
+static const std::uint32_t SNAPSHOT_MAGIC = 0x504E5342; //"BSNP"
+static const std::uint32_t SNAPSHOT_VERSION = 2; //2 added the log checkpoint
+
+static_assert(sizeof(SnapshotUser) == 32, "snapshot rows are fixed size");
+static_assert(sizeof(SnapshotAccount) == 96, "snapshot rows are fixed size");
+static_assert(sizeof(SnapshotOwner) == 8, "snapshot rows are fixed size");
+static_assert(sizeof(SnapshotSegment) == 32, "snapshot rows are fixed size");
+
+/// <summary>
+/// Constructor; maps the whole file read-only
+/// </summary>
+/// <param name="path">file to map</param>
+MappedFile::MappedFile(std::string path)
+{
+#ifdef _WIN32
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) throw ExSnapshotIO("MappedFile::MappedFile");
+	LARGE_INTEGER size;
+	GetFileSizeEx(file, &size);
+	length = (size_t)size.QuadPart;
+	if (length == 0) return;
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping) throw ExSnapshotIO("MappedFile::MappedFile");
+	base = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!base) throw ExSnapshotIO("MappedFile::MappedFile");
+#else
+	fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) throw ExSnapshotIO("MappedFile::MappedFile");
+	struct stat st;
+	if (fstat(fd, &st) != 0) throw ExSnapshotIO("MappedFile::MappedFile");
+	length = (size_t)st.st_size;
+	if (length == 0) return;
+	void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (p == MAP_FAILED) throw ExSnapshotIO("MappedFile::MappedFile");
+	base = (const char*)p;
+#endif
+}
+
+/// <summary>
+/// Destructor; unmaps & closes
+/// </summary>
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if (base) UnmapViewOfFile(base);
+	if (mapping) CloseHandle(mapping);
+	if (file && file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+	if (base) munmap((void*)base, length);
+	if (fd >= 0) close(fd);
+#endif
+}
+
+/// <summary>
+/// pads a section out to an 8 byte boundary
+/// </summary>
+static void align(std::string& out)
+{
+	while (out.size() % 8) out.push_back('\0');
+}
+
+/// <summary>
+/// appends raw rows to a section
+/// </summary>
+template <typename Row>
+static void writeRows(std::string& out, const std::vector<Row>& rows)
+{
+	if (!rows.empty()) out.append(reinterpret_cast<const char*>(rows.data()), rows.size() * sizeof(Row));
+}
+
+/// <summary>
+/// Puts a whole file in place of path so a crash leaves either the old file or the new one. The bytes go to a temp file that is
+/// synced before it's renamed straight over the old file, & the directory is synced after so the rename itself is on disk
+/// </summary>
+/// <param name="path">file to replace</param>
+/// <param name="bytes">new contents</param>
+/// <returns>is the new file in place & durable, bool</returns>
+bool DB::replaceFile(const std::string& path, const std::string& bytes)
+{
+	std::string temp = path + ".tmp";
+#ifdef _WIN32
+	HANDLE file = CreateFileA(temp.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	bool ok = true;
+	size_t done = 0;
+	while (ok && done < bytes.size())
+	{
+		DWORD n = 0;
+		DWORD chunk = bytes.size() - done > 0x40000000 ? 0x40000000 : (DWORD)(bytes.size() - done);
+		ok = WriteFile(file, bytes.data() + done, chunk, &n, NULL) && n > 0;
+		done += n;
+	}
+	ok = ok && FlushFileBuffers(file);
+	CloseHandle(file);
+	//replaces the old file in one step; write-through doesn't return until the move is on disk
+	return ok && MoveFileExA(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+	int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) return false;
+	size_t done = 0;
+	while (done < bytes.size())
+	{
+		ssize_t n = ::write(fd, bytes.data() + done, bytes.size() - done);
+		if (n <= 0) break;
+		done += (size_t)n;
+	}
+	bool ok = done == bytes.size() && fsync(fd) == 0;
+	close(fd);
+	if (!ok || rename(temp.c_str(), path.c_str()) != 0) return false; //rename replaces the old file in one step
+	size_t slash = path.find_last_of('/');
+	std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+	int dirFd = open(dir.c_str(), O_RDONLY);
+	if (dirFd < 0) return false;
+	ok = fsync(dirFd) == 0;
+	close(dirFd);
+	return ok;
+#endif
+}
+
+/// <summary>
+/// Writes the snapshot. Each account is copied under its own lock, together with the newest log record it reflects,
+/// so replaying the log on top later skips exactly what the snapshot already has. The log's position is read once every
+/// shard is held: records that change users or the catalog need a shard lock, & a posting's account lock is held from its
+/// enqueue to its apply, so every record up to that position is already in what gets copied
+/// </summary>
+/// <param name="path">snapshot file path</param>
+/// <param name="d">database to save</param>
+/// <returns>the log checkpoint: newest log record the snapshot has, 0 with no log</returns>
+std::uint64_t Snapshot::write(std::string path, Database& d)
+{
+	std::string strings; //string heap
+	auto intern = [&](const std::string& s, std::uint64_t& at, std::uint32_t& len)
+	{
+		at = strings.size();
+		len = (std::uint32_t)s.size();
+		strings += s;
+	};
+
+	std::vector<SnapshotUser> users;
+	std::vector<SnapshotAccount> accounts;
+	std::vector<SnapshotOwner> owners;
+	std::vector<SnapshotSegment> segments;
+	std::string history;
+	SnapshotHeader h = SnapshotHeader();
+	{
+		std::shared_lock<std::shared_mutex> guard(d.Catalog); //no adds while we walk the lists
+		std::vector<std::shared_lock<std::shared_mutex>> shards; //every shard, in index order like any other multi-shard lock
+		for (std::shared_ptr<Shard>& sh : d.Shards) shards.push_back(std::shared_lock<std::shared_mutex>(sh->Catalog));
+		std::shared_ptr<WriteAheadLog> log = d.Log;
+		h.logSeq = log ? log->records() : 0;
+
+		std::unordered_map<std::string, std::uint32_t> accountRow; //account ID to row, for the ownership rows
+		for (std::shared_ptr<Shard>& sh : d.Shards) sh->Accounts.forEach([&](std::shared_ptr<Account> a)
+		{
+			std::lock_guard<std::recursive_mutex> lock(a->Lock);
+			SnapshotAccount row = SnapshotAccount();
+			intern(a->ID, row.id, row.idLength);
+			row.type = accountTypeCode(*a);
+			row.product = a->ProductID;
+			row.balance = a->balance.getValue();
+			row.available = a->available.getValue();
+			row.interestSoFar = a->accruedInterest().getValue();
+			row.archivedBalance = a->archivedBalance.getValue();
+			row.archivedCount = a->archivedCount;
+			row.lastInterest = a->LastInterest.time_since_epoch().count();
+			row.lastPayout = a->LastPayout.time_since_epoch().count();
+			row.loggedSeq = a->LoggedSeq;
+			if (a->InterestInFlight && a->InterestInFlight <= h.logSeq) h.logSeq = a->InterestInFlight - 1; //logged but not made yet, so replay it
+			row.history = history.size();
+			a->Transactions.forEach([&](std::shared_ptr<Transaction> t)
+			{
+				writeTransaction(history, *t);
+				row.historyCount++;
+				return true;
+			});
+			row.historyBytes = (std::uint32_t)(history.size() - row.history);
+			row.segments = segments.size();
+			for (ArchiveSegment& seg : a->ArchivedSegments)
+			{
+				segments.push_back(SnapshotSegment{ seg.offset, seg.first.time_since_epoch().count(), seg.last.time_since_epoch().count(), seg.count, seg.bytes });
+			}
+			row.segmentCount = (std::int32_t)a->ArchivedSegments.size();
+			accountRow[a->ID] = (std::uint32_t)accounts.size();
+			accounts.push_back(row);
+			return true;
+		});
+
+		auto addUser = [&](User& u, std::uint8_t kind)
+		{
+			SnapshotUser row = SnapshotUser();
+			intern(u.name, row.name, row.nameLength);
+			intern(u.password, row.password, row.passwordLength);
+			row.kind = kind;
+			users.push_back(row);
+		};
+		for (std::shared_ptr<Shard>& sh : d.Shards) sh->Customers.forEach([&](std::shared_ptr<Customer> c)
+		{
+			std::uint32_t index = (std::uint32_t)users.size();
+			addUser(*c, 0);
+			c->AccountIDs.forEach([&](std::shared_ptr<std::string> id)
+			{
+				std::unordered_map<std::string, std::uint32_t>::iterator found = accountRow.find(*id);
+				if (found != accountRow.end()) owners.push_back(SnapshotOwner{ index, found->second });
+				return true;
+			});
+			return true;
+		});
+		d.Employees.forEach([&](std::shared_ptr<Employee> e)
+		{
+			addUser(*e, 1);
+			return true;
+		});
+
+		if (d.Archive) intern(d.Archive->getPath(), h.archivePath, h.archivePathLength);
+		h.hotWindow = d.HotWindow;
+	}
+
+	//lay the sections out after the header
+	std::string out(sizeof(SnapshotHeader), '\0');
+	h.magic = SNAPSHOT_MAGIC;
+	h.version = SNAPSHOT_VERSION;
+	h.users = users.size();
+	h.accounts = accounts.size();
+	h.owners = owners.size();
+	h.segments = segments.size();
+	h.usersAt = out.size();
+	writeRows(out, users);
+	h.accountsAt = out.size();
+	writeRows(out, accounts);
+	h.ownersAt = out.size();
+	writeRows(out, owners);
+	h.segmentsAt = out.size();
+	writeRows(out, segments);
+	h.historyAt = out.size();
+	out += history;
+	align(out);
+	h.stringsAt = out.size();
+	h.stringsSize = strings.size();
+	out += strings;
+	std::memcpy(&out[0], &h, sizeof(SnapshotHeader));
+
+	if (!replaceFile(path, out)) throw ExSnapshotIO("Snapshot::write");
+	return h.logSeq;
+}
+
+/// <summary>
+/// Loads a snapshot into a database that has nothing but its default employee. Rows are read in place from the mapping;
+/// only each account's hot transactions are decoded, straight from the mapped bytes
+/// </summary>
+/// <param name="path">snapshot file path</param>
+/// <param name="d">database to fill</param>
+/// <returns>accounts loaded</returns>
+int Snapshot::load(std::string path, Database& d)
+{
+	MappedFile map(path);
+	const char* base = map.data();
+	if (map.size() < sizeof(SnapshotHeader)) throw ExSnapshotIO("Snapshot::load");
+	const SnapshotHeader& h = *reinterpret_cast<const SnapshotHeader*>(base);
+	if (h.magic != SNAPSHOT_MAGIC || h.version != SNAPSHOT_VERSION || h.stringsAt + h.stringsSize > map.size()
+		|| h.accountsAt + h.accounts * sizeof(SnapshotAccount) > map.size() || h.usersAt + h.users * sizeof(SnapshotUser) > map.size()
+		|| h.ownersAt + h.owners * sizeof(SnapshotOwner) > map.size() || h.segmentsAt + h.segments * sizeof(SnapshotSegment) > map.size())
+	{
+		throw ExSnapshotIO("Snapshot::load");
+	}
+	const SnapshotUser* users = reinterpret_cast<const SnapshotUser*>(base + h.usersAt);
+	const SnapshotAccount* accounts = reinterpret_cast<const SnapshotAccount*>(base + h.accountsAt);
+	const SnapshotOwner* owners = reinterpret_cast<const SnapshotOwner*>(base + h.ownersAt);
+	const SnapshotSegment* segments = reinterpret_cast<const SnapshotSegment*>(base + h.segmentsAt);
+	const char* history = base + h.historyAt;
+	const char* strings = base + h.stringsAt;
+	auto text = [&](std::uint64_t at, std::uint32_t len)
+	{
+		if (at + len > h.stringsSize) throw ExSnapshotIO("Snapshot::load");
+		return std::string(strings + at, len);
+	};
+
+	//the segments point into the archive file, so it has to be kept, not started fresh
+	if (h.archivePathLength > 0) d.enableArchive(text(h.archivePath, h.archivePathLength), h.hotWindow, true);
+
+	std::unique_lock<std::shared_mutex> guard(d.Catalog);
+	std::vector<std::unique_lock<std::shared_mutex>> shards;
+	for (std::shared_ptr<Shard>& sh : d.Shards) shards.push_back(std::unique_lock<std::shared_mutex>(sh->Catalog));
+	std::vector<std::shared_ptr<Customer>> customers(h.users);
+	for (std::uint64_t i = 0; i < h.users; i++)
+	{
+		std::string name = text(users[i].name, users[i].nameLength);
+		std::string pass = text(users[i].password, users[i].passwordLength);
+		if (users[i].kind == 0)
+		{
+			customers[i] = arenaShared<Customer>(d.Memory.get(), name, pass);
+			customers[i]->AccountIDs.setArena(d.Memory);
+			Shard& sh = d.shardFor(name);
+			sh.Customers.put(customers[i]);
+			sh.Directory[name] = DirectoryEntry{ ROLE_CUSTOMER, customers[i] };
+		}
+		else
+		{
+			DirectoryEntry& entry = d.shardFor(name).Directory[name];
+			if (entry.role == ROLE_EMPLOYEE)
+			{
+				entry.user->password = pass; //default admin, keep its saved password
+			}
+			else
+			{
+				std::shared_ptr<Employee> e(new Employee(name, pass));
+				d.Employees.put(e);
+				entry = DirectoryEntry{ ROLE_EMPLOYEE, e };
+			}
+		}
+	}
+
+	std::vector<std::shared_ptr<Account>> loaded(h.accounts);
+	for (std::uint64_t i = 0; i < h.accounts; i++)
+	{
+		const SnapshotAccount& row = accounts[i];
+		if (row.history + row.historyBytes > h.stringsAt - h.historyAt) throw ExSnapshotIO("Snapshot::load");
+		RecordReader r(history + row.history, row.historyBytes);
+		std::shared_ptr<Transaction> first = r.readTransaction(d.Memory.get());
+		if (!first) throw ExSnapshotIO("Snapshot::load");
+		std::shared_ptr<Account> a = makeAccount(row.type, first, text(row.id, row.idLength), d.Memory.get());
+		if (!a) throw ExSnapshotIO("Snapshot::load");
+		a->setArena(d.Memory);
+		for (int k = 1; k < row.historyCount; k++)
+		{
+			std::shared_ptr<Transaction> t = r.readTransaction(d.Memory.get());
+			if (!t) throw ExSnapshotIO("Snapshot::load");
+			a->Transactions.put(t);
+		}
+		if (row.segments + row.segmentCount > h.segments) throw ExSnapshotIO("Snapshot::load");
+		for (int k = 0; k < row.segmentCount; k++)
+		{
+			const SnapshotSegment& s = segments[row.segments + k];
+			ArchiveSegment seg;
+			seg.offset = s.offset;
+			seg.count = s.count;
+			seg.bytes = s.bytes;
+			seg.first = std::chrono::system_clock::time_point(std::chrono::system_clock::duration(s.first));
+			seg.last = std::chrono::system_clock::time_point(std::chrono::system_clock::duration(s.last));
+			a->ArchivedSegments.push_back(seg);
+		}
+		//balances come straight from the row instead of being summed again
+		a->balance = USDollar(row.balance);
+		a->available = USDollar(row.available);
+		a->archivedBalance = USDollar(row.archivedBalance);
+		a->archivedCount = row.archivedCount;
+		a->setInterestType(row.product);
+		a->restoreInterest(USDollar(row.interestSoFar),
+			std::chrono::system_clock::time_point(std::chrono::system_clock::duration(row.lastInterest)),
+			std::chrono::system_clock::time_point(std::chrono::system_clock::duration(row.lastPayout)));
+		a->LoggedSeq = row.loggedSeq;
+		a->Archive = d.Archive;
+		a->HotWindow = d.HotWindow;
+		a->Log = d.Log;
+		Shard& sh = d.shardFor(a->ID);
+		sh.Accounts.put(a);
+		sh.AccountIndex[a->ID] = a;
+		a->Indices = sh.Indices;
+		sh.Indices->add(a);
+		d.publishFirst(a);
+		a->Scheduler = d.Schedule;
+		a->Time = d.Time;
+		d.Schedule->schedule(a);
+		loaded[i] = a;
+	}
+
+	for (std::uint64_t i = 0; i < h.owners; i++)
+	{
+		if (owners[i].customer >= h.users || owners[i].account >= h.accounts || !customers[owners[i].customer]) throw ExSnapshotIO("Snapshot::load");
+		std::shared_ptr<Account>& a = loaded[owners[i].account];
+		customers[owners[i].customer]->AccountIDs.put(arenaShared<std::string>(d.Memory.get(), a->ID));
+		d.shardFor(a->ID).Owners[a->ID].push_back(customers[owners[i].customer]->name);
+	}
+	d.LogCheckpoint = h.logSeq;
+	return (int)h.accounts;
+}
@@ -0,0 +1,238 @@
+#include "BankDB.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace DB;
+
+/// <summary>
+/// Constructor; creates or empties the file
+/// </summary>
+/// <param name="path">file to write</param>
+/// <param name="capacity">buffer size in bytes</param>
+StatementFile::StatementFile(std::string path, size_t capacity) : buffer(capacity < 256 ? 256 : capacity)
+{
+#ifdef _WIN32
+	fd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+	fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+	if (fd < 0) throw ExStatementIO("StatementFile::StatementFile");
+}
+
+/// <summary>
+/// Destructor; writes out the rest of the buffer & closes the file
+/// </summary>
+StatementFile::~StatementFile()
+{
+	try
+	{
+		flush();
+	}
+	catch (ExStatementIO& e)
+	{
+		e.printError(); //can't throw out of a destructor
+	}
+#ifdef _WIN32
+	_close(fd);
+#else
+	close(fd);
+#endif
+}
+
+/// <summary>
+/// appends raw bytes, flushing first if they don't fit. Anything bigger than the whole buffer goes straight to the file
+/// </summary>
+/// <param name="s">bytes</param>
+/// <param name="n">byte count</param>
+void StatementFile::append(const char* s, size_t n)
+{
+	if (used + n > buffer.size()) flush();
+	if (n > buffer.size())
+	{
+		size_t done = 0;
+		while (done < n)
+		{
+#ifdef _WIN32
+			int w = _write(fd, s + done, (unsigned int)(n - done));
+#else
+			ssize_t w = write(fd, s + done, n - done);
+#endif
+			if (w <= 0) throw ExStatementIO("StatementFile::append");
+			done += (size_t)w;
+		}
+		return;
+	}
+	std::memcpy(buffer.data() + used, s, n);
+	used += n;
+}
+
+/// <summary>
+/// appends cents as dollars, without building a string
+/// </summary>
+/// <param name="cents">amount</param>
+void StatementFile::appendCents(int cents)
+{
+	char text[24];
+	char* end = text + sizeof(text);
+	char* p = end;
+	long long v = cents < 0 ? -(long long)cents : cents;
+	*--p = (char)('0' + v % 10);
+	*--p = (char)('0' + v / 10 % 10);
+	*--p = '.';
+	v /= 100;
+	do
+	{
+		*--p = (char)('0' + v % 10);
+		v /= 10;
+	} while (v > 0);
+	*--p = '$';
+	if (cents < 0) *--p = '-';
+	append(p, (size_t)(end - p));
+}
+
+/// <summary>
+/// appends a UTC date; days to a civil date without gmtime, which isn't safe across threads
+/// </summary>
+/// <param name="t">time</param>
+void StatementFile::appendDate(std::chrono::system_clock::time_point t)
+{
+	long long z = std::chrono::duration_cast<std::chrono::seconds>(t.time_since_epoch()).count();
+	z = (z >= 0 ? z : z - 86399) / 86400 + 719468; //days since 0000-03-01
+	long long era = (z >= 0 ? z : z - 146096) / 146097;
+	long long doe = z - era * 146097;
+	long long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	long long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	long long mp = (5 * doy + 2) / 153;
+	long long day = doy - (153 * mp + 2) / 5 + 1;
+	long long month = mp < 10 ? mp + 3 : mp - 9;
+	long long year = yoe + era * 400 + (month <= 2 ? 1 : 0);
+	char text[16];
+	int n = std::snprintf(text, sizeof(text), "%04lld-%02lld-%02lld", year, month, day);
+	append(text, (size_t)n);
+}
+
+/// <summary>
+/// writes the buffer to the file in one go
+/// </summary>
+void StatementFile::flush()
+{
+	size_t done = 0;
+	while (done < used)
+	{
+#ifdef _WIN32
+		int n = _write(fd, buffer.data() + done, (unsigned int)(used - done));
+#else
+		ssize_t n = write(fd, buffer.data() + done, used - done);
+#endif
+		if (n <= 0) throw ExStatementIO("StatementFile::flush");
+		done += (size_t)n;
+	}
+	used = 0;
+}
+
+/// <summary>
+/// Renders one statement. The balances at the ends of the period are worked back from the current balance, so only transactions
+/// from the start of the period on are read; archived blocks that end before it are skipped
+/// </summary>
+/// <param name="a">account</param>
+/// <param name="out">file to render into</param>
+/// <param name="from">start of the period, inclusive</param>
+/// <param name="to">end of the period, exclusive</param>
+void StatementExporter::render(Account& a, StatementFile& out, std::chrono::system_clock::time_point from, std::chrono::system_clock::time_point to)
+{
+	std::lock_guard<std::recursive_mutex> guard(a.Lock);
+	long long sinceFrom = 0; //cents posted at or after from
+	long long sinceTo = 0; //cents posted at or after to
+	out.append("Statement: ");
+	out.append(a.ID);
+	out.append(" : ");
+	out.append(a.getType());
+	out.append("\nPeriod: ");
+	out.appendDate(from);
+	out.append(" to ");
+	out.appendDate(to);
+	out.append("\n");
+
+	//the opening balance needs every transaction in the period summed first, so the lines are rendered on a second pass
+	auto sum = [&](std::shared_ptr<Transaction> t)
+	{
+		if (t && t->Timestamp >= from) sinceFrom += t->Val.getValue();
+		if (t && t->Timestamp >= to) sinceTo += t->Val.getValue();
+		return true;
+	};
+	auto line = [&](std::shared_ptr<Transaction> t)
+	{
+		if (!t || t->Timestamp < from || t->Timestamp >= to) return true;
+		out.appendDate(t->Timestamp);
+		out.append("  ");
+		out.append(t->TransactionType());
+		out.append(": ");
+		out.append(t->Name);
+		out.append(" - ");
+		out.append(t->Origin);
+		out.append("  ");
+		out.appendCents(t->Val.getValue());
+		out.append("\n");
+		return true;
+	};
+	int firstBlock = 0; //oldest archived block that reaches into the period
+	while (firstBlock < (int)a.ArchivedSegments.size() && a.ArchivedSegments[firstBlock].last < from) firstBlock++;
+	for (int i = firstBlock; i < (int)a.ArchivedSegments.size(); i++) a.loadArchived(i).forEach(sum);
+	a.Transactions.forEach(sum);
+
+	out.append("Opening balance: ");
+	out.appendCents((int)(a.balance.getValue() - sinceFrom));
+	out.append("\n");
+	for (int i = firstBlock; i < (int)a.ArchivedSegments.size() && a.ArchivedSegments[i].first < to; i++) a.loadArchived(i).forEach(line);
+	a.Transactions.forEach(line);
+	out.append("Closing balance: ");
+	out.appendCents((int)(a.balance.getValue() - sinceTo));
+	out.append("\n\n");
+}
+
+/// <summary>
+/// Writes every account's statement, one file & one task per shard. A shard's accounts are listed under its lock, then rendered
+/// without it, so adds & postings elsewhere carry on
+/// </summary>
+/// <param name="dir">directory for the files</param>
+/// <param name="from">start of the period, inclusive</param>
+/// <param name="to">end of the period, exclusive</param>
+/// <returns>accounts written</returns>
+long long StatementExporter::exportAll(std::string dir, std::chrono::system_clock::time_point from, std::chrono::system_clock::time_point to)
+{
+	std::vector<long long> written(db.Shards.size(), 0);
+	auto exportShard = [&](int s)
+	{
+		std::vector<std::shared_ptr<Account>> accounts;
+		{
+			std::shared_lock<std::shared_mutex> guard(db.Shards[s]->Catalog);
+			accounts.reserve(db.Shards[s]->AccountIndex.size());
+			db.Shards[s]->Accounts.forEach([&](std::shared_ptr<Account> a)
+			{
+				accounts.push_back(a);
+				return true;
+			});
+		}
+		char name[32];
+		std::snprintf(name, sizeof(name), "statements-%02d.txt", s);
+		StatementFile out((std::filesystem::path(dir) / name).string(), bufferBytes);
+		for (std::shared_ptr<Account>& a : accounts)
+		{
+			render(*a, out, from, to);
+			written[s]++;
+		}
+		out.flush();
+	};
+	if (pool && db.Shards.size() > 1) pool->parallelFor((int)db.Shards.size(), exportShard);
+	else for (size_t s = 0; s < db.Shards.size(); s++) exportShard((int)s);
+	long long total = 0;
+	for (long long w : written) total += w;
+	return total;
+}
@@ -0,0 +1,102 @@
+#include "ThreadPool.h"
+
+/// <summary>
+/// Constructor; starts the workers. The calling thread also works, so a pool of n threads starts n - 1
+/// </summary>
+/// <param name="threads">threads to use, 0 for every core</param>
+ThreadPool::ThreadPool(int threads)
+{
+	if (threads < 1) threads = (int)std::thread::hardware_concurrency();
+	if (threads < 1) threads = 1;
+	for (int i = 1; i < threads; i++)
+	{
+		workers.push_back(std::thread(&ThreadPool::work, this));
+	}
+}
+
+/// <summary>
+/// Destructor; stops & joins the workers
+/// </summary>
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(m);
+		stop = true;
+	}
+	wake.notify_all();
+	for (std::thread& t : workers) t.join();
+}
+
+/// <summary>
+/// runs a job split into numbered tasks
+/// </summary>
+/// <param name="tasks">number of tasks</param>
+/// <param name="f">task function, gets the task number</param>
+void ThreadPool::parallelFor(int tasks, std::function<void(int)> f)
+{
+	if (tasks < 1) return;
+	std::lock_guard<std::mutex> run(runLock);
+	{
+		std::lock_guard<std::mutex> guard(m);
+		job = f;
+		next = 0;
+		total = tasks;
+		remaining = tasks;
+		error = nullptr;
+		generation++;
+	}
+	wake.notify_all();
+	drain(); //the caller pitches in
+
+	std::unique_lock<std::mutex> guard(m);
+	finished.wait(guard, [&]() { return remaining == 0; });
+	job = nullptr;
+	if (error) std::rethrow_exception(error);
+}
+
+/// <summary>
+/// worker loop; sleeps until there's a new job
+/// </summary>
+void ThreadPool::work()
+{
+	unsigned seen = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> guard(m);
+			wake.wait(guard, [&]() { return stop || generation != seen; });
+			if (stop) return;
+			seen = generation;
+		}
+		drain();
+	}
+}
+
+/// <summary>
+/// claims & runs tasks from the current job until there are none left
+/// </summary>
+void ThreadPool::drain()
+{
+	while (true)
+	{
+		int task;
+		std::function<void(int)> f;
+		{
+			std::lock_guard<std::mutex> guard(m);
+			if (next >= total) return;
+			task = next++;
+			f = job;
+		}
+		try
+		{
+			f(task);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> guard(m);
+			if (!error) error = std::current_exception();
+		}
+		std::lock_guard<std::mutex> guard(m);
+		if (--remaining == 0) finished.notify_all();
+	}
+}
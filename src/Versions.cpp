@@ -0,0 +1,146 @@
+#include "BankDB.h"
+#include <thread>
+
+using namespace DB;
+
+/// <summary>
+/// copies an account's visible state; the caller holds its lock
+/// </summary>
+/// <param name="a">account</param>
+/// <returns>an unpublished state</returns>
+static std::shared_ptr<AccountVersion> capture(Account& a)
+{
+	std::shared_ptr<AccountVersion> s(new AccountVersion());
+	s->balance = a.balance.getValue();
+	s->available = a.available.getValue();
+	s->transactions = a.transactionCount();
+	return s;
+}
+
+/// <summary>
+/// Publishes new states. Each one is linked at the head of its account's chain, which only the caller can touch since it holds the
+/// account's lock, so two commits on different accounts never wait on each other for the swap. Versions become visible to readers
+/// in order, so a pinned version has every commit at or before it fully linked; a commit only waits there for ones that took a version
+/// just before it & are still swapping their heads. Trimming comes after, once the new version is visible
+/// </summary>
+/// <param name="a">changed account, locked by the caller</param>
+/// <param name="b">other account changed in the same commit, locked by the caller; null for none</param>
+void VersionStore::publish(Account& a, Account* b)
+{
+	std::shared_ptr<AccountVersion> sa = capture(a);
+	std::shared_ptr<AccountVersion> sb = b && b != &a ? capture(*b) : std::shared_ptr<AccountVersion>();
+	std::uint64_t v = issued.fetch_add(1) + 1;
+	sa->version = v;
+	std::atomic_store(&sa->older, std::atomic_load(&a.VersionHead));
+	std::atomic_store(&a.VersionHead, sa);
+	if (sb)
+	{
+		sb->version = v;
+		std::atomic_store(&sb->older, std::atomic_load(&b->VersionHead));
+		std::atomic_store(&b->VersionHead, sb);
+	}
+	while (visible.load() != v - 1) std::this_thread::yield();
+	visible.store(v);
+
+	//a reader that pinned something older stored its pin before checking visible again, so it's in oldestPin by now
+	std::uint64_t oldest = oldestPin.load();
+	std::uint64_t keep = oldest < v ? oldest : v;
+	trim(a, keep);
+	if (sb) trim(*b, keep);
+}
+
+/// <summary>
+/// Cuts an account's chain below the newest state at or before keep, which is the oldest any reader can still ask for. The full walk
+/// only happens when keep has moved since this account last trimmed; the usual case is the state under the head
+/// </summary>
+/// <param name="a">account, locked by the caller</param>
+/// <param name="keep">oldest version a reader can be pinned at</param>
+void VersionStore::trim(Account& a, std::uint64_t keep)
+{
+	std::shared_ptr<AccountVersion> head = std::atomic_load(&a.VersionHead);
+	if (!head) return;
+	if (head->version <= keep)
+	{
+		std::atomic_store(&head->older, std::shared_ptr<AccountVersion>()); //the head is all anyone can see
+	}
+	else
+	{
+		std::shared_ptr<AccountVersion> below = std::atomic_load(&head->older);
+		if (below && below->version <= keep)
+		{
+			std::atomic_store(&below->older, std::shared_ptr<AccountVersion>());
+		}
+		else if (a.VersionsTrimmedAt != keep)
+		{
+			std::shared_ptr<AccountVersion> node = below;
+			while (node && node->version > keep) node = std::atomic_load(&node->older);
+			if (node) std::atomic_store(&node->older, std::shared_ptr<AccountVersion>());
+		}
+	}
+	a.VersionsTrimmedAt = keep;
+}
+
+/// <summary>
+/// Pins the newest visible commit. The pin is stored before visible is read again: if nothing became visible in between, any commit
+/// that read oldestPin before the pin was there had already made its version visible, so it's no newer than this one & its trim keeps
+/// what this version needs. Otherwise it tries again with the newer version
+/// </summary>
+/// <returns>the pinned version</returns>
+std::uint64_t VersionStore::pin()
+{
+	std::lock_guard<std::mutex> guard(pinLock);
+	while (true)
+	{
+		std::uint64_t v = visible.load();
+		pins.insert(v);
+		setOldest();
+		if (visible.load() == v) return v;
+		pins.erase(pins.find(v));
+		setOldest();
+	}
+}
+
+/// <summary>
+/// releases one pin of a version
+/// </summary>
+/// <param name="v">pinned version</param>
+void VersionStore::unpin(std::uint64_t v)
+{
+	std::lock_guard<std::mutex> guard(pinLock);
+	std::multiset<std::uint64_t>::iterator it = pins.find(v);
+	if (it != pins.end()) pins.erase(it);
+	setOldest();
+}
+
+/// <summary>
+/// stores the oldest pin where commits read it
+/// </summary>
+void VersionStore::setOldest()
+{
+	oldestPin.store(pins.empty() ? UINT64_MAX : *pins.begin());
+}
+
+/// <summary>
+/// walks an account's chain back to a version; takes no lock
+/// </summary>
+/// <param name="a">account</param>
+/// <param name="v">version to read at</param>
+/// <returns>its state then, null if it didn't exist yet</returns>
+std::shared_ptr<const AccountVersion> VersionStore::at(Account& a, std::uint64_t v)
+{
+	std::shared_ptr<AccountVersion> node = std::atomic_load(&a.VersionHead);
+	while (node && node->version > v) node = std::atomic_load(&node->older);
+	return node;
+}
+
+/// <summary>
+/// counts the states an account is holding
+/// </summary>
+/// <param name="a">account</param>
+/// <returns>chain length</returns>
+int VersionStore::retained(Account& a)
+{
+	int n = 0;
+	for (std::shared_ptr<AccountVersion> node = std::atomic_load(&a.VersionHead); node; node = std::atomic_load(&node->older)) n++;
+	return n;
+}
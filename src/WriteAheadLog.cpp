@@ -0,0 +1,634 @@
+#include "BankDB.h"
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace DB;
+
+//file layout: header (magic, version, sequence number of the record before the first frame), then frames. a snapshot checkpoint
+//rotates the log to a new file whose header starts at the checkpoint; files from before checkpoints have no header & start at 0
+//frame layout: payload size, payload checksum, payload. the checksum lets replay tell a torn tail from a real record
+//payload layout: kind, then the fields for that kind
+static const std::uint8_t KIND_CUSTOMER = 0; //name, password
+static const std::uint8_t KIND_EMPLOYEE = 1; //name, password
+static const std::uint8_t KIND_ACCOUNT = 2; //ID, type, product, owner, interest state, count, transactions
+static const std::uint8_t KIND_POSTING = 3; //account ID, transaction
+static const std::uint8_t KIND_INTEREST = 4; //account ID, interest state
+static const std::uint8_t KIND_OWNER = 5; //account ID, customer name
+static const std::uint8_t KIND_TRANSFER = 6; //from ID, debit, to ID, credit; both legs in one record so a crash can't keep just one
+static const std::uint8_t KIND_PASSWORD = 7; //name, new password
+
+static const std::uint32_t LOG_MAGIC = 0x474F4C42; //"BLOG"
+static const std::uint32_t LOG_VERSION = 1;
+static const size_t LOG_HEADER_SIZE = 16;
+
+/// <summary>
+/// log file header for a file whose first frame follows record base
+/// </summary>
+static std::string logHeader(std::uint64_t base)
+{
+	std::string out;
+	writeRaw<std::uint32_t>(out, LOG_MAGIC);
+	writeRaw<std::uint32_t>(out, LOG_VERSION);
+	writeRaw<std::uint64_t>(out, base);
+	return out;
+}
+
+/// <summary>
+/// reads a log file's header
+/// </summary>
+/// <param name="data">file contents</param>
+/// <param name="base">set to the sequence number before the first frame</param>
+/// <returns>where the first frame starts; past the end for a header torn mid-write</returns>
+static size_t readLogHeader(const std::string& data, std::uint64_t& base)
+{
+	base = 0;
+	std::uint32_t magic = 0;
+	if (data.size() >= sizeof(magic)) std::memcpy(&magic, data.data(), sizeof(magic));
+	if (magic != LOG_MAGIC) return 0; //no header
+	if (data.size() < LOG_HEADER_SIZE) return data.size() + 1;
+	std::memcpy(&base, data.data() + 8, sizeof(base));
+	return LOG_HEADER_SIZE;
+}
+
+/// <summary>
+/// FNV-1a over a payload
+/// </summary>
+static std::uint32_t checksum(const std::string& s)
+{
+	std::uint32_t h = 2166136261u;
+	for (unsigned char c : s)
+	{
+		h ^= c;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+/// <summary>
+/// writes an account's interest state: accrued so far, last interest, last payout
+/// </summary>
+static void writeInterest(std::string& out, Account& a)
+{
+	writeRaw<std::int32_t>(out, a.accruedInterest().getValue());
+	writeRaw<std::int64_t>(out, a.LastInterest.time_since_epoch().count());
+	writeRaw<std::int64_t>(out, a.LastPayout.time_since_epoch().count());
+}
+
+/// <summary>
+/// an interest state read back from a record
+/// </summary>
+struct InterestState
+{
+	USDollar soFar;
+	std::chrono::system_clock::time_point last; //last interest
+	std::chrono::system_clock::time_point paid; //last payout
+};
+
+/// <summary>
+/// reads an interest state written by writeInterest
+/// </summary>
+static InterestState readInterest(RecordReader& r)
+{
+	InterestState s;
+	s.soFar = USDollar(r.read<std::int32_t>());
+	s.last = std::chrono::system_clock::time_point(std::chrono::system_clock::duration(r.read<std::int64_t>()));
+	s.paid = std::chrono::system_clock::time_point(std::chrono::system_clock::duration(r.read<std::int64_t>()));
+	return s;
+}
+
+/// <summary>
+/// Constructor; opens the log for appending, keeping whatever it already holds
+/// </summary>
+/// <param name="p">log file path</param>
+/// <param name="m">sync mode</param>
+/// <param name="records">sequence number of the newest record in the file, so numbering carries on from it; a new file starts here</param>
+WriteAheadLog::WriteAheadLog(std::string p, SyncMode m, std::uint64_t records)
+{
+	path = p;
+	mode = m;
+	appended = records;
+	durable = records;
+#ifdef _WIN32
+	fd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+	fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+#endif
+	if (fd < 0) throw ExLogIO("WriteAheadLog::WriteAheadLog");
+#ifdef _WIN32
+	bool empty = _lseeki64(fd, 0, SEEK_END) == 0;
+#else
+	bool empty = lseek(fd, 0, SEEK_END) == 0;
+#endif
+	try
+	{
+		if (empty) writeDurable(logHeader(records));
+	}
+	catch (Exception&)
+	{
+		closeFile();
+		throw;
+	}
+}
+
+/// <summary>
+/// Destructor; everything appended is already on disk, so this only closes the file
+/// </summary>
+WriteAheadLog::~WriteAheadLog()
+{
+	closeFile();
+}
+
+/// <summary>
+/// closes the log file
+/// </summary>
+void WriteAheadLog::closeFile()
+{
+	if (fd < 0) return;
+#ifdef _WIN32
+	_close(fd);
+#else
+	close(fd);
+#endif
+	fd = -1;
+}
+
+/// <summary>
+/// writes bytes & forces them to disk
+/// </summary>
+/// <param name="bytes">framed records</param>
+void WriteAheadLog::writeDurable(const std::string& bytes)
+{
+	size_t done = 0;
+	while (done < bytes.size())
+	{
+#ifdef _WIN32
+		int n = _write(fd, bytes.data() + done, (unsigned int)(bytes.size() - done));
+#else
+		ssize_t n = write(fd, bytes.data() + done, bytes.size() - done);
+#endif
+		if (n <= 0) throw ExLogIO("WriteAheadLog::writeDurable");
+		done += (size_t)n;
+	}
+#ifdef _WIN32
+	if (_commit(fd) != 0) throw ExLogIO("WriteAheadLog::writeDurable");
+#else
+	if (fsync(fd) != 0) throw ExLogIO("WriteAheadLog::writeDurable");
+#endif
+}
+
+/// <summary>
+/// appends one record & waits until it's on disk
+/// </summary>
+/// <param name="record">record from one of the builders</param>
+void WriteAheadLog::append(const std::string& record)
+{
+	waitDurable(enqueue(record));
+}
+
+/// <summary>
+/// queues a record; with SyncEachRecord it's written & synced right here instead
+/// </summary>
+/// <param name="record">record from one of the builders</param>
+/// <returns>sequence number to wait on</returns>
+std::uint64_t WriteAheadLog::enqueue(const std::string& record)
+{
+	std::string framed;
+	writeRaw<std::uint32_t>(framed, (std::uint32_t)record.size());
+	writeRaw<std::uint32_t>(framed, checksum(record));
+	framed += record;
+
+	std::lock_guard<std::mutex> guard(lock);
+	if (failed) throw ExLogIO("WriteAheadLog::enqueue");
+	if (mode == SyncEachRecord)
+	{
+		try
+		{
+			writeDurable(framed);
+		}
+		catch (Exception&)
+		{
+			failed = true;
+			throw;
+		}
+		synced++;
+		durable = ++appended;
+		return appended;
+	}
+	pending += framed;
+	return ++appended;
+}
+
+/// <summary>
+/// Waits for a record to reach disk. The first waiter to find no sync running becomes the leader: it takes every pending record,
+/// writes & syncs them with the lock released, then wakes everyone its sync covered. Anyone who queued meanwhile goes in the next group
+/// </summary>
+/// <param name="seq">sequence number from enqueue</param>
+void WriteAheadLog::waitDurable(std::uint64_t seq)
+{
+	std::unique_lock<std::mutex> guard(lock);
+	while (durable < seq)
+	{
+		if (failed) throw ExLogIO("WriteAheadLog::waitDurable");
+		if (flushing)
+		{
+			flushed.wait(guard);
+			continue;
+		}
+
+		//lead the next group
+		flushing = true;
+		std::string group;
+		group.swap(pending);
+		std::uint64_t upTo = appended;
+		guard.unlock();
+		bool ok = true;
+		try
+		{
+			writeDurable(group);
+		}
+		catch (Exception&)
+		{
+			ok = false;
+		}
+		guard.lock();
+		flushing = false;
+		if (ok)
+		{
+			durable = upTo;
+			synced++;
+		}
+		else
+		{
+			failed = true;
+		}
+		flushed.notify_all();
+	}
+}
+
+/// <summary>
+/// Drops the records a snapshot already has. Everything queued is synced first, then the records after seq are copied to a new
+/// file that starts at seq, which is synced & renamed over the log, so a crash leaves either the whole old log or the new one.
+/// Appends wait while this runs, but it only copies what came in since the snapshot
+/// </summary>
+/// <param name="seq">newest record the snapshot has</param>
+/// <returns>was the log cut down, bool; when it wasn't the old log is still whole & still in use</returns>
+bool WriteAheadLog::checkpoint(std::uint64_t seq)
+{
+	std::unique_lock<std::mutex> guard(lock);
+	while (flushing) flushed.wait(guard); //nothing else writes the file while we hold the lock now
+	if (failed || seq > appended) return false;
+	if (!pending.empty())
+	{
+		try
+		{
+			writeDurable(pending);
+		}
+		catch (Exception&)
+		{
+			failed = true;
+			flushed.notify_all();
+			return false;
+		}
+		pending.clear();
+		durable = appended;
+		synced++;
+		flushed.notify_all();
+	}
+
+	std::ifstream in(path, std::ios::binary);
+	std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	in.close();
+	std::uint64_t base = 0;
+	size_t at = readLogHeader(data, base);
+	if (seq <= base) return true; //already starts there
+	for (std::uint64_t n = base; n < seq; n++)
+	{
+		std::uint32_t size = 0;
+		if (at + 8 > data.size()) return false;
+		std::memcpy(&size, data.data() + at, sizeof(size));
+		at += 8 + (size_t)size;
+	}
+	if (at > data.size()) return false;
+
+	bool replaced = replaceFile(path, logHeader(seq) + data.substr(at));
+	//reopen by name either way; the old descriptor points at the replaced file if the rename went through
+	closeFile();
+#ifdef _WIN32
+	fd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+	fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+#endif
+	if (fd < 0)
+	{
+		failed = true;
+		return false;
+	}
+	return replaced;
+}
+
+/// <summary>
+/// record for a new customer
+/// </summary>
+std::string WriteAheadLog::customerRecord(User& u)
+{
+	std::string out;
+	writeRaw<std::uint8_t>(out, KIND_CUSTOMER);
+	writeString(out, u.name);
+	writeString(out, u.password);
+	return out;
+}
+
+/// <summary>
+/// record for a new employee
+/// </summary>
+std::string WriteAheadLog::employeeRecord(User& u)
+{
+	std::string out;
+	writeRaw<std::uint8_t>(out, KIND_EMPLOYEE);
+	writeString(out, u.name);
+	writeString(out, u.password);
+	return out;
+}
+
+/// <summary>
+/// record for a new account, with the transactions it was created with
+/// </summary>
+/// <param name="a">account</param>
+/// <param name="owner">owning customer, empty for none</param>
+std::string WriteAheadLog::accountRecord(Account& a, std::string owner)
+{
+	std::string out;
+	std::lock_guard<std::recursive_mutex> guard(a.Lock);
+	writeRaw<std::uint8_t>(out, KIND_ACCOUNT);
+	writeString(out, a.ID);
+	writeRaw<std::uint8_t>(out, accountTypeCode(a));
+	writeRaw<std::int32_t>(out, a.ProductID);
+	writeString(out, owner);
+	writeInterest(out, a);
+	writeRaw<std::int32_t>(out, a.Transactions.getCount());
+	a.Transactions.forEach([&](std::shared_ptr<Transaction> t)
+	{
+		writeTransaction(out, *t);
+		return true;
+	});
+	return out;
+}
+
+/// <summary>
+/// record for a transaction posted to an account
+/// </summary>
+std::string WriteAheadLog::postingRecord(std::string id, Transaction& t)
+{
+	std::string out;
+	writeRaw<std::uint8_t>(out, KIND_POSTING);
+	writeString(out, id);
+	writeTransaction(out, t);
+	return out;
+}
+
+/// <summary>
+/// record for an account's interest state after an accrual or payout
+/// </summary>
+std::string WriteAheadLog::interestRecord(Account& a)
+{
+	std::string out;
+	writeRaw<std::uint8_t>(out, KIND_INTEREST);
+	writeString(out, a.ID);
+	writeInterest(out, a);
+	return out;
+}
+
+/// <summary>
+/// record for an interest state an account is about to have, for a change that's logged before it's made
+/// </summary>
+std::string WriteAheadLog::interestRecord(std::string id, std::int32_t soFar, std::chrono::system_clock::time_point last, std::chrono::system_clock::time_point paid)
+{
+	std::string out;
+	writeRaw<std::uint8_t>(out, KIND_INTEREST);
+	writeString(out, id);
+	writeRaw<std::int32_t>(out, soFar);
+	writeRaw<std::int64_t>(out, last.time_since_epoch().count());
+	writeRaw<std::int64_t>(out, paid.time_since_epoch().count());
+	return out;
+}
+
+/// <summary>
+/// record for a customer added to an existing account
+/// </summary>
+std::string WriteAheadLog::ownerRecord(std::string id, std::string owner)
+{
+	std::string out;
+	writeRaw<std::uint8_t>(out, KIND_OWNER);
+	writeString(out, id);
+	writeString(out, owner);
+	return out;
+}
+
+/// <summary>
+/// record for both legs of a transfer
+/// </summary>
+std::string WriteAheadLog::transferRecord(std::string from, Transaction& out, std::string to, Transaction& in)
+{
+	std::string rec;
+	writeRaw<std::uint8_t>(rec, KIND_TRANSFER);
+	writeString(rec, from);
+	writeTransaction(rec, out);
+	writeString(rec, to);
+	writeTransaction(rec, in);
+	return rec;
+}
+
+/// <summary>
+/// record for a changed password, customer or employee
+/// </summary>
+std::string WriteAheadLog::passwordRecord(User& u)
+{
+	std::string out;
+	writeRaw<std::uint8_t>(out, KIND_PASSWORD);
+	writeString(out, u.name);
+	writeString(out, u.password);
+	return out;
+}
+
+/// <summary>
+/// Applies one record to a database. Postings & interest records an account already reflects (a snapshot was taken after them) are skipped
+/// </summary>
+/// <param name="payload">record</param>
+/// <param name="seq">the record's sequence number</param>
+/// <param name="d">database</param>
+/// <returns>was the record understood, bool</returns>
+static bool applyRecord(const std::string& payload, std::uint64_t seq, Database& d)
+{
+	RecordReader r(payload);
+	std::uint8_t kind = r.read<std::uint8_t>();
+	switch (kind)
+	{
+		case KIND_CUSTOMER:
+		case KIND_EMPLOYEE:
+		{
+			std::string name = r.readString();
+			std::string pass = r.readString();
+			if (!r.good()) return false;
+			if (kind == KIND_CUSTOMER) d.addCustomer(arenaShared<Customer>(d.Memory.get(), name, pass));
+			else d.addEmployee(std::shared_ptr<Employee>(new Employee(name, pass)));
+			return true;
+		}
+		case KIND_ACCOUNT:
+		{
+			std::string id = r.readString();
+			if (d.findAccount(id)) return true; //already there from a snapshot; no need to build it
+			std::uint8_t code = r.read<std::uint8_t>();
+			int product = r.read<std::int32_t>();
+			std::string owner = r.readString();
+			InterestState interest = readInterest(r);
+			int count = r.read<std::int32_t>();
+			if (!r.good() || count < 1) return false;
+			std::shared_ptr<Transaction> first = r.readTransaction(d.Memory.get());
+			if (!first) return false;
+
+			std::shared_ptr<Account> a = makeAccount(code, first, id, d.Memory.get());
+			if (!a) return false;
+			for (int i = 1; i < count; i++)
+			{
+				std::shared_ptr<Transaction> t = r.readTransaction();
+				if (!t) return false;
+				a->processTransaction(t);
+			}
+			a->setInterestType(product);
+			a->restoreInterest(interest.soFar, interest.last, interest.paid);
+			a->LoggedSeq = seq;
+			d.addAccount(a, owner.empty() ? std::shared_ptr<Customer>() : d.findCustomer(owner));
+			return true;
+		}
+		case KIND_POSTING:
+		{
+			std::string id = r.readString();
+			std::shared_ptr<Transaction> t = r.readTransaction();
+			if (!t) return false;
+			std::shared_ptr<Account> a = d.findAccount(id);
+			if (a && seq > a->LoggedSeq)
+			{
+				a->processTransaction(t);
+				a->LoggedSeq = seq;
+			}
+			return true;
+		}
+		case KIND_INTEREST:
+		{
+			std::string id = r.readString();
+			InterestState interest = readInterest(r);
+			if (!r.good()) return false;
+			std::shared_ptr<Account> a = d.findAccount(id);
+			if (a && seq > a->LoggedSeq)
+			{
+				a->restoreInterest(interest.soFar, interest.last, interest.paid);
+				a->LoggedSeq = seq;
+				d.reschedule(a); //its due dates moved
+			}
+			return true;
+		}
+		case KIND_TRANSFER:
+		{
+			std::string from = r.readString();
+			std::shared_ptr<Transaction> out = r.readTransaction();
+			std::string to = r.readString();
+			std::shared_ptr<Transaction> in = r.readTransaction();
+			if (!out || !in) return false;
+			std::shared_ptr<Account> a = d.findAccount(from);
+			std::shared_ptr<Account> b = d.findAccount(to);
+			bool applyOut = a && seq > a->LoggedSeq; //decided before either leg, so a transfer to itself gets both
+			bool applyIn = b && seq > b->LoggedSeq;
+			if (applyOut)
+			{
+				a->applyLogged(out);
+				a->LoggedSeq = seq;
+			}
+			if (applyIn)
+			{
+				b->applyLogged(in);
+				b->LoggedSeq = seq;
+			}
+			return true;
+		}
+		case KIND_OWNER:
+		{
+			std::string id = r.readString();
+			std::string owner = r.readString();
+			if (!r.good()) return false;
+			d.addOwner(id, d.findCustomer(owner)); //already an owner when a snapshot has it, which is fine
+			return true;
+		}
+		case KIND_PASSWORD:
+		{
+			std::string name = r.readString();
+			std::string pass = r.readString();
+			if (!r.good()) return false;
+			d.setPassword(name, pass); //already this password when a snapshot has it, which is fine
+			return true;
+		}
+		default:
+			return false;
+	}
+}
+
+/// <summary>
+/// replays a log file into a database. Call before the database's log is attached, so replayed mutations aren't logged twice
+/// </summary>
+/// <param name="path">log file path; a missing file replays nothing</param>
+/// <param name="d">database to rebuild</param>
+/// <returns>records applied; throws ExLogReplay at an intact record it can't apply</returns>
+int WriteAheadLog::replay(std::string path, Database& d)
+{
+	std::uint64_t validBytes = 0;
+	std::uint64_t lastSeq = 0;
+	return replay(path, d, validBytes, lastSeq);
+}
+
+/// <summary>
+/// Replays a log file into a database, noting where the intact records end. Records up to from are already in the snapshot
+/// the database was loaded from, so they're only checked, not decoded
+/// </summary>
+/// <param name="path">log file path; a missing file replays nothing</param>
+/// <param name="d">database to rebuild</param>
+/// <param name="validBytes">set to the length of the intact part of the file; anything after is a torn write</param>
+/// <param name="lastSeq">set to the sequence number of the newest intact record</param>
+/// <param name="from">log checkpoint of the loaded snapshot, 0 for none</param>
+/// <returns>records applied; throws ExLogReplay at an intact record it can't apply, which isn't a torn write & mustn't be cut off</returns>
+int WriteAheadLog::replay(std::string path, Database& d, std::uint64_t& validBytes, std::uint64_t& lastSeq, std::uint64_t from)
+{
+	validBytes = 0;
+	lastSeq = from;
+	std::ifstream in(path, std::ios::binary);
+	if (!in) return 0;
+	std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	std::uint64_t base = 0;
+	size_t start = readLogHeader(data, base);
+	if (start > data.size()) return 0; //header torn as the file was made
+	validBytes = start;
+	if (base > lastSeq) lastSeq = base; //rotated at a newer snapshot than the one loaded; the records between are gone
+
+	int applied = 0;
+	std::uint64_t seq = base;
+	RecordReader r(data);
+	r.readBytes(start);
+	while (!r.atEnd())
+	{
+		std::uint32_t size = r.read<std::uint32_t>();
+		std::uint32_t sum = r.read<std::uint32_t>();
+		std::string payload = r.readBytes(size);
+		if (!r.good() || checksum(payload) != sum) break; //torn tail from a crash mid-write; everything before it is intact
+		seq++;
+		if (seq > from)
+		{
+			if (!applyRecord(payload, seq, d)) throw ExLogReplay("WriteAheadLog::replay", seq);
+			applied++;
+		}
+		lastSeq = seq;
+		validBytes = r.position();
+	}
+	return applied;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "List.h"
+#include "Records.h"
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+namespace DB
+{
+	//Forward declarations
+	class Transaction;
+
+	/// <summary>
+	/// Thrown when the archive file can't be read or written
+	/// </summary>
+	class ExArchiveIO : public Exception
+	{
+		public:
+			/// <summary>
+			/// Constructor
+			/// </summary>
+			/// <param name="s">throwing function</param>
+			ExArchiveIO(std::string s) : Exception(s) {}
+
+			/// <summary>
+			/// print the error to cout
+			/// </summary>
+			void printError()
+			{
+				std::cout << "Could not access the transaction archive, while executing function: " << throwingFunc << "\n";
+			}
+	};
+
+	/// <summary>
+	/// Location of one spilled block of an account's history; this is all an account keeps in memory for its cold transactions
+	/// </summary>
+	struct ArchiveSegment
+	{
+		std::uint64_t offset = 0; //byte offset of the block in the archive file
+		int count = 0; //number of transactions in the block
+		std::uint32_t bytes = 0; //size of the block in the file
+		std::chrono::system_clock::time_point first; //oldest timestamp in the block
+		std::chrono::system_clock::time_point last; //newest timestamp in the block
+	};
+
+	/// <summary>
+	/// Cold tier for transaction history. Accounts append their oldest settled transactions as compact binary blocks & read them back only when asked
+	/// </summary>
+	class TransactionArchive
+	{
+		public:
+			TransactionArchive(std::string p, bool keep = false);
+			~TransactionArchive() {}
+
+			//appends a block of transactions for an account, returns where it went
+			ArchiveSegment append(std::string id, LinkedList<Transaction>& block);
+			//reads a block back into memory, oldest first
+			LinkedList<Transaction> load(const ArchiveSegment& seg);
+
+			//file the archive lives in
+			std::string getPath()
+			{
+				return path;
+			}
+
+		private:
+			std::string path; //archive file path
+			std::fstream file; //kept open for the life of the archive
+			std::mutex lock; //one reader/writer at a time on the file
+	};
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <memory>
+#include <memory_resource>
+#include <utility>
+
+/// <summary>
+/// Memory for one bank's objects: list nodes, accounts, customers & transactions come out of size-classed pools carved from big
+/// blocks, instead of one heap allocation each. Freed objects go back to their pool for reuse; the blocks themselves are only
+/// handed back when the arena goes away. Everything made in it holds it through its allocator, as do the database, its accounts &
+/// its lists, so the arena lasts until the last of them is gone; it has to be owned by a shared_ptr
+/// </summary>
+class Arena : public std::enable_shared_from_this<Arena>
+{
+	public:
+		Arena() {}
+		~Arena() {}
+		Arena(const Arena&) = delete;
+		Arena& operator=(const Arena&) = delete;
+
+		//the pools; thread safe
+		std::pmr::memory_resource* resource()
+		{
+			return &pools;
+		}
+
+		//makes a shared object in the arena, with its control block alongside it; the block keeps the arena alive
+		template <typename T, typename... A>
+		std::shared_ptr<T> make(A&&... args);
+
+	private:
+		std::pmr::monotonic_buffer_resource blocks; //big blocks, only released with the arena
+		std::pmr::synchronized_pool_resource pools{ &blocks }; //size classes carved from blocks
+};
+
+/// <summary>
+/// Allocator for std::allocate_shared that draws from an arena. The control block keeps a copy, so the arena can't go while
+/// anything it made is still around, even after the database
+/// </summary>
+template <typename T>
+class ArenaAllocator
+{
+	public:
+		typedef T value_type;
+
+		ArenaAllocator(std::shared_ptr<Arena> a) : arena(std::move(a)) {}
+		template <typename U>
+		ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+		T* allocate(size_t n)
+		{
+			return static_cast<T*>(arena->resource()->allocate(n * sizeof(T), alignof(T)));
+		}
+
+		void deallocate(T* p, size_t n)
+		{
+			arena->resource()->deallocate(p, n * sizeof(T), alignof(T));
+		}
+
+		template <typename U>
+		bool operator==(const ArenaAllocator<U>& other) const
+		{
+			return arena == other.arena;
+		}
+
+		template <typename U>
+		bool operator!=(const ArenaAllocator<U>& other) const
+		{
+			return arena != other.arena;
+		}
+
+		std::shared_ptr<Arena> arena;
+};
+
+template <typename T, typename... A>
+std::shared_ptr<T> Arena::make(A&&... args)
+{
+	return std::allocate_shared<T>(ArenaAllocator<T>(shared_from_this()), std::forward<A>(args)...);
+}
+
+/// <summary>
+/// makes a shared object in an arena when there is one, on the heap otherwise
+/// </summary>
+/// <param name="a">arena, may be null</param>
+/// <param name="args">constructor arguments</param>
+/// <returns>the object</returns>
+template <typename T, typename... A>
+std::shared_ptr<T> arenaShared(Arena* a, A&&... args)
+{
+	if (a) return a->make<T>(std::forward<A>(args)...);
+	return std::shared_ptr<T>(new T(std::forward<A>(args)...));
+}
@@ -54,109 +54,96 @@ namespace Client
 	class MnuCustomerStart : public Menu
 	{
 		public:
-			MnuCustomerStart(std::string us, std::string pss)
+			MnuCustomerStart(std::string tkn)
 			{
-				user = us;
-				pass = pss;
+				token = tkn;
 				logic();
 			}
 			~MnuCustomerStart() {
 	
 			}
 			void logic();
-			std::string user;
-			std::string pass;
+			std::string token; //session from login, in place of the user's name & password
 	};
 	class MnuEmployeeStart : public Menu
 	{
 		public:
-			MnuEmployeeStart(std::string us, std::string pss)
+			MnuEmployeeStart(std::string tkn)
 			{
-				user = us;
-				pass = pss;
+				token = tkn;
 				logic();
 			}
 			~MnuEmployeeStart() {
 	
 			}
 			void logic();
-			std::string user;
-			std::string pass;
+			std::string token;
 	};
 	class MnuEmployeeCreation : public Menu
 	{
 		public:
-			MnuEmployeeCreation(std::string us, std::string pss)
+			MnuEmployeeCreation(std::string tkn)
 			{
-				user = us;
-				pass = pss;
+				token = tkn;
 				logic();
 			}
 			~MnuEmployeeCreation() {
 	
 			}
 			void logic();
-			std::string user;
-			std::string pass;
+			std::string token;
 	};
 	class MnuCustomerCreation : public Menu
 	{
 		public:
-			MnuCustomerCreation(std::string us, std::string pss)
+			MnuCustomerCreation(std::string tkn)
 			{
-				user = us;
-				pass = pss;
+				token = tkn;
 				logic();
 			}
 			~MnuCustomerCreation() {
 	
 			}
 			void logic();
-			std::string user;
-			std::string pass;
+			std::string token;
 	};
 
 	class MnuChangePassword : public Menu
 	{
 	public:
-		MnuChangePassword(std::string us, std::string pss)
+		MnuChangePassword(std::string tkn)
 		{
-			user = us;
-			pass = pss;
+			token = tkn;
 			logic();
 		}
 		~MnuChangePassword() {
 
 		}
 		void logic();
-		std::string user;
-		std::string pass;
+		std::string token;
 	};
 
 	class MnuAccountCreation : public Menu
 	{
 	public:
-		MnuAccountCreation(std::string us, std::string pss)
+		MnuAccountCreation(std::string tkn)
 		{
-			user = us;
-			pass = pss;
+			token = tkn;
 			logic();
 		}
 		~MnuAccountCreation() {
 
 		}
 		void logic();
-		std::string user;
-		std::string pass;
+		std::string token;
 	};
 
 	class MnuTransferBetweenAccounts : public Menu
 	{
 		public:
-			MnuTransferBetweenAccounts(std::string us, std::string pss)
+			MnuTransferBetweenAccounts(std::string tkn)
 			{
-				user = us;
-				pass = pss;
+				token = tkn;
 				logic();
 			}
 			~MnuTransferBetweenAccounts()
@@ -165,16 +152,14 @@ namespace Client
 			}
 			void logic();
 			//strings for logic
-			std::string user;
-			std::string pass;
+			std::string token;
 	};
 	class MnuDeposit : public Menu
 	{
 		public:
-			MnuDeposit(std::string us, std::string pss)
+			MnuDeposit(std::string tkn)
 			{
-				user = us;
-				pass = pss;
+				token = tkn;
 				logic();
 			}
 			~MnuDeposit() {
@@ -182,17 +167,15 @@ namespace Client
 			}
 			void logic();
 			//strings for logic
-			std::string user;
-			std::string pass;
+			std::string token;
 	};
 
 	class MnuGetAccounts : public Menu
 	{
 	public:
-		MnuGetAccounts(std::string us, std::string pss)
+		MnuGetAccounts(std::string tkn)
 		{
-			user = us;
-			pass = pss;
+			token = tkn;
 			logic();
 		}
 		~MnuGetAccounts() {
@@ -200,17 +183,15 @@ namespace Client
 		}
 		void logic();
 		//strings for logic
-		std::string user;
-		std::string pass;
+		std::string token;
 	};
 
 	class MnuGetAccountHistory : public Menu
 	{
 		public:
-			MnuGetAccountHistory(std::string us, std::string pss, std::string acc)
+			MnuGetAccountHistory(std::string tkn, std::string acc)
 			{
-				user = us;
-				pass = pss;
+				token = tkn;
 				account = acc;
 				logic();
 			}
@@ -219,8 +200,7 @@ namespace Client
 			}
 			void logic();
 			//strings for logic
-			std::string user;
-			std::string pass;
+			std::string token;
 			std::string account;
 	};
 
@@ -228,10 +208,9 @@ namespace Client
 	class MnuManualBankOperations : public Menu
 	{
 	public:
-		MnuManualBankOperations(std::string us, std::string pss)
+		MnuManualBankOperations(std::string tkn)
 		{
-			user = us;
-			pass = pss;
+			token = tkn;
 			logic();
 		}
 		~MnuManualBankOperations() {
@@ -239,7 +218,6 @@ namespace Client
 		}
 		void logic();
 		//strings for logic
-		std::string user;
-		std::string pass;
+		std::string token;
 	};
 }
@@ -1,7 +1,24 @@
 #pragma once
 #include "List.h"
+#include "Archive.h"
+#include "BulkLoader.h"
+#include "Clock.h"
+#include "Products.h"
+#include "Query.h"
+#include "Scheduler.h"
+#include "SecondaryIndex.h"
+#include "Snapshot.h"
+#include "Statement.h"
+#include "ThreadPool.h"
+#include "Versions.h"
+#include "WriteAheadLog.h"
 #include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace DB
 {
@@ -29,6 +46,12 @@ namespace DB
 				return formattedValue().compare(s); //compares formatted value string
 			}
 
+			//raw stored value, used when writing to disk
+			int getValue() const
+			{
+				return value;
+			}
+
 		protected:
 			int value; //value is stored as int to innately handle 
 
@@ -151,6 +174,11 @@ namespace DB
 			{
 				Val = c;
 			};
+			//constructor with a known time, for transactions coming back from storage
+			Transaction(USDollar c, std::chrono::system_clock::time_point ts) : Timestamp(ts)
+			{
+				Val = c;
+			}
 			virtual ~Transaction(){} //destructor
 			const std::chrono::system_clock::time_point Timestamp = std::chrono::system_clock::now(); //time, to resolve conflicts + sorting
 			USDollar Val; //the actual value of the transaction
@@ -177,6 +205,10 @@ namespace DB
 				Name = n;
 				Origin = o;
 			}
+			Purchase(USDollar c, std::string n, std::string o, std::chrono::system_clock::time_point ts) : Transaction(c, ts) {
+				Name = n;
+				Origin = o;
+			}
 			~Purchase() {}
 
 			std::string TransactionType() { return "Purchase"; }
@@ -191,6 +223,9 @@ namespace DB
 			Transfer(USDollar c, std::string n) : Transaction(c) {
 				Name = n;
 			}
+			Transfer(USDollar c, std::string n, std::chrono::system_clock::time_point ts) : Transaction(c, ts) {
+				Name = n;
+			}
 			~Transfer() {}
 
 			std::string TransactionType() { return "Transfer"; }
@@ -207,6 +242,10 @@ namespace DB
 				Origin = o;
 
 			}
+			Deposit(USDollar c, std::string o, std::chrono::system_clock::time_point ts) : Transaction(c, ts) {
+				Name = "Deposit";
+				Origin = o;
+			}
 		~Deposit() {}
 
 		std::string TransactionType() { return "Deposit"; }
@@ -221,6 +260,9 @@ namespace DB
 			BankFunction(USDollar c, std::string n = "Bank Function") : Transaction(c) {
 				Name = n;
 			}
+			BankFunction(USDollar c, std::string n, std::chrono::system_clock::time_point ts) : Transaction(c, ts) {
+				Name = n;
+			}
 			~BankFunction() {}
 
 			std::string TransactionType() { return "Bank Function"; }
@@ -230,9 +272,10 @@ namespace DB
 	/// <summary>
 	/// Bank Accounts base class
 	/// </summary>
-	class Account
+	class Account : public std::enable_shared_from_this<Account>
 	{
 		friend class Interest; //forward declaration of friendship
+		friend class InterestBatch; //batch engine writes accruals back
 		public:
 			Account(std::shared_ptr<Transaction> t, std::string id) {
 				Transactions = LinkedList<Transaction>(t); //construct Transaction list
@@ -241,39 +284,293 @@ namespace DB
 				ID = id; //gets the name; we always want a unique name, 0000 would be an error/placeholder
 			}
 			virtual ~Account(){}
-			LinkedList<Transaction> Transactions; //transaction history!
+			LinkedList<Transaction> Transactions; //transaction history! only the hot window when an archive is attached
+			int ProductID = 0; //interest product, see Products.h; 0 is no interest
 			std::string ID = "0000"; //identifier
 			USDollar balance; //total balance; updated when transactions gets changed
 			USDollar available; //total available; in theory, it is total balance - account minimum & certain charges
+			//guards Transactions, the balances & the interest members. recursive so a holder of the lock can still call deposit/purchase/etc.
+			std::recursive_mutex Lock;
 			
 			//time members; will just go unused when interest is disabled
-			//last time paid out; compared against for current payout. default is now(), whenever it is initialized.
-			std::chrono::system_clock::time_point LastPayout = std::chrono::system_clock::now();
-			//last time interest came in; compared against for interest. default is now(), whenever it is initialized.
-			std::chrono::system_clock::time_point LastInterest = std::chrono::system_clock::now();
+			//when it was made, on the system clock; the interest times below start here until a bank moves them onto its own clock
+			std::chrono::system_clock::time_point Made = std::chrono::system_clock::now();
+			//last time paid out; compared against for current payout. default is when it was made
+			std::chrono::system_clock::time_point LastPayout = Made;
+			//last time interest came in; compared against for interest. default is when it was made
+			std::chrono::system_clock::time_point LastInterest = Made;
+
+			//tiering members; old settled transactions move to the archive & only their block locations stay in memory
+			std::shared_ptr<TransactionArchive> Archive; //cold storage, null when tiering is off
+			std::vector<ArchiveSegment> ArchivedSegments; //archived blocks, oldest first
+			int HotWindow = 256; //transactions kept in memory after a spill
+			int archivedCount = 0; //transactions in the archive
+			USDollar archivedBalance = USDollar(0); //sum of archived transactions; they're all settled, so this counts for available too
+			std::chrono::system_clock::time_point CompactedBefore = std::chrono::system_clock::time_point::min(); //archived blocks ending before this are already compact
+			std::shared_ptr<WriteAheadLog> Log; //durable log of every posting, null when logging is off
+			std::uint64_t LoggedSeq = 0; //sequence number of the newest log record this account reflects
+			std::shared_ptr<SecondaryIndex> Indices; //type/product/overdrawn index this account is listed in, null until it's in a bank
+			std::shared_ptr<InterestScheduler> Scheduler; //due-date queue this account's interest is kept in, null until it's in a bank
+			std::shared_ptr<TimeSource> Time; //the bank's clock, null reads the system clock until it's in a bank
+			std::uint64_t ScheduledVersion = 0; //version of its live entry in Scheduler; guarded by the scheduler, not Lock
+			bool ListedNegative = false; //overdrawn as far as Indices knows; only a change is reported
+			//first log record of an interest run's change that's logged but waiting on its sync, 0 for none; other runs leave the
+			//account be until it's made. guarded by Lock
+			std::uint64_t InterestInFlight = 0;
+			//versioning members; every commit publishes a read-only copy of the balances that readers use without this account's lock
+			std::shared_ptr<VersionStore> Versions; //null until it's in a bank
+			std::shared_ptr<AccountVersion> VersionHead; //newest published state; only touched through std::atomic_load/atomic_store
+			std::uint64_t VersionsTrimmedAt = 0; //oldest version kept when the chain was last trimmed, guarded by Lock
+			int Batched = 0; //open VersionBatches; while above 0, postings wait for the batch to publish them
+			std::shared_ptr<Arena> Memory; //the bank's arena new transactions & history nodes come from, null for the heap
+
+			/// <summary>
+			/// makes new transactions & history nodes in an arena from now on
+			/// </summary>
+			/// <param name="a">arena, null for the heap</param>
+			void setArena(std::shared_ptr<Arena> a)
+			{
+				std::lock_guard<std::recursive_mutex> guard(Lock);
+				Memory = a;
+				Transactions.setArena(a);
+			}
+
+			//current time on the bank's clock; postings & interest are stamped with it
+			std::chrono::system_clock::time_point now()
+			{
+				return Time ? Time->now() : std::chrono::system_clock::now();
+			}
+
+			//makes a transaction in this account's arena
+			template <typename X, typename... A>
+			std::shared_ptr<Transaction> makeTransaction(A&&... args)
+			{
+				return arenaShared<X>(Memory.get(), std::forward<A>(args)...);
+			}
+
+			/// <summary>
+			/// writes a posting to the log before it's applied
+			/// </summary>
+			/// <param name="t">transaction about to be posted</param>
+			/// <returns>is it durable (always true with no log), bool</returns>
+			bool journal(std::shared_ptr<Transaction> t)
+			{
+				if (!Log) return true;
+				try
+				{
+					std::uint64_t seq = Log->enqueue(WriteAheadLog::postingRecord(ID, *t));
+					Log->waitDurable(seq);
+					LoggedSeq = seq;
+					return true;
+				}
+				catch (Exception& ex)
+				{
+					ex.printError();
+					return false;
+				}
+			}
+
+			//writes the interest state to the log after an accrual or payout
+			void journalInterest()
+			{
+				std::lock_guard<std::recursive_mutex> guard(Lock);
+				if (!Log) return;
+				try
+				{
+					std::uint64_t seq = Log->enqueue(WriteAheadLog::interestRecord(*this));
+					Log->waitDurable(seq);
+					LoggedSeq = seq;
+				}
+				catch (Exception& ex)
+				{
+					ex.printError();
+				}
+			}
+
+			//moves interest times nobody has set from the system clock onto the bank's; done once it's in a bank
+			void startClock()
+			{
+				std::lock_guard<std::recursive_mutex> guard(Lock);
+				std::chrono::system_clock::time_point at = now();
+				if (LastInterest == Made) LastInterest = at;
+				if (LastPayout == Made) LastPayout = at;
+				Made = at;
+			}
+
+			//puts interest state back as it was logged; used when rebuilding from the log
+			void restoreInterest(USDollar soFar, std::chrono::system_clock::time_point last, std::chrono::system_clock::time_point paid)
+			{
+				std::lock_guard<std::recursive_mutex> guard(Lock);
+				interestSoFar = soFar;
+				LastInterest = last;
+				LastPayout = paid;
+			}
 
 			void updateBalance() //updates balance & available 
 			{
-				USDollar b(0); //balance
-				USDollar a(0); //available
+				USDollar b = archivedBalance; //balance, starting from the archived history
+				USDollar a = archivedBalance; //available
 				//for each member of the transactions list
-				for (int i = 0; i < Transactions.getCount(); i++)
+				Transactions.forEach([&](std::shared_ptr<Transaction> t)
 				{
-					//get the transaction as a pointer
-					std::shared_ptr<Transaction> t = Transactions.get(i);
-
 					//make sure i actually grabbed a value & not a null ptr
 					if (t)
 					{
 						//check if transaction isn't pending, add to available
 						if (!(t->Pending)) a = a + t->Val;
 						b = b + t->Val; //add to balance
-						//fill the values
-						balance = b;
-						available = a;
 					}
-					t.reset(); //clear the pointer
+					return true;
+				});
+				//fill the values
+				balance = b;
+				available = a;
+				balanceChanged();
+			}
+
+			/// <summary>
+			/// Puts a posting that's already durable (or needs no log) into the history & moves the balances by just its amount,
+			/// instead of summing the whole history again
+			/// </summary>
+			/// <param name="t">transaction to apply</param>
+			/// <returns>was it added, bool</returns>
+			bool applyLogged(std::shared_ptr<Transaction> t)
+			{
+				std::lock_guard<std::recursive_mutex> guard(Lock);
+				if (!t || !Transactions.put(t)) return false;
+				balance = balance + t->Val;
+				if (!t->Pending) available = available + t->Val;
+				balanceChanged();
+				archiveCold(); //move old history out of memory if the hot window is full
+				return true;
+			}
+
+			/// <summary>
+			/// Appends a run of already settled history in one go, for loading; the index, the version store & the archive are
+			/// told once at the end instead of per transaction
+			/// </summary>
+			/// <param name="ts">transactions, oldest first</param>
+			/// <returns>how many were added</returns>
+			int appendHistory(const std::vector<std::shared_ptr<Transaction>>& ts)
+			{
+				std::lock_guard<std::recursive_mutex> guard(Lock);
+				int added = 0;
+				for (const std::shared_ptr<Transaction>& t : ts)
+				{
+					if (!t || !Transactions.put(t)) continue;
+					balance = balance + t->Val;
+					if (!t->Pending) available = available + t->Val;
+					added++;
 				}
+				if (added == 0) return 0;
+				balanceChanged();
+				archiveCold();
+				return added;
+			}
+
+			//tells the index & the version store the balances moved
+			void balanceChanged()
+			{
+				if (Indices && ListedNegative != (balance < 0)) //crossed zero, move it in the overdrawn index
+				{
+					ListedNegative = balance < 0;
+					Indices->negativeChanged(ID, ListedNegative);
+				}
+				if (Versions && Batched == 0) Versions->publish(*this); //readers see it from the next pinned view on
+			}
+
+			/// <summary>
+			/// Moves the oldest settled transactions to the archive once the hot list reaches twice the hot window.
+			/// Pending transactions stop the spill, so nothing unsettled ever leaves memory.
+			/// </summary>
+			void archiveCold()
+			{
+				if (!Archive || HotWindow < 1 || Transactions.getCount() < HotWindow * 2) return;
+				int spill = Transactions.getCount() - HotWindow; //how many we'd like to move
+				LinkedList<Transaction> cold; //going to the archive
+				LinkedList<Transaction> hot; //staying in memory
+				hot.setArena(Memory);
+				USDollar coldSum(0);
+				bool blocked = false;
+				Transactions.forEach([&](std::shared_ptr<Transaction> t)
+				{
+					if (!blocked && cold.getCount() < spill && !t->Pending)
+					{
+						cold.put(t);
+						coldSum = coldSum + t->Val;
+					}
+					else
+					{
+						blocked = true; //keep order; everything after the first kept transaction stays too
+						hot.put(t);
+					}
+					return true;
+				});
+				if (cold.getCount() == 0) return;
+
+				try
+				{
+					ArchivedSegments.push_back(Archive->append(ID, cold));
+					archivedCount += cold.getCount();
+					archivedBalance = archivedBalance + coldSum;
+					Transactions = hot; //drop the cold transactions from memory
+				}
+				catch (Exception& ex)
+				{
+					//keep everything in memory if the archive is unusable
+					ex.printError();
+				}
+			}
+
+			//folds settled history older than horizon into one summary per period, type & name; see BankDB.cpp
+			int compact(std::chrono::system_clock::time_point horizon, std::chrono::system_clock::duration period);
+
+			/// <summary>
+			/// reads one archived block back in; empty if the archive can't be read
+			/// </summary>
+			/// <param name="i">index into ArchivedSegments</param>
+			/// <returns>transactions in the block, oldest first</returns>
+			LinkedList<Transaction> loadArchived(int i)
+			{
+				try
+				{
+					if (Archive && i >= 0 && i < (int)ArchivedSegments.size()) return Archive->load(ArchivedSegments[i]);
+				}
+				catch (Exception& ex)
+				{
+					ex.printError();
+				}
+				return LinkedList<Transaction>();
+			}
+
+			//total transactions, hot & archived
+			int transactionCount()
+			{
+				return archivedCount + Transactions.getCount();
+			}
+
+			/// <summary>
+			/// transactions in a time range, oldest first. Archived blocks are only read if they overlap the range
+			/// </summary>
+			/// <param name="from">start of range, inclusive</param>
+			/// <param name="to">end of range, inclusive</param>
+			/// <returns>list of matching transactions</returns>
+			LinkedList<Transaction> transactionsBetween(std::chrono::system_clock::time_point from, std::chrono::system_clock::time_point to)
+			{
+				std::lock_guard<std::recursive_mutex> guard(Lock);
+				LinkedList<Transaction> r;
+				auto inRange = [&](std::shared_ptr<Transaction> t)
+				{
+					if (t && t->Timestamp >= from && t->Timestamp <= to) r.put(t);
+					return true;
+				};
+				for (int i = 0; i < (int)ArchivedSegments.size(); i++)
+				{
+					if (ArchivedSegments[i].last < from || ArchivedSegments[i].first > to) continue; //block can't have anything for us
+					loadArchived(i).forEach(inRange);
+				}
+				Transactions.forEach(inRange);
+				return r;
 			}
 
 			int compare(std::string s) const //lets Compare work on this class; gets the ID
@@ -284,91 +581,72 @@ namespace DB
 			//function for displaying the account at a glance
 			std::string preview()
 			{
+				std::lock_guard<std::recursive_mutex> guard(Lock);
 				std::string s = "";
 				s.append(ID + " : " + this->getType()+ "\n");
 				s.append(available.formattedValue() + "  :  " + balance.formattedValue() + "\n\n");
 				return s;
 			}
 
-			//displays transaction history
-			std::string transactionHistory()
+			//same summary from a published state, without this account's lock
+			std::string preview(const AccountVersion& v)
 			{
+				std::string s = "";
+				s.append(ID + " : " + this->getType() + "\n");
+				s.append(USDollar(v.available).formattedValue() + "  :  " + USDollar(v.balance).formattedValue() + "\n\n");
+				return s;
+			}
+
+			//displays transaction history, newest first; limit of -1 shows everything. Archived blocks are only read once the hot list runs out
+			std::string transactionHistory(int limit = -1)
+			{
+				std::lock_guard<std::recursive_mutex> guard(Lock);
 				std::string s = "Transaction History:\n";
-				for (int i = Transactions.getCount()-1; i >= 0; i--)
+				int shown = 0;
+				auto show = [&](std::shared_ptr<Transaction> t)
 				{
-					//grabs transaction as pointer (shared ptr lets me make & destroy as many as I want)
-					std::shared_ptr<Transaction> t = Transactions.get(i);
+					if (limit >= 0 && shown >= limit) return false; //shown enough
 					if (t) //check if it exists
 					{
 						s.append(t->TransactionType() + ": " + t->Name + " - " + t->Origin + "\n"); //type, name, and origin
 						s.append(t->Val.formattedValue() + "\n\n"); //value display (money gained/lost)
 					}
-					t.reset(); //reset pointer
+					shown++;
+					return true;
+				};
+				Transactions.forEachReverse(show);
+				//reach back into the archive, newest block first
+				for (int i = (int)ArchivedSegments.size() - 1; i >= 0 && (limit < 0 || shown < limit); i--)
+				{
+					loadArchived(i).forEachReverse(show);
 				}
 				return s;
 			}
 
 			/// <summary>
-			/// Sets the interest information; currently hard coded
+			/// Sets the interest product; the rates themselves live in the product catalog. An account in a bank is requeued at
+			/// the new product's due date straight away
 			/// </summary>
-			/// <param name="setting">int setting code, should be 0-9</param>
+			/// <param name="setting">product ID, should be 0-9</param>
 			void setInterestType(int setting)
 			{
-				switch (setting)
-				{
-					case 0:
-						APY = 0; //interest rate
-						interestType = 0; //0: None
-						payoutRate = 0; //0: None
-						break;
-					case 1:
-						APY = 0.5; //interest rate
-						interestType = 1; // 1: Simple
-						payoutRate = 0; //0: Yearly
-						break;
-					case 2:
-						APY = 0.5; //interest rate
-						interestType = 2; // 2: Compound Yearly
-						payoutRate = 0; //0: Yearly/None
-						break;
-					case 3:
-						APY = 0.5; //interest rate
-						interestType = 3; // 3: Compound Monthly
-						payoutRate = 1; // 1: Every 6 months
-						break;
-					case 4:
-						APY = 0.5; //interest rate
-						interestType = 3; // 3: Compound Monthly
-						payoutRate = 2; // 2: monthly
-						break;
-					case 5:
-						APY = 0.5; //interest rate
-						interestType = 4; // 4: Compound Daily
-						payoutRate = 2; // 2: monthly
-						break;
-					case 6:
-						APY = 0.5; //interest rate
-						interestType = 4; // 4: Compound Daily
-						payoutRate = 3; // 3: daily
-						break;
-					case 7:
-						APY = 2; //interest rate
-						interestType = 4; // 4: Compound Daily
-						payoutRate = 3; // 3: daily
-						break;
-					case 8:
-						APY = 5; //interest rate
-						interestType = 4; // 4: Compound Daily
-						payoutRate = 0; //0: Yearly
-						break;
-					case 9:
-						APY = 10; //interest rate
-						interestType = 1; // 1: Simple
-						payoutRate = 3; // 3: daily
-						break;
-					default:
-						break;
-				}
+				if (!validProduct(setting)) return; //ignore unknown products, like before
+				ProductID = setting;
+				if (Indices) Indices->productChanged(ID, setting);
+				if (Scheduler) Scheduler->schedule(weak_from_this().lock());
+			}
+
+			//the account's interest product
+			const InterestProduct& product()
+			{
+				return getProduct(ProductID);
+			}
+
+			//interest accrued so far, read only
+			USDollar accruedInterest()
+			{
+				std::lock_guard<std::recursive_mutex> guard(Lock);
+				return interestSoFar;
 			}
 
 			virtual bool deposit(double d) = 0; //deposit dollar amount
@@ -383,12 +661,59 @@ namespace DB
 			}
 
 		protected:
-			double APY = 0; //interest rate (can always be expressed as APY, it's just that simple doesn't compound each year)
-			int interestType = 0; //0: None, 1: Simple, 2: Compound Yearly, 3: Compound Monthly, 4: Compound Daily
-			int payoutRate = 0; //0: Yearly/None, 1: Every 6 months, 2: monthly, 3: daily
 			USDollar interestSoFar; //interest accrued so far. This is needed both for compounding & also compound that doesn't pay out at the compound rate
 	};
 
+	/// <summary>
+	/// Holds the locks of two accounts for a two-account operation. Locks are always taken in account ID order,
+	/// so two transfers going opposite ways between the same accounts can't deadlock
+	/// </summary>
+	class AccountPairLock
+	{
+		public:
+			AccountPairLock(std::shared_ptr<Account> a, std::shared_ptr<Account> b)
+			{
+				if (a == b) //same account, only lock once
+				{
+					first = std::unique_lock<std::recursive_mutex>(a->Lock);
+					return;
+				}
+				if (b->ID < a->ID) std::swap(a, b); //canonical order
+				first = std::unique_lock<std::recursive_mutex>(a->Lock);
+				second = std::unique_lock<std::recursive_mutex>(b->Lock);
+			}
+			~AccountPairLock() {} //unique_locks release in reverse order
+
+		private:
+			std::unique_lock<std::recursive_mutex> first; //lower ID
+			std::unique_lock<std::recursive_mutex> second; //higher ID, empty for a single account
+	};
+
+	/// <summary>
+	/// Makes everything posted to two accounts while it's open visible to readers as one commit, so a pinned view never sees half
+	/// a transfer. Open it after the accounts are locked (after an AccountPairLock), so it publishes before they're let go
+	/// </summary>
+	class VersionBatch
+	{
+		public:
+			VersionBatch(std::shared_ptr<Account> a, std::shared_ptr<Account> b) : first(a), second(b)
+			{
+				first->Batched++;
+				if (second != first) second->Batched++;
+			}
+			~VersionBatch()
+			{
+				first->Batched--;
+				if (second != first) second->Batched--;
+				std::shared_ptr<VersionStore> store = first->Versions ? first->Versions : second->Versions;
+				if (store) store->publish(*first, second.get());
+			}
+
+		private:
+			std::shared_ptr<Account> first;
+			std::shared_ptr<Account> second;
+	};
+
 	/// <summary>
 	/// User base class, takes a name & password
 	/// </summary>
@@ -425,7 +750,7 @@ namespace DB
 			bool deposit(double d) //deposits money
 			{
 				bool b = false; //make return
-				std::shared_ptr<Transaction> t(new Deposit(USDollar(d))); //make transaction
+				std::shared_ptr<Transaction> t = makeTransaction<Deposit>(USDollar(d), "Bank", now()); //make transaction
 				int i = processTransaction(t); //atempt the process
 				if (i == 1)
 				{
@@ -435,7 +760,7 @@ namespace DB
 			}
 			USDollar sendTransfer(double d) //transfers money
 			{
-				std::shared_ptr<Transaction> t(new Transfer(USDollar(-d), ID)); //make transaction
+				std::shared_ptr<Transaction> t = makeTransaction<Transfer>(USDollar(-d), ID, now()); //make transaction
 				int i = processTransaction(t); //create the transfer
 				if (i != 1) {
 					return USDollar(0); //return 0 if false
@@ -450,7 +775,7 @@ namespace DB
 				bool b = false;
 				//if transfer is 0, fail
 				if (d <= 0) return false;
-				std::shared_ptr<Transaction> t(new Transfer(USDollar(d), id)); //make transaction
+				std::shared_ptr<Transaction> t = makeTransaction<Transfer>(USDollar(d), id, now()); //make transaction
 				//transfer recieve, success is 1
 				int i = processTransaction(t);
 				if (i == 1)
@@ -463,7 +788,7 @@ namespace DB
 			bool purchase(double d, std::string name, std::string origin) //handles purchase
 			{
 				bool b = false;
-				std::shared_ptr<Transaction> t(new Purchase(USDollar(-d), name, origin)); //make transaction
+				std::shared_ptr<Transaction> t = makeTransaction<Purchase>(USDollar(-d), name, origin, now()); //make transaction
 				//purchase success is 1
 				int i = processTransaction(t);
 				if (i == 1)
@@ -475,17 +800,17 @@ namespace DB
 
 			int processTransaction(std::shared_ptr<Transaction> t) //underlying method for processing transactions (int return code for what happened to the transaction)
 			{
+				std::lock_guard<std::recursive_mutex> guard(Lock); //one posting at a time per account
 				//very simple for right now
 				int i = 0; //failure code is 0
 				//check if dollar is 0 or not
 				if (t->Val != 0)
 				{
-					if (Transactions.put(t))
+					if (journal(t) && applyLogged(t)) //logged first, so a posting is never applied without being durable
 					{
 						i = 1; //success code is 1
 					}
 				}
-				updateBalance(); //update the balance/available
 				return i; //return code
 			}
 
@@ -507,7 +832,7 @@ namespace DB
 			bool deposit(double d) //deposits money
 			{
 				bool b = false; //make return
-				std::shared_ptr<Transaction> t(new Deposit(USDollar(d))); //make transaction
+				std::shared_ptr<Transaction> t = makeTransaction<Deposit>(USDollar(d), "Bank", now()); //make transaction
 				int i = processTransaction(t); //atempt the process
 				if (i == 1)
 				{
@@ -517,7 +842,7 @@ namespace DB
 			}
 			USDollar sendTransfer(double d) //transfers money
 			{
-				std::shared_ptr<Transaction> t(new Transfer(USDollar(-d), ID)); //make transaction
+				std::shared_ptr<Transaction> t = makeTransaction<Transfer>(USDollar(-d), ID, now()); //make transaction
 				int i = processTransaction(t); //create the transfer
 				if (i != 1) {
 					return USDollar(0); //return 0 if false
@@ -532,7 +857,7 @@ namespace DB
 				bool b = false;
 				//if transfer is 0, fail
 				if (d <= 0) return false;
-				std::shared_ptr<Transaction> t(new Transfer(USDollar(d), id)); //make transaction
+				std::shared_ptr<Transaction> t = makeTransaction<Transfer>(USDollar(d), id, now()); //make transaction
 				//transfer recieve, success is 1
 				int i = processTransaction(t);
 				if (i == 1)
@@ -545,7 +870,7 @@ namespace DB
 			bool purchase(double d, std::string name, std::string origin) //handles purchase
 			{
 				bool b = false;
-				std::shared_ptr<Transaction> t(new Purchase(USDollar(-d), name, origin)); //make transaction
+				std::shared_ptr<Transaction> t = makeTransaction<Purchase>(USDollar(-d), name, origin, now()); //make transaction
 				//purchase success is 1
 				int i = processTransaction(t);
 				if (i == 1)
@@ -557,17 +882,17 @@ namespace DB
 
 			int processTransaction(std::shared_ptr<Transaction> t) //underlying method for processing transactions (int return code for what happened to the transaction)
 			{
+				std::lock_guard<std::recursive_mutex> guard(Lock); //one posting at a time per account
 				//very simple for right now
 				int i = 0; //failure code is 0
 				//check if dollar is 0 or not
 				if (t->Val != 0)
 				{
-					if (Transactions.put(t))
+					if (journal(t) && applyLogged(t)) //logged first, so a posting is never applied without being durable
 					{
 						i = 1; //success code is 1
 					}
 				}
-				updateBalance(); //update the balance/available
 				return i; //return code
 			}
 
@@ -592,7 +917,7 @@ namespace DB
 		bool deposit(double d) //deposits money
 		{
 			bool b = false; //make return
-			std::shared_ptr<Transaction> t(new Deposit(USDollar(d))); //make transaction
+			std::shared_ptr<Transaction> t = makeTransaction<Deposit>(USDollar(d), "Bank", now()); //make transaction
 			int i = processTransaction(t); //atempt the process
 			if (i == 1)
 			{
@@ -602,7 +927,7 @@ namespace DB
 		}
 		USDollar sendTransfer(double d) //transfers money
 		{
-			std::shared_ptr<Transaction> t(new Transfer(USDollar(-d), ID)); //make transaction
+			std::shared_ptr<Transaction> t = makeTransaction<Transfer>(USDollar(-d), ID, now()); //make transaction
 			int i = processTransaction(t); //create the transfer
 			if (i != 1) {
 				return USDollar(0); //return 0 if false
@@ -617,7 +942,7 @@ namespace DB
 			bool b = false;
 			//if transfer is 0, fail
 			if (d <= 0) return false;
-			std::shared_ptr<Transaction> t(new Transfer(USDollar(d), id)); //make transaction
+			std::shared_ptr<Transaction> t = makeTransaction<Transfer>(USDollar(d), id, now()); //make transaction
 			//transfer recieve, success is 1
 			int i = processTransaction(t);
 			if (i == 1)
@@ -630,7 +955,7 @@ namespace DB
 		bool purchase(double d, std::string name, std::string origin) //handles purchase
 		{
 			bool b = false;
-			std::shared_ptr<Transaction> t(new Purchase(USDollar(-d), name, origin)); //make transaction
+			std::shared_ptr<Transaction> t = makeTransaction<Purchase>(USDollar(-d), name, origin, now()); //make transaction
 			//purchase success is 1
 			int i = processTransaction(t);
 			if (i == 1)
@@ -642,17 +967,17 @@ namespace DB
 
 		int processTransaction(std::shared_ptr<Transaction> t) //underlying method for processing transactions (int return code for what happened to the transaction)
 		{
+			std::lock_guard<std::recursive_mutex> guard(Lock); //one posting at a time per account
 			//very simple for right now
 			int i = 0; //failure code is 0
 			//check if dollar is 0 or not
 			if (t->Val != 0)
 			{
-				if (Transactions.put(t))
+				if (journal(t) && applyLogged(t)) //logged first, so a posting is never applied without being durable
 				{
 					i = 1; //success code is 1
 				}
 			}
-			updateBalance(); //update the balance/available
 			return i; //return code
 		}
 
@@ -673,7 +998,7 @@ namespace DB
 		bool deposit(double d) //deposits money
 		{
 			bool b = false; //make return
-			std::shared_ptr<Transaction> t(new Deposit(USDollar(d))); //make transaction
+			std::shared_ptr<Transaction> t = makeTransaction<Deposit>(USDollar(d), "Bank", now()); //make transaction
 			int i = processTransaction(t); //atempt the process
 			if (i == 1)
 			{
@@ -683,7 +1008,7 @@ namespace DB
 		}
 		USDollar sendTransfer(double d) //transfers money
 		{
-			std::shared_ptr<Transaction> t(new Transfer(USDollar(-d), ID)); //make transaction
+			std::shared_ptr<Transaction> t = makeTransaction<Transfer>(USDollar(-d), ID, now()); //make transaction
 			int i = processTransaction(t); //create the transfer
 			if (i != 1) {
 				return USDollar(0); //return 0 if false
@@ -698,7 +1023,7 @@ namespace DB
 			bool b = false;
 			//if transfer is 0, fail
 			if (d <= 0) return false;
-			std::shared_ptr<Transaction> t(new Transfer(USDollar(d), id)); //make transaction
+			std::shared_ptr<Transaction> t = makeTransaction<Transfer>(USDollar(d), id, now()); //make transaction
 			//transfer recieve, success is 1
 			int i = processTransaction(t);
 			if (i == 1)
@@ -711,7 +1036,7 @@ namespace DB
 		bool purchase(double d, std::string name, std::string origin) //handles purchase
 		{
 			bool b = false;
-			std::shared_ptr<Transaction> t(new Purchase(USDollar(-d), name, origin)); //make transaction
+			std::shared_ptr<Transaction> t = makeTransaction<Purchase>(USDollar(-d), name, origin, now()); //make transaction
 			//purchase success is 1
 			int i = processTransaction(t);
 			if (i == 1)
@@ -723,17 +1048,17 @@ namespace DB
 
 		int processTransaction(std::shared_ptr<Transaction> t) //underlying method for processing transactions (int return code for what happened to the transaction)
 		{
+			std::lock_guard<std::recursive_mutex> guard(Lock); //one posting at a time per account
 			//very simple for right now
 			int i = 0; //failure code is 0
 			//check if dollar is 0 or not
 			if (t->Val != 0)
 			{
-				if (Transactions.put(t))
+				if (journal(t) && applyLogged(t)) //logged first, so a posting is never applied without being durable
 				{
 					i = 1; //success code is 1
 				}
 			}
-			updateBalance(); //update the balance/available
 			return i; //return code
 		}
 
@@ -782,12 +1107,46 @@ namespace DB
 	class Overdraft
 	{
 		public:
+			/// <summary>
+			/// one planned covering transfer
+			/// </summary>
+			struct Cover
+			{
+				std::shared_ptr<Account> from; //sibling account paying
+				std::shared_ptr<Account> to; //overdrawn account
+				int cents; //amount to move
+			};
+
 			/// <summary>
 			/// Handles overdraft for a specific user
 			/// </summary>
 			/// <param name="c">Customer shared pointer</param>
 			/// <returns>was successful?, bool</returns>
 			static bool OnPurchase(std::string user , std::shared_ptr<Database> d);
+
+			/// <summary>
+			/// Overdraft event; fired when a posting leaves an account negative. Only this path pays for resolving the owner's other accounts
+			/// </summary>
+			/// <param name="acc">account that went negative</param>
+			/// <param name="owner">its owner, to draw cover from</param>
+			/// <param name="d">database the siblings are in</param>
+			/// <returns>was the account covered?, bool</returns>
+			static bool OnOverdrawn(std::shared_ptr<Account> acc, std::shared_ptr<Customer> owner, std::shared_ptr<Database> d);
+
+			/// <summary>
+			/// Works out exactly how much each sibling should send to each overdrawn account, in one pass over the accounts.
+			/// Siblings are drawn down in order, each for as much as it has available, so every overdrawn account gets at most one transfer per sibling
+			/// </summary>
+			/// <param name="accs">a customer's accounts</param>
+			/// <returns>transfers to make, in order</returns>
+			static std::vector<Cover> plan(const std::vector<std::shared_ptr<Account>>& accs);
+
+			/// <summary>
+			/// posts planned transfers; amounts are checked again under both account locks, so nothing overpays if a balance moved since planning
+			/// </summary>
+			/// <param name="covers">transfers from plan</param>
+			/// <returns>transfers posted</returns>
+			static int post(const std::vector<Cover>& covers);
 	};
 
 	/// <summary>
@@ -798,17 +1157,21 @@ namespace DB
 		public:
 			
 			/// <summary>
-			/// payout function, used to simplify code 
+			/// payout function, used to simplify code. Every payout missed since the last one is paid in one posting, & LastPayout
+			/// moves on by the periods paid, so the part period left over still counts toward the next
 			/// </summary>
 			/// <param name="acc">account to do interest on</param>
-			static void payout(std::shared_ptr<Account> acc, double rate, double ratio)
+			/// <param name="p">account's interest product</param>
+			/// <param name="now">time of the run, on the account's clock</param>
+			static void payout(std::shared_ptr<Account> acc, const InterestProduct& p, std::chrono::system_clock::time_point now)
 			{
-				USDollar pay(rate * ratio); //get pay from rate * ratio
+				std::chrono::hours period(p.payoutHours);
+				std::int64_t periods = payablePeriods(p, (now - acc->LastPayout) / period);
+				USDollar pay((int)(periods * p.payoutCents)); //payout amount is fixed per product & period
 				if (pay < 1) return; //if pay is 0, just stop
-				std::shared_ptr<BankFunction> trans(new BankFunction(pay, "Interest payout")); //create new transaction
-				acc->processTransaction(trans); //send new transaction to account
+				std::shared_ptr<Transaction> trans = acc->makeTransaction<BankFunction>(pay, "Interest payout", now); //create new transaction
+				if (acc->processTransaction(trans)) acc->LastPayout = acc->LastPayout + period * periods; //send new transaction to account
 				trans.reset(); //clear extra shared_ptr
-				acc->LastPayout = std::chrono::system_clock::now(); //reset last payout to now
 			}
 			
 			
@@ -821,82 +1184,155 @@ namespace DB
 				//if account exists & is not a null pointer
 				if (acc)
 				{
-					//get values for ease of use from here on
-					int t = acc->interestType;
-					int p = acc->payoutRate;
+					std::lock_guard<std::recursive_mutex> guard(acc->Lock); //keep postings out while we read & update interest
+					if (acc->InterestInFlight) return; //a batch run already has it; it's applied once that's durable
+					const InterestProduct& p = acc->product(); //rates & periods come precomputed from the catalog
 
 					//get time values in hours
-					int interestTime = std::chrono::duration_cast<std::chrono::hours>(std::chrono::system_clock::now() - acc->LastInterest).count();
-					int payoutTime = std::chrono::duration_cast<std::chrono::hours>(std::chrono::system_clock::now() - acc->LastPayout).count();
-					//hours comparison value; payoutRate will change that
-					int payoutComparison = 8760;
-					if (p == 1) payoutComparison = 4320;
-					if (p == 2) payoutComparison = 720;
-					if (p == 3) payoutComparison = 24;
-
-					double rate = acc->APY;
-					double adjustedRate = rate;
-					double ratio = 1;
-
-					//what type of interest?
-					switch (t)
+					std::chrono::system_clock::time_point now = acc->now(); //read once so both checks see the same time
+					int interestTime = std::chrono::duration_cast<std::chrono::hours>(now - acc->LastInterest).count();
+					int payoutTime = std::chrono::duration_cast<std::chrono::hours>(now - acc->LastPayout).count();
+					bool changed = false;
+
+					//accrue if a full period has passed; no interest products have no period
+					if (p.accrualHours > 0 && interestTime > p.accrualHours)
 					{
-						case 1 : case 2:
-							//compound interest, yearly
-							ratio = payoutComparison / 8760.00;
-							if (interestTime > 8760)
-							{
-								acc->interestSoFar = acc->interestSoFar + acc->balance.GetPercentage(adjustedRate);
-								acc->LastInterest = std::chrono::system_clock::now();
-							}
-							break;
-						case 3:
-							//compound interest, monthly
-							adjustedRate = rate / 12;
-							ratio = payoutComparison / 720.00;
-							if (interestTime > 720)
-							{
-								acc->interestSoFar = acc->interestSoFar + acc->balance.GetPercentage(adjustedRate);
-								acc->LastInterest = std::chrono::system_clock::now();
-							}
-							break;
-						case 4:
-							//compound interest, daily
-							adjustedRate = rate / 365;
-							ratio = payoutComparison / 24.00;
-							if (interestTime > 24)
-							{
-								acc->interestSoFar = acc->interestSoFar + acc->balance.GetPercentage(adjustedRate);
-								acc->LastInterest = std::chrono::system_clock::now();
-							}
-							break;
-						default:
-							//do nothing by default, or no interest
-							break;
+						//catch up every period missed since the last run in one go; any part period left over still counts toward the next
+						std::int64_t periods = accruablePeriods(acc->balance.getValue(), p, interestTime / p.accrualHours);
+						acc->interestSoFar = acc->interestSoFar + USDollar((int)accrualCents(acc->balance.getValue(), p, periods)); //fits, see accruablePeriods
+						acc->LastInterest = acc->LastInterest + std::chrono::hours((long long)periods * p.accrualHours);
+						changed = true;
 					}
 
 					//if payout is greater than comparison value & not a certificate of deposit, payout
-					if (payoutTime > payoutComparison && acc->getType() != "Certificate of Deposit")
+					if (payoutTime > p.payoutHours && acc->getType() != "Certificate of Deposit")
 					{
 						//use payout static function
-						payout(acc, adjustedRate, ratio);
+						payout(acc, p, now);
+						changed = true;
 					}
+					if (changed) acc->journalInterest(); //log the new interest state
 				}
 
 				acc.reset(); //clears that particular shared_ptr
 			}
 
 			/// <summary>
-			/// Goes through & handles interest for all accounts
+			/// Goes through & handles interest for all accounts, using the batch engine (InterestEngine.h)
+			/// </summary>
+			/// <param name="accs">list of accounts to go through</param>
+			/// <returns>accounts changed</returns>
+			static int AllAccounts(LinkedList<Account> accs);
+
+			/// <summary>
+			/// Same as above, with the accounts split into partitions spread over a thread pool. Every account lands in exactly one
+			/// partition & all partitions use the same time, so the results match the single threaded run exactly
 			/// </summary>
 			/// <param name="accs">list of accounts to go through</param>
-			static void AllAccounts(LinkedList<Account> accs)
+			/// <param name="pool">threads to use</param>
+			/// <returns>accounts changed</returns>
+			static int AllAccounts(LinkedList<Account> accs, std::shared_ptr<ThreadPool> pool);
+
+			/// <summary>
+			/// Runs interest as of a given time for a set of accounts, partitioned over the pool if there is one
+			/// </summary>
+			/// <param name="accs">accounts to go through</param>
+			/// <param name="pool">threads to use, may be null</param>
+			/// <param name="now">time to run interest as of</param>
+			/// <returns>accounts changed</returns>
+			static int Batch(std::vector<std::shared_ptr<Account>>& accs, std::shared_ptr<ThreadPool> pool, std::chrono::system_clock::time_point now);
+	};
+
+	//roles a directory entry can have; same numbers as Server::userValidation's access levels
+	const int ROLE_CUSTOMER = 0;
+	const int ROLE_EMPLOYEE = 1;
+
+	/// <summary>
+	/// what the user directory has for a name: the role & the record, so one lookup says what kind of user it is
+	/// </summary>
+	struct DirectoryEntry
+	{
+		int role = -1; //ROLE_CUSTOMER or ROLE_EMPLOYEE, -1 for a name nobody has
+		std::shared_ptr<User> user; //the Customer or Employee
+
+		//the record as a customer; null for employees & unknown names
+		std::shared_ptr<Customer> customer() const
+		{
+			return role == ROLE_CUSTOMER ? std::static_pointer_cast<Customer>(user) : std::shared_ptr<Customer>();
+		}
+
+		//the record as an employee; null for customers & unknown names
+		std::shared_ptr<Employee> employee() const
+		{
+			return role == ROLE_EMPLOYEE ? std::static_pointer_cast<Employee>(user) : std::shared_ptr<Employee>();
+		}
+	};
+
+	/// <summary>
+	/// One partition of the bank's customers & accounts. Which shard a customer or account lives in comes from a hash of
+	/// its name or ID, so single-account work only ever touches one shard's lock
+	/// </summary>
+	class Shard
+	{
+		public:
+			Shard(int i) : Index(i) {}
+			~Shard() {}
+			const int Index; //position in the database; shard locks are always taken in index order
+			LinkedList<Customer> Customers; //this shard's customers
+			LinkedList<Account> Accounts; //this shard's accounts
+			std::unordered_map<std::string, DirectoryEntry> Directory; //every user name in this shard, customer or employee, for constant time lookups
+			std::unordered_map<std::string, std::shared_ptr<Account>> AccountIndex; //ID to account
+			std::unordered_map<std::string, std::vector<std::string>> Owners; //account ID to the names of its owners, the reverse of AccountIDs
+			std::shared_ptr<SecondaryIndex> Indices = std::shared_ptr<SecondaryIndex>(new SecondaryIndex()); //accounts by type, product & overdrawn; has its own lock
+			//guards the lists, the indices & the AccountIDs of this shard's customers. Shared for lookups, exclusive for adding
+			std::shared_mutex Catalog;
+	};
+
+	/// <summary>
+	/// Holds what an add needs: the database's settings shared, then up to two shards exclusively, in index order so two adds
+	/// spanning the same shards can't deadlock. Same idea as AccountPairLock
+	/// </summary>
+	class ShardLock
+	{
+		public:
+			ShardLock(std::shared_mutex& settings, Shard& a, Shard& b) : shared(settings)
 			{
-				for (int i = 0; i < accs.getCount(); i++)
+				if (&a == &b) //same shard, only lock once
 				{
-					IndividualAccount(accs.get(i));
+					first = std::unique_lock<std::shared_mutex>(a.Catalog);
+					return;
 				}
+				Shard* lo = a.Index < b.Index ? &a : &b;
+				Shard* hi = a.Index < b.Index ? &b : &a;
+				first = std::unique_lock<std::shared_mutex>(lo->Catalog);
+				second = std::unique_lock<std::shared_mutex>(hi->Catalog);
 			}
+			~ShardLock() {}
+
+			//lets everything go early, for waiting on the log
+			void unlock()
+			{
+				if (second) second.unlock();
+				if (first) first.unlock();
+				if (shared) shared.unlock();
+			}
+
+		private:
+			std::shared_lock<std::shared_mutex> shared; //database settings
+			std::unique_lock<std::shared_mutex> first; //lower index
+			std::unique_lock<std::shared_mutex> second; //higher index, empty for a single shard
+	};
+
+	/// <summary>
+	/// one row of a card settlement: a customer's purchase against one of their accounts
+	/// </summary>
+	struct PurchaseRow
+	{
+		std::string account;
+		std::string user;
+		double val = 0; //dollars
+		std::string name = "Purchase";
+		std::string origin = "Unknown";
 	};
 
 	/// <summary>
@@ -905,21 +1341,521 @@ namespace DB
 	class Database
 	{
 	public:
-		Database() {
+		Database(int shards = DefaultShards, bool pooled = true) {
+			if (pooled) Memory = std::shared_ptr<Arena>(new Arena());
 			//default employee
 			std::shared_ptr<Employee> e(new Employee("Admin", "defaultPassPleaseChange"));
 
-			Customers = LinkedList<Customer>();
 			Employees = LinkedList<Employee>(e); //put default employee into employees
-			e.reset(); //clear pointer
-			Accounts = LinkedList<Account>();
 			EncryptionKeys = LinkedList<std::string>();
+			if (shards < 1) shards = 1;
+			for (int i = 0; i < shards; i++)
+			{
+				Shards.push_back(std::shared_ptr<Shard>(new Shard(i)));
+				Shards.back()->Customers.setArena(Memory);
+				Shards.back()->Accounts.setArena(Memory);
+			}
+			shardFor(e->name).Directory[e->name] = DirectoryEntry{ ROLE_EMPLOYEE, e };
+			e.reset(); //clear pointer
+		}
+		//database with tiered transaction storage; old history goes to the archive file
+		Database(std::string archivePath, int hotWindow = 256) : Database()
+		{
+			enableArchive(archivePath, hotWindow);
+		}
+		/// <summary>
+		/// Stops the workers & empties the scheduler's queue; the rest goes with the members. Accounts & transactions the caller
+		/// still holds keep working, & keep the arena they were made in
+		/// </summary>
+		~Database()
+		{
+			Workers.reset();
+			Schedule->clear(); //queued accounts hold the scheduler too, so it won't go with the database
 		}
-		~Database() {}
-		LinkedList<Customer> Customers; //customers, main users
+		static const int DefaultShards = 16; //enough to keep a many-core box from queueing on one lock
+		std::vector<std::shared_ptr<Shard>> Shards; //customers & accounts, partitioned by hash
 		LinkedList<Employee> Employees; //administrators, essentially
-		LinkedList<Account> Accounts; //all accounts, split from customers
 		LinkedList<std::string> EncryptionKeys; //encryption keys (not yet used)
+		std::shared_ptr<TransactionArchive> Archive; //cold transaction storage, null when tiering is off
+		int HotWindow = 256; //transactions each account keeps in memory
+		std::shared_ptr<Arena> Memory; //where the bank's nodes, accounts, customers & transactions are made; null uses the heap
+		std::shared_ptr<ThreadPool> Workers; //threads for bank processes, null runs them on the calling thread
+		std::shared_ptr<InterestScheduler> Schedule = std::shared_ptr<InterestScheduler>(new InterestScheduler()); //accounts queued by when they next have interest due
+		std::shared_ptr<WriteAheadLog> Log; //durable log of every change, null when logging is off
+		std::uint64_t LogCheckpoint = 0; //newest log record the loaded snapshot has; enableLog replays from after it
+		std::shared_ptr<VersionStore> Versions = std::shared_ptr<VersionStore>(new VersionStore()); //published account states for consistent reads
+		std::shared_ptr<TimeSource> Time = std::shared_ptr<TimeSource>(new TimeSource()); //the clock this bank & its accounts read
+
+		/// <summary>
+		/// Pins a consistent view of every account's balances for a long read, like a full-bank report. Postings carry on while
+		/// it's held; they publish new states the view doesn't see
+		/// </summary>
+		/// <returns>the view; the pin is released when the last copy goes away</returns>
+		std::shared_ptr<ReadView> readView()
+		{
+			return std::shared_ptr<ReadView>(new ReadView(Versions));
+		}
+
+		/// <summary>
+		/// requeues an account's interest after its product or interest times were changed by hand
+		/// </summary>
+		/// <param name="a">account to requeue</param>
+		void reschedule(std::shared_ptr<Account> a)
+		{
+			Schedule->schedule(a);
+		}
+
+		/// <summary>
+		/// sets how many threads bank processes use
+		/// </summary>
+		/// <param name="threads">thread count; 0 uses every core, 1 runs on the calling thread</param>
+		void setThreads(int threads)
+		{
+			if (threads == 1) Workers.reset();
+			else Workers = std::shared_ptr<ThreadPool>(new ThreadPool(threads));
+		}
+
+		//guards the employees & the settings above (archive, hot window, log). Customers & accounts are guarded by their shard,
+		//balances & transactions per account, so independent accounts never wait on each other
+		std::shared_mutex Catalog;
+
+		/// <summary>
+		/// shard a customer name or account ID lives in
+		/// </summary>
+		/// <param name="key">name or ID</param>
+		/// <returns>its shard</returns>
+		Shard& shardFor(const std::string& key)
+		{
+			return *Shards[std::hash<std::string>()(key) % Shards.size()];
+		}
+
+		/// <summary>
+		/// Logs a catalog change made under an exclusive lock. The record is queued while the lock is still held, so the log
+		/// keeps the same order as the catalog; the wait for the disk happens after the lock is let go
+		/// </summary>
+		/// <param name="guard">held exclusive lock; released here</param>
+		/// <param name="record">record to log, ignored when logging is off</param>
+		/// <returns>is the change durable (always true with no log), bool</returns>
+		template <typename Guard>
+		bool logged(Guard& guard, const std::string& record)
+		{
+			std::shared_ptr<WriteAheadLog> log = Log;
+			if (!log) return true;
+			try
+			{
+				std::uint64_t seq = log->enqueue(record);
+				guard.unlock();
+				log->waitDurable(seq);
+				return true;
+			}
+			catch (Exception& ex)
+			{
+				ex.printError();
+				return false;
+			}
+		}
+
+		//thread-safe lookups; null if not found. Users & accounts are one hash probe in one shard
+		std::shared_ptr<Account> findAccount(std::string id)
+		{
+			Shard& s = shardFor(id);
+			std::shared_lock<std::shared_mutex> guard(s.Catalog);
+			std::unordered_map<std::string, std::shared_ptr<Account>>::iterator it = s.AccountIndex.find(id);
+			return it == s.AccountIndex.end() ? std::shared_ptr<Account>() : it->second;
+		}
+		//a user of either kind & their role; role -1 if nobody has the name
+		DirectoryEntry findUser(std::string name)
+		{
+			Shard& s = shardFor(name);
+			std::shared_lock<std::shared_mutex> guard(s.Catalog);
+			std::unordered_map<std::string, DirectoryEntry>::iterator it = s.Directory.find(name);
+			return it == s.Directory.end() ? DirectoryEntry() : it->second;
+		}
+		std::shared_ptr<Customer> findCustomer(std::string name)
+		{
+			return findUser(name).customer();
+		}
+		std::shared_ptr<Employee> findEmployee(std::string name)
+		{
+			return findUser(name).employee();
+		}
+
+		/// <summary>
+		/// checks account ownership
+		/// </summary>
+		/// <param name="c">customer</param>
+		/// <param name="acc">account ID</param>
+		/// <returns>does the customer own/have access to the account, bool</returns>
+		bool owns(std::shared_ptr<Customer> c, std::string acc)
+		{
+			if (!c) return false;
+			Shard& s = shardFor(acc);
+			std::shared_lock<std::shared_mutex> guard(s.Catalog);
+			std::unordered_map<std::string, std::vector<std::string>>::iterator it = s.Owners.find(acc);
+			if (it == s.Owners.end()) return false;
+			for (std::string& name : it->second)
+			{
+				if (name == c->name) return true;
+			}
+			return false;
+		}
+
+		/// <summary>
+		/// who owns an account, from the reverse index
+		/// </summary>
+		/// <param name="acc">account ID</param>
+		/// <returns>owner names, first owner first; empty for an unowned or unknown account</returns>
+		std::vector<std::string> owners(std::string acc)
+		{
+			Shard& s = shardFor(acc);
+			std::shared_lock<std::shared_mutex> guard(s.Catalog);
+			std::unordered_map<std::string, std::vector<std::string>>::iterator it = s.Owners.find(acc);
+			return it == s.Owners.end() ? std::vector<std::string>() : it->second;
+		}
+
+		//does more than one customer own the account
+		bool isJoint(std::string acc)
+		{
+			return owners(acc).size() > 1;
+		}
+
+		/// <summary>
+		/// copies a customer's account IDs, so callers can walk them without holding the shard
+		/// </summary>
+		/// <param name="c">customer</param>
+		/// <returns>account IDs, primary first</returns>
+		std::vector<std::string> accountIDs(std::shared_ptr<Customer> c)
+		{
+			std::vector<std::string> ids;
+			if (!c) return ids;
+			std::shared_lock<std::shared_mutex> guard(shardFor(c->name).Catalog);
+			c->AccountIDs.forEach([&](std::shared_ptr<std::string> id)
+			{
+				if (id) ids.push_back(*id);
+				return true;
+			});
+			return ids;
+		}
+
+		//accounts in the whole bank
+		int accountCount()
+		{
+			int n = 0;
+			for (std::shared_ptr<Shard>& s : Shards)
+			{
+				std::shared_lock<std::shared_mutex> guard(s->Catalog);
+				n += s->Accounts.getCount();
+			}
+			return n;
+		}
+
+		/// <summary>
+		/// Finds accounts through the secondary indices instead of scanning, e.g. every money market account that's overdrawn
+		/// </summary>
+		/// <param name="type">account type code (ACCOUNT_SAVING etc.), -1 for any</param>
+		/// <param name="product">interest product ID, -1 for any</param>
+		/// <param name="overdrawnOnly">only accounts with a negative balance</param>
+		/// <returns>matching accounts, in no particular order</returns>
+		std::vector<std::shared_ptr<Account>> findAccounts(int type, int product = -1, bool overdrawnOnly = false)
+		{
+			std::vector<std::shared_ptr<Account>> found;
+			for (std::shared_ptr<Shard>& s : Shards)
+			{
+				std::vector<std::shared_ptr<Account>> part = s->Indices->find(type, product, overdrawnOnly);
+				found.insert(found.end(), part.begin(), part.end());
+			}
+			return found;
+		}
+
+		/// <summary>
+		/// walks every account, one shard at a time; only that shard is held while it's walked
+		/// </summary>
+		/// <param name="f">called with each account; return false to stop</param>
+		template <typename F>
+		void forEachAccount(F f)
+		{
+			bool more = true;
+			for (std::shared_ptr<Shard>& s : Shards)
+			{
+				if (!more) return;
+				std::shared_lock<std::shared_mutex> guard(s->Catalog);
+				s->Accounts.forEach([&](std::shared_ptr<Account> a)
+				{
+					more = f(a);
+					return more;
+				});
+			}
+		}
+
+		/// <summary>
+		/// adds a new customer; fails if the name is taken by a customer or an employee
+		/// </summary>
+		/// <param name="c">customer to add</param>
+		/// <returns>was successful, bool</returns>
+		bool addCustomer(std::shared_ptr<Customer> c)
+		{
+			if (!c) return false;
+			Shard& s = shardFor(c->name);
+			ShardLock guard(Catalog, s, s);
+			if (s.Directory.count(c->name)) return false;
+			c->AccountIDs.setArena(Memory);
+			if (!s.Customers.put(c)) return false;
+			s.Directory[c->name] = DirectoryEntry{ ROLE_CUSTOMER, c };
+			return logged(guard, Log ? WriteAheadLog::customerRecord(*c) : "");
+		}
+
+		/// <summary>
+		/// adds a new employee; fails if the name is taken by a customer or an employee
+		/// </summary>
+		/// <param name="e">employee to add</param>
+		/// <returns>was successful, bool</returns>
+		bool addEmployee(std::shared_ptr<Employee> e)
+		{
+			if (!e) return false;
+			std::unique_lock<std::shared_mutex> guard(Catalog); //held through the log enqueue, which keeps the log in order
+			{
+				Shard& s = shardFor(e->name);
+				std::unique_lock<std::shared_mutex> shard(s.Catalog);
+				if (s.Directory.count(e->name)) return false;
+				if (!Employees.put(e)) return false;
+				s.Directory[e->name] = DirectoryEntry{ ROLE_EMPLOYEE, e };
+			}
+			return logged(guard, Log ? WriteAheadLog::employeeRecord(*e) : "");
+		}
+
+		/// <summary>
+		/// changes a user's password & logs it, so the change survives a restart
+		/// </summary>
+		/// <param name="name">customer or employee name</param>
+		/// <param name="pass">new password</param>
+		/// <param name="role">ROLE_CUSTOMER or ROLE_EMPLOYEE to only change that kind of user, -1 for either</param>
+		/// <returns>was it changed, false for an unknown user or the same password again</returns>
+		bool setPassword(std::string name, std::string pass, int role = -1)
+		{
+			Shard& s = shardFor(name);
+			ShardLock guard(Catalog, s, s);
+			std::unordered_map<std::string, DirectoryEntry>::iterator it = s.Directory.find(name);
+			if (it == s.Directory.end() || !it->second.user || (role != -1 && it->second.role != role)) return false;
+			if (it->second.user->password == pass) return false;
+			it->second.user->password = pass;
+			return logged(guard, Log ? WriteAheadLog::passwordRecord(*it->second.user) : "");
+		}
+
+		/// <summary>
+		/// turns on tiered storage for every account, current & future
+		/// </summary>
+		/// <param name="path">archive file path</param>
+		/// <param name="hotWindow">transactions each account keeps in memory</param>
+		/// <param name="keep">keep blocks already in the file</param>
+		void enableArchive(std::string path, int hotWindow = 256, bool keep = false)
+		{
+			std::unique_lock<std::shared_mutex> guard(Catalog); //adds hold this shared, so none are half done
+			Archive = std::shared_ptr<TransactionArchive>(new TransactionArchive(path, keep));
+			HotWindow = hotWindow;
+			forEachAccount([&](std::shared_ptr<Account> a)
+			{
+				a->Archive = Archive;
+				a->HotWindow = HotWindow;
+				return true;
+			});
+		}
+
+		/// <summary>
+		/// adds a new account to the bank, hooking it up to the archive & its owner
+		/// </summary>
+		/// <param name="a">account to add</param>
+		/// <param name="owner">customer to give the account to, optional</param>
+		/// <returns>was successful, bool</returns>
+		bool addAccount(std::shared_ptr<Account> a, std::shared_ptr<Customer> owner = std::shared_ptr<Customer>())
+		{
+			if (!a) return false;
+			Shard& s = shardFor(a->ID);
+			ShardLock guard(Catalog, s, owner ? shardFor(owner->name) : s); //the owner's ID list lives in the owner's shard
+			if (s.AccountIndex.count(a->ID)) return false;
+			a->Archive = Archive;
+			a->HotWindow = HotWindow;
+			a->setArena(Memory);
+			if (owner && !owner->AccountIDs.put(arenaShared<std::string>(Memory.get(), a->ID))) return false;
+			if (!s.Accounts.put(a)) return false;
+			s.AccountIndex[a->ID] = a;
+			if (owner) s.Owners[a->ID].push_back(owner->name);
+			a->Indices = s.Indices;
+			s.Indices->add(a);
+			publishFirst(a);
+			a->Log = Log;
+			a->Scheduler = Schedule;
+			a->Time = Time;
+			a->startClock(); //interest starts from when the bank says it opened, not when the object was made
+			Schedule->schedule(a); //queue its first interest due date
+			return logged(guard, Log ? WriteAheadLog::accountRecord(*a, owner ? owner->name : "") : "");
+		}
+
+		/// <summary>
+		/// hooks an account into the version store & publishes the state it arrived with
+		/// </summary>
+		/// <param name="a">account being added</param>
+		void publishFirst(std::shared_ptr<Account> a)
+		{
+			std::lock_guard<std::recursive_mutex> held(a->Lock);
+			a->Versions = Versions;
+			Versions->publish(*a);
+		}
+
+		/// <summary>
+		/// gives an existing account another owner, making it joint
+		/// </summary>
+		/// <param name="acc">account ID</param>
+		/// <param name="c">customer to add</param>
+		/// <returns>was successful (false if they already own it), bool</returns>
+		bool addOwner(std::string acc, std::shared_ptr<Customer> c)
+		{
+			if (!c) return false;
+			Shard& s = shardFor(acc);
+			ShardLock guard(Catalog, s, shardFor(c->name)); //both directions of the link change together
+			if (!s.AccountIndex.count(acc)) return false;
+			std::vector<std::string>& names = s.Owners[acc];
+			for (std::string& name : names)
+			{
+				if (name == c->name) return false;
+			}
+			if (!c->AccountIDs.put(arenaShared<std::string>(Memory.get(), acc))) return false;
+			names.push_back(c->name);
+			return logged(guard, Log ? WriteAheadLog::ownerRecord(acc, c->name) : "");
+		}
+
+		/// <summary>
+		/// Turns on the write-ahead log. Whatever the file already holds is replayed first, rebuilding the bank as it was,
+		/// then every change from here on is appended to it
+		/// </summary>
+		/// <param name="path">log file path</param>
+		/// <param name="mode">how records are synced to disk</param>
+		/// <returns>records replayed, -1 if the log couldn't be attached; the file is then left as it was, & the bank has what
+		/// replayed before the problem</returns>
+		int enableLog(std::string path, WriteAheadLog::SyncMode mode = WriteAheadLog::GroupCommit)
+		{
+			std::uint64_t validBytes = 0;
+			std::uint64_t lastSeq = 0;
+			int replayed = 0;
+			try
+			{
+				replayed = WriteAheadLog::replay(path, *this, validBytes, lastSeq, LogCheckpoint); //before the log is attached, so nothing is written twice
+				std::error_code ec;
+				std::uintmax_t size = std::filesystem::exists(path, ec) ? std::filesystem::file_size(path, ec) : 0;
+				if (ec) throw ExLogIO("Database::enableLog");
+				if (size > validBytes)
+				{
+					std::filesystem::resize_file(path, validBytes, ec); //cut off a torn tail so new records follow the last good one
+					if (ec) throw ExLogIO("Database::enableLog"); //records appended after the tail would never replay
+				}
+				std::shared_ptr<WriteAheadLog> log(new WriteAheadLog(path, mode, lastSeq));
+				std::unique_lock<std::shared_mutex> guard(Catalog);
+				Log = log;
+				forEachAccount([&](std::shared_ptr<Account> a)
+				{
+					a->Log = Log;
+					return true;
+				});
+			}
+			catch (Exception& ex)
+			{
+				ex.printError();
+				return -1;
+			}
+			return replayed;
+		}
+
+		/// <summary>
+		/// Writes a snapshot of the whole bank, then checkpoints the log: the records the snapshot has are dropped from it, so the
+		/// log doesn't grow forever & a restart from the snapshot only replays what came after
+		/// </summary>
+		/// <param name="path">snapshot file path</param>
+		/// <returns>was successful, bool</returns>
+		bool saveSnapshot(std::string path)
+		{
+			try
+			{
+				std::uint64_t seq = Snapshot::write(path, *this);
+				std::shared_ptr<WriteAheadLog> log = Log;
+				if (log) log->checkpoint(seq); //if it can't rotate, the whole log is still there & replay skips up to the checkpoint
+				return true;
+			}
+			catch (Exception& ex)
+			{
+				ex.printError();
+				return false;
+			}
+		}
+
+		/// <summary>
+		/// Loads a snapshot into this bank; call before enableLog so the log only replays what came after it
+		/// </summary>
+		/// <param name="path">snapshot file path</param>
+		/// <returns>accounts loaded, -1 if there was no usable snapshot</returns>
+		int loadSnapshot(std::string path)
+		{
+			std::error_code ec;
+			if (!std::filesystem::exists(path, ec)) return -1; //first start, nothing saved yet
+			try
+			{
+				return Snapshot::load(path, *this);
+			}
+			catch (Exception& ex)
+			{
+				ex.printError();
+				return -1;
+			}
+		}
+
+		/// <summary>
+		/// Moves money between two accounts as one commit. The accounts were resolved from their own shards, so no shard lock is
+		/// held here; both account locks are taken in canonical order & both legs are checked before anything is logged. Then both
+		/// go to the log as one record & one wait, & both are applied with their balances moved by just the amount; neither leg is
+		/// skipped once the record is durable. Readers see both legs or neither
+		/// </summary>
+		/// <param name="from">account to take from</param>
+		/// <param name="to">account to give to</param>
+		/// <param name="amt">amount, must be positive</param>
+		/// <returns>did the transfer go through, bool</returns>
+		static bool transfer(std::shared_ptr<Account> from, std::shared_ptr<Account> to, USDollar amt)
+		{
+			if (!from || !to || amt <= 0) return false;
+			AccountPairLock locks(from, to);
+			VersionBatch commit(from, to);
+			std::shared_ptr<Transaction> out = from->makeTransaction<Transfer>(USDollar(-amt.getValue()), from->ID, from->now());
+			std::shared_ptr<Transaction> in = to->makeTransaction<Transfer>(amt, from->ID, from->now());
+			if (!out || !in) return false; //checked before logging; once the record is durable both legs go in no matter what
+			std::shared_ptr<WriteAheadLog> log = from->Log;
+			if (log)
+			{
+				try
+				{
+					std::uint64_t seq = log->enqueue(WriteAheadLog::transferRecord(from->ID, *out, to->ID, *in));
+					log->waitDurable(seq);
+					from->LoggedSeq = seq;
+					to->LoggedSeq = seq;
+				}
+				catch (Exception& ex)
+				{
+					ex.printError();
+					return false; //not durable, so neither leg is applied
+				}
+			}
+			bool debited = from->applyLogged(out);
+			bool credited = to->applyLogged(in); //not skipped when the first leg fails; replay would apply both
+			return debited && credited;
+		}
+
+		/// <summary>
+		/// transfer by account ID
+		/// </summary>
+		/// <param name="from">account ID to take from</param>
+		/// <param name="to">account ID to give to</param>
+		/// <param name="v">dollar amount</param>
+		/// <returns>did the transfer go through, bool</returns>
+		bool transfer(std::string from, std::string to, double v)
+		{
+			return transfer(findAccount(from), findAccount(to), USDollar(v));
+		}
 
 		/// <summary>
 		/// purchase request
@@ -930,31 +1866,80 @@ namespace DB
 		bool purchase(std::string acc, std::string user, double val, std::shared_ptr<Database> db, std::string name = "Purchase", std::string origin = "Unknown")
 		{
 			bool b = false;
-			std::shared_ptr<Customer> cust = Customers.get(user); //get customer
+			std::shared_ptr<Customer> cust = findCustomer(user); //get customer
 			if (cust) //make sure customer is real
 			{
-				int i = cust->AccountIDs.find(acc); //find account in customer's list
-				if (i > -1)
+				if (owns(cust, acc)) //find account in customer's list
 				{
-					std::shared_ptr<Account> account = Accounts.get(acc); //make sure account exists
+					std::shared_ptr<Account> account = findAccount(acc); //make sure account exists
 					if (account)
 					{
-						b = account->purchase(val, name, origin); //purchase in account
+						bool overdrawn = false;
+						{
+							std::lock_guard<std::recursive_mutex> guard(account->Lock); //before & after come from this purchase, not someone else's
+							bool covered = !(account->balance < 0);
+							b = account->purchase(val, name, origin); //purchase in account
+							overdrawn = b && covered && account->balance < 0;
+						}
+						//overdraft only when this purchase is what took the account negative; already short, it was handled then
+						if (overdrawn) Overdraft::OnOverdrawn(account, cust, db);
 					}
 					account.reset(); //clear extra shared_ptr
 				}
 			}
-			Overdraft::OnPurchase(user, db); //do overdraft
 
 			return b;
 		}
 
+		//posts a whole settlement, grouped by account; see BankDB.cpp
+		int purchaseBatch(const std::vector<PurchaseRow>& rows, std::shared_ptr<Database> db);
+
+		//compacts every account's history older than horizon into 30-day summaries by default; see BankDB.cpp
+		long long compactHistory(std::chrono::system_clock::time_point horizon, std::chrono::system_clock::duration period = std::chrono::hours(24 * 30));
+
+		/// <summary>
+		/// swaps the clock this bank & all of its accounts read; null puts the real clock back. Meant for setup, not while other threads are working
+		/// </summary>
+		/// <param name="c">new clock</param>
+		void setClock(std::shared_ptr<Clock> c)
+		{
+			Time->set(c);
+		}
+
+		//current time on this bank's clock
+		std::chrono::system_clock::time_point now()
+		{
+			return Time->now();
+		}
+
+		/// <summary>
+		/// bank processes done at a regular interval; only accounts with interest due are touched
+		/// </summary>
+		/// <returns>accounts changed</returns>
+		int bankProcesses()
+		{
+			return Schedule->tick(now(), Workers);
+		}
+
 		/// <summary>
-		/// bank processes done at a regular interval
+		/// Runs the bank forward on a simulated clock, jumping straight from one due date to the next instead of waiting.
+		/// Install the clock with setClock first so postings are stamped with simulated time too
 		/// </summary>
-		void bankProcesses()
+		/// <param name="clock">clock to move</param>
+		/// <param name="span">how far to run</param>
+		/// <returns>accounts changed over the whole run</returns>
+		int fastForward(SimulatedClock& clock, std::chrono::system_clock::duration span)
 		{
-			Interest::AllAccounts(Accounts);
+			std::chrono::system_clock::time_point end = clock.now() + span;
+			std::chrono::system_clock::time_point next;
+			int changed = 0;
+			while (Schedule->nextTime(next) && next <= end)
+			{
+				if (next > clock.now()) clock.set(next); //never move backwards
+				changed += Schedule->tick(clock.now(), Workers);
+			}
+			clock.set(end);
+			return changed;
 		}
 	};
 
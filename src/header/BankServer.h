@@ -2,43 +2,91 @@
 
 #include "Encrypt.h"
 #include "List.h"
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace DB
+{
+	class Database; //Forward declaration
+}
 
 namespace Serv
 {
 
+	/// <summary>
+	/// a logged in user, found by token
+	/// </summary>
+	struct Session
+	{
+		std::string user; //who logged in; actions run as them, whatever the client says
+		int role = -1; //access level, as userValidation gives it; -1 for no session
+		std::chrono::system_clock::time_point expires; //on the bank's clock, pushed back on every use
+	};
+
 	/// <summary>
 	///	Connection layer between Client & DB; will Encrypt & Decrypt everything once encryption is implemented.
+	/// Everything done as someone takes their session token, & the server works out who that is
 	/// </summary>
 	class Server
 	{
 		public:
-			Server(){}
+			Server(); //serves the bank kept in BankSnapshot.dat, BankArchive.dat & BankLog.dat
+			Server(std::shared_ptr<DB::Database> d) : db(d) {} //serves the given bank
 			~Server(){}
 
 			//validates the user, customer or employee
 			int userValidation(std::string user, std::string pass);
-			//creates the user
-			bool userCreation(std::string user, std::string pass, std::string acc, double deposit = 10.00);
-			///allows users to change passwords; very important because there is a hardcoded default employee
-			bool userPassword(std::string user, std::string pass, int type);
-			//creates the employee
-			bool employeeCreation(std::string user, std::string pass);
-			//adds account to user
-			bool accountCreation(std::string user, std::string acc, int t, double deposit=10.00);
+			//logs in; returns a session token if the credentials are right for the role (0 customer, 1 employee), empty otherwise
+			std::string login(std::string user, std::string pass, int role);
+			//role a session token was issued for, -1 if it's unknown or expired; every use keeps it alive
+			int sessionValidation(std::string token);
+			//ends a session
+			void logout(std::string token);
+			//creates the user; employees only
+			bool userCreation(std::string token, std::string user, std::string pass, std::string acc, double deposit = 10.00);
+			///allows users to change their own password; very important because there is a hardcoded default employee
+			bool passwordChange(std::string token, std::string oldPass, std::string newPass);
+			//sets a customer's password; employees only
+			bool passwordReset(std::string token, std::string user, std::string pass);
+			//creates the employee; employees only
+			bool employeeCreation(std::string token, std::string user, std::string pass);
+			//adds account to user; employees only
+			bool accountCreation(std::string token, std::string user, std::string acc, int t, double deposit=10.00);
 			//transfers between accounts
-			bool accountsTransfer(std::string user, std::string acc, std::string acc2, double amnt);
-			//deposits into account
-			bool accountDeposit(std::string user, std::string acc, double deposit);
+			bool accountsTransfer(std::string token, std::string acc, std::string acc2, double amnt);
+			//deposits into a customer's account; employees only
+			bool accountDeposit(std::string token, std::string user, std::string acc, double deposit);
 			//counts accounts available
-			int accountsCount(std::string user);
+			int accountsCount(std::string token);
 			//displays summary of accounts
-			std::string accountDisplay(std::string user, std::string acc);
+			std::string accountDisplay(std::string token, std::string acc);
 			//displays summaries
-			std::string accountsDisplay(std::string user);
+			std::string accountsDisplay(std::string token);
 			//gets transactions
-			std::string accountTransactions(std::string user, std::string acc);
-			//purchase
-			bool purchase(std::string user, std::string acc, double val, std::string name = "Purchase", std::string origin = "Unknown");
-			void runBankProccesses();
+			std::string accountTransactions(std::string token, std::string acc);
+			//purchase on a customer's account; employees only
+			bool purchase(std::string token, std::string user, std::string acc, double val, std::string name = "Purchase", std::string origin = "Unknown");
+			//posts a card settlement file; employees only. returns rows posted
+			int purchaseBatch(std::string token, std::string path);
+			//loads a migrated portfolio file & snapshots it; employees only. returns accounts loaded
+			int bulkLoad(std::string token, std::string path);
+			//totals transactions over the last few days for employees, grouped by origin, name, type, account, product or accounttype
+			std::string transactionReport(std::string token, std::string type = "", std::string groupBy = "", int days = 30);
+			//interest, compaction & a snapshot; employees only
+			bool runBankProccesses(std::string token);
+
+		private:
+			//the live session for a token, pushing back its expiry; role is -1 if it's unknown or expired
+			Session session(std::string token);
+			//ends every session a user has in a role, except keep
+			void revoke(std::string user, int role, std::string keep = "");
+
+			std::shared_ptr<DB::Database> db; //the bank being served
+			std::unordered_map<std::string, Session> sessions; //every session by token; menus check a token here instead of the user lists & passwords
+			std::mutex sessionLock; //guards sessions & sweepAt
+			size_t sweepAt = 64; //table size that triggers the next sweep of expired sessions
 	};
 }
\ No newline at end of file
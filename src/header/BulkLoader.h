@@ -0,0 +1,85 @@
+#pragma once
+
+#include "List.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+namespace DB
+{
+	//Forward declarations
+	class Database;
+
+	/// <summary>
+	/// Thrown when a bulk load file can't be read
+	/// </summary>
+	class ExBulkLoad : public Exception
+	{
+		public:
+			/// <summary>
+			/// Constructor
+			/// </summary>
+			/// <param name="s">throwing function</param>
+			ExBulkLoad(std::string s) : Exception(s) {}
+
+			/// <summary>
+			/// print the error to cout
+			/// </summary>
+			void printError()
+			{
+				std::cout << "Could not read the bulk load file, while executing function: " << throwingFunc << "\n";
+			}
+	};
+
+	/// <summary>
+	/// what a bulk load did
+	/// </summary>
+	struct BulkLoadResult
+	{
+		int customers = 0;
+		int accounts = 0;
+		long long transactions = 0;
+		long long rejected = 0; //lines that didn't parse, duplicates & transactions for unknown accounts
+	};
+
+	/// <summary>
+	/// how a bulk load file's fields are split: by a delimiter, or by fixed widths when any are given
+	/// </summary>
+	struct BulkLayout
+	{
+		char delimiter = ',';
+		std::vector<int> widths; //column widths, kind first; trailing spaces in a column are dropped
+	};
+
+	/// <summary>
+	/// Loads a migrated portfolio straight into a database. The file is read in chunks; each chunk's lines are parsed in parallel into
+	/// ready-made customers, accounts & transactions, which then go straight into the shards through their hash indices instead of the
+	/// add functions' checks. Transactions are applied shard by shard in parallel, each account's in one go.
+	///
+	/// One record per line, first field is the kind:
+	///   C,name,password
+	///   A,accountID,owner,type,product,opening  (type as in accountTypeCode, opening deposit in dollars, owner may be empty)
+	///   T,accountID,kind,amount,name,origin[,unix seconds]  (kind P purchase, T transfer, D deposit, B bank function; amount in dollars)
+	/// Customers & accounts have to come before their transactions. Nothing is written to the log, so load before the log is on or take
+	/// a snapshot afterwards
+	/// </summary>
+	class BulkLoader
+	{
+		public:
+			BulkLoader(Database& d, std::shared_ptr<ThreadPool> p = std::shared_ptr<ThreadPool>(), size_t chunk = 16 << 20) : db(d), pool(p), chunkBytes(chunk) {}
+			~BulkLoader() {}
+
+			//loads a whole file
+			BulkLoadResult load(std::string path, BulkLayout layout = BulkLayout());
+			//loads records already in memory; used per chunk, & handy for tests
+			BulkLoadResult loadText(const std::string& text, BulkLayout layout = BulkLayout());
+
+		private:
+			Database& db;
+			std::shared_ptr<ThreadPool> pool; //parses & applies in parallel when set
+			size_t chunkBytes; //bytes read per chunk
+	};
+}
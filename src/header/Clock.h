@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+namespace DB
+{
+	/// <summary>
+	/// Where a database gets the time from. A database & its accounts ask their TimeSource instead of the system clock,
+	/// so a simulated clock can be swapped in to run years of interest in seconds
+	/// </summary>
+	class Clock
+	{
+		public:
+			virtual ~Clock() {}
+			virtual std::chrono::system_clock::time_point now() = 0; //current time
+	};
+
+	/// <summary>
+	/// The real clock; the default
+	/// </summary>
+	class SystemClock : public Clock
+	{
+		public:
+			std::chrono::system_clock::time_point now()
+			{
+				return std::chrono::system_clock::now();
+			}
+	};
+
+	/// <summary>
+	/// A clock that only moves when told to. Safe to read from any thread while one thread moves it
+	/// </summary>
+	class SimulatedClock : public Clock
+	{
+		public:
+			/// <summary>
+			/// Constructor
+			/// </summary>
+			/// <param name="start">time the clock starts at</param>
+			SimulatedClock(std::chrono::system_clock::time_point start = std::chrono::system_clock::now())
+			{
+				set(start);
+			}
+
+			std::chrono::system_clock::time_point now()
+			{
+				return std::chrono::system_clock::time_point(std::chrono::system_clock::duration(ticks.load()));
+			}
+
+			//jumps to a time; going backwards is allowed, though interest won't run for time already counted
+			void set(std::chrono::system_clock::time_point t)
+			{
+				ticks.store(t.time_since_epoch().count());
+			}
+
+			//moves the clock forward
+			void advance(std::chrono::system_clock::duration d)
+			{
+				ticks.fetch_add(d.count());
+			}
+
+		private:
+			std::atomic<std::int64_t> ticks; //system_clock ticks since epoch
+	};
+
+	/// <summary>
+	/// The clock one database reads from. The database & every account in it share one of these, so swapping the clock
+	/// reaches all of them without a process-wide setting; two databases can run on different clocks
+	/// </summary>
+	class TimeSource
+	{
+		public:
+			TimeSource() : active(nullptr) {}
+
+			//swaps the clock; null puts the real clock back. Meant for setup, not while other threads are working
+			void set(std::shared_ptr<Clock> c)
+			{
+				active.store(c.get());
+				current = c;
+			}
+
+			//the clock in use, null for the real one
+			std::shared_ptr<Clock> get()
+			{
+				return current;
+			}
+
+			//current time, real or simulated
+			std::chrono::system_clock::time_point now()
+			{
+				Clock* c = active.load();
+				return c ? c->now() : std::chrono::system_clock::now();
+			}
+
+		private:
+			std::shared_ptr<Clock> current; //keeps the clock alive
+			std::atomic<Clock*> active; //what now() reads
+	};
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "BankDB.h"
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace DB
+{
+	/// <summary>
+	/// Batch interest engine. The interest fields of every account are gathered into column arrays, one group per product,
+	/// so the due checks & accrual math run as tight loops over plain numbers. Only accounts with something due get touched again.
+	/// </summary>
+	class InterestBatch
+	{
+		public:
+			InterestBatch();
+			~InterestBatch() {}
+
+			//copies an account's interest fields into its product's columns
+			void gather(std::shared_ptr<Account> acc);
+			//gathers every account in a list
+			void gather(LinkedList<Account>& accs);
+			//works out accruals & payouts due at a given time; touches no accounts
+			void compute(std::chrono::system_clock::time_point now);
+			//writes the results back to the accounts, returns how many accounts were changed
+			int scatter(std::chrono::system_clock::time_point now);
+			//gather, compute & scatter in one go
+			int run(LinkedList<Account>& accs, std::chrono::system_clock::time_point now);
+
+			//accounts gathered so far
+			int size()
+			{
+				return count;
+			}
+
+		private:
+			/// <summary>
+			/// interest columns for every account on one product; index i in each vector is the same account
+			/// </summary>
+			struct Columns
+			{
+				std::vector<std::shared_ptr<Account>> accounts; //handles, only used when scattering
+				std::vector<std::int32_t> balance; //balance in cents
+				std::vector<std::int64_t> lastInterest; //clock ticks
+				std::vector<std::int64_t> lastPayout; //clock ticks
+				std::vector<std::uint8_t> payoutBlocked; //1 for certificates of deposit, which don't pay out until term
+				std::vector<std::int32_t> accrual; //result: cents to accrue
+				std::vector<std::uint8_t> due; //result: 1 accrue, 2 pay out, 3 both
+			};
+
+			std::vector<Columns> groups; //indexed by product ID
+			int count = 0; //accounts gathered
+	};
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Arena.h"
 #include "Exception.h"
 #include <string>
 #include <memory>
@@ -22,6 +23,9 @@ class ExLLOoB : public Exception
 		}
 };
 
+template <typename T>
+class InternalNode; //Forward declaration
+
 /// <summary>
 /// Abstract Node class for Linked List.
 /// </summary>
@@ -32,6 +36,15 @@ class Node
 		//these are made private because it forces the Node::set/get functions which work better
 		std::shared_ptr<Node<T>> next; //next Node
 		std::shared_ptr<Node<T>> previous; //previous Node
+		Arena* arena = nullptr; //where new neighbours are made, null for the heap; kept alive by the list
+	protected:
+		//makes a new internal node in this node's arena
+		std::shared_ptr<Node<T>> makeNode(std::shared_ptr<T> d, std::shared_ptr<Node<T>> n = std::shared_ptr<Node<T>>(), std::shared_ptr<Node<T>> p = std::shared_ptr<Node<T>>())
+		{
+			std::shared_ptr<Node<T>> node = arenaShared<InternalNode<T>>(arena, d, n, p);
+			node->setArena(arena);
+			return node;
+		}
 	public:
 		Node(std::shared_ptr<Node<T>> n, std::shared_ptr<Node<T>> p)
 			//constructor; as this is abstract & never constructed directly, no need for a default. that'll be in the derived classes
@@ -60,6 +73,11 @@ class Node
 			return previous;
 		}
 
+		void setArena(Arena* a) //sets where new neighbours are made
+		{
+			arena = a;
+		}
+
 		virtual ~Node() {}
 
 		//these functions have to be virtual, as only InternalNode will have the data pointer.
@@ -196,7 +214,7 @@ class InternalNode : public Node<T>
 			}
 			if (*i == *j)
 			{
-				std::shared_ptr<Node<T>> n(new InternalNode<T>(d));
+				std::shared_ptr<Node<T>> n = Node<T>::makeNode(d);
 				Node<T>::getPrevious()->setNext(n);
 				Node<T>::getPrevious() = n;
 			}
@@ -404,7 +422,7 @@ class ExternalNode : public Node<T>
 				if (!Node<T>::getNext())
 				{
 					b = true;
-					std::shared_ptr<Node<T>> n(new InternalNode<T>(d, Node<T>::getPrevious()->getNext(), Node<T>::getPrevious()));
+					std::shared_ptr<Node<T>> n = Node<T>::makeNode(d, Node<T>::getPrevious()->getNext(), Node<T>::getPrevious());
 					Node<T>::getPrevious()->setNext(n);
 					Node<T>::setPrevious(n);
 				}
@@ -418,7 +436,7 @@ class ExternalNode : public Node<T>
 				if (!Node<T>::getPrevious())
 				{
 					b = true;
-					std::shared_ptr<Node<T>> n(new InternalNode<T>(d, Node<T>::getNext()->getPrevious(), Node<T>::getNext()));
+					std::shared_ptr<Node<T>> n = Node<T>::makeNode(d, Node<T>::getNext()->getPrevious(), Node<T>::getNext());
 					Node<T>::getNext()->setPrevious(n);
 					Node<T>::setNext(n);
 				}
@@ -432,14 +450,14 @@ class ExternalNode : public Node<T>
 				if (!Node<T>::getNext())
 				{
 					b = true;
-					std::shared_ptr<Node<T>> n(new InternalNode<T>(d, Node<T>::getPrevious()->getNext(), Node<T>::getPrevious()));
+					std::shared_ptr<Node<T>> n = Node<T>::makeNode(d, Node<T>::getPrevious()->getNext(), Node<T>::getPrevious());
 					Node<T>::getPrevious()->setNext(n);
 					Node<T>::setPrevious(n);
 				}
 				if (!Node<T>::getPrevious())
 				{
 					b = true;
-					std::shared_ptr<Node<T>> n(new InternalNode<T>(d, Node<T>::getNext(), Node<T>::getNext()->getPrevious()));
+					std::shared_ptr<Node<T>> n = Node<T>::makeNode(d, Node<T>::getNext(), Node<T>::getNext()->getPrevious());
 					Node<T>::getNext()->setPrevious(n);
 					Node<T>::setNext(n);
 				}
@@ -553,6 +571,7 @@ class LinkedList
 		std::shared_ptr<Node<T>> head; //head pointer
 		std::shared_ptr<Node<T>> tail; //tail pointer
 		int count = 0; //last count of internal nodes; updated via operations
+		std::shared_ptr<Arena> memory; //arena new nodes come from, null for the heap
 	public:
 		LinkedList() //constructor
 		{
@@ -843,4 +862,44 @@ class LinkedList
 			return count;
 		}
 
+		/// <summary>
+		/// makes new nodes in an arena from now on; nodes already made stay where they are
+		/// </summary>
+		/// <param name="a">arena, null for the heap</param>
+		void setArena(std::shared_ptr<Arena> a)
+		{
+			memory = a;
+			for (std::shared_ptr<Node<T>> n = head; n; n = n->getNext()) n->setArena(a.get());
+		}
+
+		/// <summary>
+		/// walks the list front to back in a single pass; much cheaper than calling get(i) in a loop
+		/// </summary>
+		/// <param name="f">function taking the data pointer, returns false to stop early</param>
+		template <typename F>
+		void forEach(F f)
+		{
+			std::shared_ptr<Node<T>> n = head->getNext();
+			while (n && n != tail)
+			{
+				if (!f(std::static_pointer_cast<InternalNode<T>>(n)->data)) return; //only internal nodes sit between head & tail
+				n = n->getNext();
+			}
+		}
+
+		/// <summary>
+		/// walks the list back to front in a single pass
+		/// </summary>
+		/// <param name="f">function taking the data pointer, returns false to stop early</param>
+		template <typename F>
+		void forEachReverse(F f)
+		{
+			std::shared_ptr<Node<T>> n = tail->getPrevious();
+			while (n && n != head)
+			{
+				if (!f(std::static_pointer_cast<InternalNode<T>>(n)->data)) return;
+				n = n->getPrevious();
+			}
+		}
+
 };
\ No newline at end of file
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+
+namespace DB
+{
+	/// <summary>
+	/// An interest product. Accounts reference one by ID; everything interest runs need is worked out once, here, at compile time
+	/// </summary>
+	struct InterestProduct
+	{
+		int id; //product ID, what accounts store
+		const char* name; //display name
+		double APY; //interest rate (can always be expressed as APY, it's just that simple doesn't compound each year)
+		int interestType; //0: None, 1: Simple, 2: Compound Yearly, 3: Compound Monthly, 4: Compound Daily
+		int payoutRate; //0: Yearly/None, 1: Every 6 months, 2: monthly, 3: daily
+
+		//precomputed from the above
+		int accrualHours; //hours between accruals, 0 for no interest
+		int payoutHours; //hours between payouts
+		double periodRate; //percent accrued each accrual period
+		double payoutRatio; //accrual periods per payout
+		int payoutCents; //amount of each payout, in cents
+	};
+
+	//hours between accruals for an interest type
+	constexpr int accrualHoursFor(int interestType)
+	{
+		return (interestType == 1 || interestType == 2) ? 8760 : interestType == 3 ? 720 : interestType == 4 ? 24 : 0;
+	}
+
+	//hours between payouts for a payout rate
+	constexpr int payoutHoursFor(int payoutRate)
+	{
+		return payoutRate == 1 ? 4320 : payoutRate == 2 ? 720 : payoutRate == 3 ? 24 : 8760;
+	}
+
+	//percent accrued per period; monthly & daily compounding split the yearly rate
+	constexpr double periodRateFor(double apy, int interestType)
+	{
+		return interestType == 3 ? apy / 12 : interestType == 4 ? apy / 365 : apy;
+	}
+
+	/// <summary>
+	/// builds a product & its precomputed constants
+	/// </summary>
+	constexpr InterestProduct makeProduct(int id, const char* name, double apy, int interestType, int payoutRate)
+	{
+		return InterestProduct{ id, name, apy, interestType, payoutRate,
+			accrualHoursFor(interestType),
+			payoutHoursFor(payoutRate),
+			periodRateFor(apy, interestType),
+			accrualHoursFor(interestType) > 0 ? payoutHoursFor(payoutRate) / (double)accrualHoursFor(interestType) : 1,
+			(int)(periodRateFor(apy, interestType) * (accrualHoursFor(interestType) > 0 ? payoutHoursFor(payoutRate) / (double)accrualHoursFor(interestType) : 1) * 100) };
+	}
+
+	/// <summary>
+	/// The product catalog; an account's product ID indexes straight into it. Add new products to the end so existing IDs keep their meaning
+	/// </summary>
+	constexpr InterestProduct InterestProducts[] = {
+		makeProduct(0, "No Interest", 0, 0, 0),
+		makeProduct(1, "Simple, Yearly", 0.5, 1, 0),
+		makeProduct(2, "Compound Yearly", 0.5, 2, 0),
+		makeProduct(3, "Compound Monthly, Paid Every 6 Months", 0.5, 3, 1),
+		makeProduct(4, "Compound Monthly, Paid Monthly", 0.5, 3, 2),
+		makeProduct(5, "Compound Daily, Paid Monthly", 0.5, 4, 2),
+		makeProduct(6, "Compound Daily, Paid Daily", 0.5, 4, 3),
+		makeProduct(7, "High Yield Compound Daily", 2, 4, 3),
+		makeProduct(8, "Certificate Compound Daily", 5, 4, 0),
+		makeProduct(9, "High Rate Simple, Paid Daily", 10, 1, 3)
+	};
+
+	//number of products in the catalog
+	constexpr int InterestProductCount = sizeof(InterestProducts) / sizeof(InterestProduct);
+
+	//is this a real product ID
+	constexpr bool validProduct(int id)
+	{
+		return id >= 0 && id < InterestProductCount;
+	}
+
+	//looks a product up by ID; unknown IDs get the no interest product
+	inline const InterestProduct& getProduct(int id)
+	{
+		return InterestProducts[validProduct(id) ? id : 0];
+	}
+
+	/// <summary>
+	/// Interest accrued over a number of whole periods, in cents, worked out in one step instead of one run per period.
+	/// An accrual goes to the interest so far, not the balance, so each period a run would have done accrues the same amount
+	/// on the same balance, truncated to the cent like USDollar::GetPercentage. Catching up N periods at once therefore gives
+	/// exactly what N runs a period apart would have
+	/// </summary>
+	/// <param name="balance">balance in cents</param>
+	/// <param name="p">interest product</param>
+	/// <param name="periods">whole accrual periods elapsed</param>
+	/// <returns>cents to accrue</returns>
+	inline std::int64_t accrualCents(std::int64_t balance, const InterestProduct& p, std::int64_t periods)
+	{
+		if (periods < 1 || p.accrualHours <= 0) return 0;
+		std::int64_t single = (std::int64_t)(balance * (p.periodRate / 100)); //same arithmetic as USDollar::GetPercentage
+		return single * periods;
+	}
+
+	//how many of the missed accrual periods to catch up in one go: all of them, unless their total wouldn't fit in the int
+	//cents USDollar holds. The rest stay missed, so the next run catches them up
+	inline std::int64_t accruablePeriods(std::int64_t balance, const InterestProduct& p, std::int64_t periods)
+	{
+		std::int64_t single = accrualCents(balance, p, 1);
+		if (single == 0) return periods;
+		std::int64_t most = INT32_MAX / (single < 0 ? -single : single);
+		return periods < most ? periods : most;
+	}
+
+	//same for payouts: every missed payout period at once, as long as the total fits in an int of cents
+	inline std::int64_t payablePeriods(const InterestProduct& p, std::int64_t periods)
+	{
+		if (p.payoutCents <= 0) return periods;
+		std::int64_t most = INT32_MAX / p.payoutCents;
+		return periods < most ? periods : most;
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+namespace DB
+{
+	//Forward declarations
+	class Database;
+
+	/// <summary>
+	/// what to total over the bank's transactions. Every filter left at its default matches everything
+	/// </summary>
+	struct TransactionQuery
+	{
+		/// <summary>
+		/// what rows are grouped by
+		/// </summary>
+		enum GroupBy
+		{
+			ALL, //one row for everything matched
+			ORIGIN,
+			NAME,
+			TYPE, //transaction type, like Purchase
+			ACCOUNT,
+			PRODUCT, //the account's interest product
+			ACCOUNT_TYPE //the account's type, like Checking
+		};
+
+		std::string type; //transaction type to match, like Purchase; empty matches any
+		std::string name; //exact name to match; empty matches any
+		std::string origin; //exact origin to match; empty matches any
+		std::chrono::system_clock::time_point from = std::chrono::system_clock::time_point::min(); //inclusive
+		std::chrono::system_clock::time_point to = std::chrono::system_clock::time_point::max(); //exclusive
+		int sign = 0; //1 only money in, -1 only money out, 0 both
+		int accountType = -1; //see accountTypeCode; -1 matches any
+		int product = -1; //interest product; -1 matches any
+		GroupBy group = ALL;
+	};
+
+	/// <summary>
+	/// one group's totals, in cents
+	/// </summary>
+	struct QueryRow
+	{
+		std::string key;
+		long long count = 0;
+		long long sum = 0;
+		int min = 0;
+		int max = 0;
+	};
+
+	/// <summary>
+	/// Filter, group-by & count/sum/min/max over every account's transactions, hot & archived, in one pass. Each shard is its own
+	/// partition: its accounts are scanned by one task into that task's own groups, & the groups are merged at the end. Type &
+	/// product filters go through the shard's secondary index, & archived blocks outside the time range are never read. Compacted
+	/// history counts as its summaries: sums are exact, counts, mins & maxes are of the summary rows
+	/// </summary>
+	class QueryEngine
+	{
+		public:
+			QueryEngine(Database& d, std::shared_ptr<ThreadPool> p = std::shared_ptr<ThreadPool>()) : db(d), pool(p) {}
+			~QueryEngine() {}
+
+			//runs a query; rows come back sorted by key
+			std::vector<QueryRow> run(const TransactionQuery& q);
+			//renders rows as text, one per line: key : count : sum : min : max
+			static std::string format(const std::vector<QueryRow>& rows);
+
+		private:
+			Database& db;
+			std::shared_ptr<ThreadPool> pool; //scans shards in parallel when set
+	};
+}
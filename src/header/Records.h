@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+class Arena; //Forward declaration
+
+namespace DB
+{
+	//Forward declarations
+	class Transaction;
+	class Account;
+
+	//account type codes; same numbering the server uses when creating accounts. kept stable because they are written to disk
+	const std::uint8_t ACCOUNT_SAVING = 0;
+	const std::uint8_t ACCOUNT_CHECKING = 1;
+	const std::uint8_t ACCOUNT_CD = 2;
+	const std::uint8_t ACCOUNT_MONEYMARKET = 3;
+
+	/// <summary>
+	/// writes a fixed size value in the host's byte order
+	/// </summary>
+	template <typename V>
+	void writeRaw(std::string& out, V v)
+	{
+		out.append(reinterpret_cast<const char*>(&v), sizeof(V));
+	}
+
+	//writes a length-prefixed string
+	void writeString(std::string& out, const std::string& s);
+	//writes a transaction: timestamp ticks, value in cents, type code, flags, name, origin
+	void writeTransaction(std::string& out, Transaction& t);
+	//stable code for an account's type, for writing to disk
+	std::uint8_t accountTypeCode(Account& a);
+	//builds an empty account of a stored type around its first transaction, in an arena when one is given
+	std::shared_ptr<Account> makeAccount(std::uint8_t code, std::shared_ptr<Transaction> first, std::string id, Arena* arena = nullptr);
+
+	/// <summary>
+	/// Reads values back out of a byte buffer written with the functions above. A short read marks the reader bad
+	/// instead of throwing, so callers decide whether that's a torn record or a corrupt file
+	/// </summary>
+	class RecordReader
+	{
+		public:
+			/// <summary>
+			/// Constructor
+			/// </summary>
+			/// <param name="d">bytes to read; must outlive the reader</param>
+			RecordReader(const std::string& d) : data(d.data()), size(d.size()) {}
+			/// <summary>
+			/// Constructor, reading straight out of memory that isn't a string, like a mapped file
+			/// </summary>
+			/// <param name="d">first byte</param>
+			/// <param name="n">byte count</param>
+			RecordReader(const char* d, size_t n) : data(d), size(n) {}
+			~RecordReader() {}
+
+			//reads a fixed size value; 0 if there aren't enough bytes left
+			template <typename V>
+			V read()
+			{
+				V v = V();
+				if (!ok || size - pos < sizeof(V))
+				{
+					ok = false;
+					return v;
+				}
+				std::memcpy(&v, data + pos, sizeof(V));
+				pos += sizeof(V);
+				return v;
+			}
+
+			//reads a run of raw bytes
+			std::string readBytes(size_t n);
+			//reads a length-prefixed string
+			std::string readString();
+			//reads a transaction, null if the bytes ran out; made in an arena when one is given
+			std::shared_ptr<Transaction> readTransaction(Arena* arena = nullptr);
+
+			//has every read so far succeeded
+			bool good()
+			{
+				return ok;
+			}
+
+			//bytes read so far
+			size_t position()
+			{
+				return pos;
+			}
+
+			//everything has been read
+			bool atEnd()
+			{
+				return pos >= size;
+			}
+
+		private:
+			const char* data;
+			size_t size; //bytes in data
+			size_t pos = 0; //next byte to read
+			bool ok = true;
+	};
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+class ThreadPool;
+
+namespace DB
+{
+	//Forward declarations
+	class Account;
+
+	/// <summary>
+	/// Due-date queue for interest. Each account sits in a min-heap keyed on its next accrual or payout instant,
+	/// so a bank process tick only pops & runs the accounts that are actually due
+	/// </summary>
+	class InterestScheduler
+	{
+		public:
+			InterestScheduler() {}
+			~InterestScheduler() {}
+
+			//(re)computes when an account is next due & queues it; accounts with nothing to ever do aren't queued
+			void schedule(std::shared_ptr<Account> acc);
+			//runs interest for every account due by now, then requeues them; returns accounts changed
+			int tick(std::chrono::system_clock::time_point now, std::shared_ptr<ThreadPool> pool);
+			//earliest due time in the queue, false if nothing is queued
+			bool nextTime(std::chrono::system_clock::time_point& t);
+			//when an account next has interest work, false if never
+			static bool nextDue(std::shared_ptr<Account> acc, std::chrono::system_clock::time_point& due);
+
+			//entries in the queue, including replaced ones not popped yet
+			int queued()
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				return (int)queue.size();
+			}
+
+			//drops every entry, letting go of the accounts they hold; the bank does this before it goes away
+			void clear()
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				queue = std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>>();
+			}
+
+		private:
+			/// <summary>
+			/// One queued due date. Rescheduling an account bumps the version it carries, which makes older entries stale; they're
+			/// skipped when popped. The version lives on the account, so there's nothing here to clean up per account
+			/// </summary>
+			struct Entry
+			{
+				std::int64_t due; //clock ticks
+				std::uint64_t version; //matches acc->ScheduledVersion while the entry is live
+				std::shared_ptr<Account> acc;
+
+				bool operator>(const Entry& other) const
+				{
+					return due > other.due;
+				}
+			};
+
+			std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue; //soonest due on top
+			std::mutex lock; //guards the queue & every queued account's ScheduledVersion
+	};
+}
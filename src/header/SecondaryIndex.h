@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace DB
+{
+	//Forward declarations
+	class Account;
+
+	/// <summary>
+	/// Secondary indices over one shard's accounts: by account type, by interest product & by whether the balance is negative.
+	/// Accounts report product & overdrawn changes themselves, so batch jobs can go straight to their target set instead of scanning
+	/// </summary>
+	class SecondaryIndex
+	{
+		public:
+			SecondaryIndex() {}
+			~SecondaryIndex() {}
+
+			//lists a new account under its current type, product & balance
+			void add(std::shared_ptr<Account> acc);
+			//moves an account to another product's set
+			void productChanged(const std::string& id, int product);
+			//moves an account in or out of the overdrawn set
+			void negativeChanged(const std::string& id, bool negative);
+			//accounts matching every given key; -1 for type or product matches any. overdrawnOnly limits it to negative balances; accounts
+			//already gone are left out
+			std::vector<std::shared_ptr<Account>> find(int type, int product, bool overdrawnOnly);
+
+		private:
+			/// <summary>
+			/// an indexed account & the keys it's listed under
+			/// </summary>
+			struct Entry
+			{
+				std::weak_ptr<Account> acc; //weak; the account holds this index, so a strong one would keep both alive forever
+				int type; //see accountTypeCode
+				int product;
+				bool negative;
+			};
+
+			std::mutex lock; //taken after an account's lock, never before
+			std::unordered_map<std::string, Entry> members; //account ID to entry
+			std::unordered_map<int, std::unordered_set<std::string>> byType; //type code to account IDs
+			std::unordered_map<int, std::unordered_set<std::string>> byProduct; //product ID to account IDs
+			std::unordered_set<std::string> negatives; //IDs of accounts below zero
+	};
+}
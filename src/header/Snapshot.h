@@ -0,0 +1,163 @@
+#pragma once
+
+#include "List.h"
+#include <cstdint>
+#include <string>
+
+namespace DB
+{
+	//Forward declarations
+	class Database;
+
+	/// <summary>
+	/// Thrown when a snapshot can't be written, mapped or understood
+	/// </summary>
+	class ExSnapshotIO : public Exception
+	{
+		public:
+			/// <summary>
+			/// Constructor
+			/// </summary>
+			/// <param name="s">throwing function</param>
+			ExSnapshotIO(std::string s) : Exception(s) {}
+
+			/// <summary>
+			/// print the error to cout
+			/// </summary>
+			void printError()
+			{
+				std::cout << "Could not use the database snapshot, while executing function: " << throwingFunc << "\n";
+			}
+	};
+
+	/// <summary>
+	/// A whole file mapped read-only into memory
+	/// </summary>
+	class MappedFile
+	{
+		public:
+			MappedFile(std::string path);
+			~MappedFile();
+
+			//first byte of the file
+			const char* data()
+			{
+				return base;
+			}
+
+			//file length
+			size_t size()
+			{
+				return length;
+			}
+
+		private:
+			const char* base = nullptr;
+			size_t length = 0;
+			int fd = -1; //file descriptor, when mapped with mmap
+			void* file = nullptr; //file handle, when mapped on Windows
+			void* mapping = nullptr; //mapping handle, when mapped on Windows
+	};
+
+	//writes a whole file through a synced temp file renamed over it, so a crash leaves the old file or the new one, never half of either
+	bool replaceFile(const std::string& path, const std::string& bytes);
+
+	//on-disk layout. every section starts on an 8 byte boundary & every row is fixed size, so a mapped file's rows are used in place.
+	//strings live in one heap at the end & rows point into it by offset
+
+	/// <summary>
+	/// start of the file; says where every section is
+	/// </summary>
+	struct SnapshotHeader
+	{
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint64_t users; //row counts
+		std::uint64_t accounts;
+		std::uint64_t owners;
+		std::uint64_t segments;
+		std::uint64_t usersAt; //section offsets
+		std::uint64_t accountsAt;
+		std::uint64_t ownersAt;
+		std::uint64_t segmentsAt;
+		std::uint64_t historyAt;
+		std::uint64_t stringsAt;
+		std::uint64_t stringsSize;
+		std::uint64_t archivePath; //string heap offset, for the archive file the segments point into
+		std::uint32_t archivePathLength;
+		std::int32_t hotWindow;
+		std::uint64_t logSeq; //newest log record the snapshot has; replay & log rotation start after it
+	};
+
+	/// <summary>
+	/// a customer or employee
+	/// </summary>
+	struct SnapshotUser
+	{
+		std::uint64_t name; //string heap offsets
+		std::uint64_t password;
+		std::uint32_t nameLength;
+		std::uint32_t passwordLength;
+		std::uint8_t kind; //0 customer, 1 employee
+		std::uint8_t pad[7];
+	};
+
+	/// <summary>
+	/// an account, its balances & interest state, & where its history is
+	/// </summary>
+	struct SnapshotAccount
+	{
+		std::uint64_t id; //string heap offset
+		std::uint64_t history; //offset into the history section of the hot transactions
+		std::uint64_t segments; //first archived segment row
+		std::int64_t lastInterest; //clock ticks
+		std::int64_t lastPayout;
+		std::uint64_t loggedSeq; //newest log record reflected here
+		std::uint32_t idLength;
+		std::uint32_t historyBytes;
+		std::int32_t historyCount;
+		std::int32_t segmentCount;
+		std::int32_t product;
+		std::int32_t balance; //cents
+		std::int32_t available;
+		std::int32_t interestSoFar;
+		std::int32_t archivedBalance;
+		std::int32_t archivedCount;
+		std::uint8_t type; //see accountTypeCode
+		std::uint8_t pad[7];
+	};
+
+	/// <summary>
+	/// one customer owning one account, by row index
+	/// </summary>
+	struct SnapshotOwner
+	{
+		std::uint32_t customer;
+		std::uint32_t account;
+	};
+
+	/// <summary>
+	/// an archived block, as in ArchiveSegment
+	/// </summary>
+	struct SnapshotSegment
+	{
+		std::uint64_t offset;
+		std::int64_t first;
+		std::int64_t last;
+		std::int32_t count;
+		std::uint32_t bytes;
+	};
+
+	/// <summary>
+	/// Binary snapshot of a whole database: users, accounts, balances & histories. Loading maps the file & reads rows straight
+	/// out of the mapping, so a cold start costs one pass over the accounts. The log is replayed on top for anything newer
+	/// </summary>
+	class Snapshot
+	{
+		public:
+			//writes a database to a file; goes through a temp file so a crash never leaves half a snapshot. returns the log checkpoint it has
+			static std::uint64_t write(std::string path, Database& d);
+			//loads a snapshot into a fresh database, returns accounts loaded
+			static int load(std::string path, Database& d);
+	};
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "List.h"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+namespace DB
+{
+	//Forward declarations
+	class Database;
+	class Account;
+
+	/// <summary>
+	/// Thrown when a statement file can't be written
+	/// </summary>
+	class ExStatementIO : public Exception
+	{
+		public:
+			/// <summary>
+			/// Constructor
+			/// </summary>
+			/// <param name="s">throwing function</param>
+			ExStatementIO(std::string s) : Exception(s) {}
+
+			/// <summary>
+			/// print the error to cout
+			/// </summary>
+			void printError()
+			{
+				std::cout << "Could not write the statement file, while executing function: " << throwingFunc << "\n";
+			}
+	};
+
+	/// <summary>
+	/// An output file behind one fixed buffer. Text is copied straight into the buffer & only goes to the file, in one write,
+	/// when the buffer fills, so a statement run costs one system call per buffer instead of one per line
+	/// </summary>
+	class StatementFile
+	{
+		public:
+			StatementFile(std::string path, size_t capacity = 1 << 20);
+			~StatementFile();
+
+			//appends raw bytes
+			void append(const char* s, size_t n);
+			//appends a string
+			void append(const std::string& s)
+			{
+				append(s.data(), s.size());
+			}
+			//appends cents as dollars, like -$12.34
+			void appendCents(int cents);
+			//appends a date, like 2026-10-01 (UTC)
+			void appendDate(std::chrono::system_clock::time_point t);
+			//writes out whatever is buffered
+			void flush();
+
+		private:
+			std::vector<char> buffer; //allocated once, reused for every flush
+			size_t used = 0; //bytes waiting in buffer
+			int fd = -1; //file descriptor
+	};
+
+	/// <summary>
+	/// Month-end statements: every account's opening balance, transactions in the period & closing balance, written to one file
+	/// per shard. Shards are rendered in parallel, each through its own StatementFile, & each account is rendered straight into
+	/// the buffer, so memory stays at a buffer per worker plus one archived block at a time, whatever the bank's size
+	/// </summary>
+	class StatementExporter
+	{
+		public:
+			StatementExporter(Database& d, std::shared_ptr<ThreadPool> p = std::shared_ptr<ThreadPool>(), size_t buffer = 1 << 20) : db(d), pool(p), bufferBytes(buffer) {}
+			~StatementExporter() {}
+
+			//writes statements for [from, to) into dir as statements-<shard>.txt; returns accounts written
+			long long exportAll(std::string dir, std::chrono::system_clock::time_point from, std::chrono::system_clock::time_point to);
+			//renders one account's statement for [from, to) into out
+			static void render(Account& a, StatementFile& out, std::chrono::system_clock::time_point from, std::chrono::system_clock::time_point to);
+
+		private:
+			Database& db;
+			std::shared_ptr<ThreadPool> pool; //renders shards in parallel when set
+			size_t bufferBytes; //buffer per output file
+	};
+}
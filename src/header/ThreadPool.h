@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Fixed size pool of worker threads for splitting a job into numbered tasks
+/// </summary>
+class ThreadPool
+{
+	public:
+		ThreadPool(int threads = 0); //0 uses every core
+		~ThreadPool();
+
+		//runs f(0) .. f(tasks - 1) across the workers & the calling thread, returns once all are done.
+		//rethrows the first exception a task threw. Tasks must not call parallelFor on the same pool
+		void parallelFor(int tasks, std::function<void(int)> f);
+
+		//threads working on a job, counting the caller
+		int size()
+		{
+			return (int)workers.size() + 1;
+		}
+
+	private:
+		void work(); //worker loop
+		void drain(); //claims & runs tasks until none are left
+
+		std::vector<std::thread> workers; //worker threads
+		std::mutex runLock; //one job at a time
+		std::mutex m; //guards everything below
+		std::condition_variable wake; //new job or shutdown
+		std::condition_variable finished; //all tasks of the job done
+		std::function<void(int)> job; //current job
+		int next = 0; //next task to hand out
+		int total = 0; //tasks in the job
+		int remaining = 0; //tasks not finished yet
+		unsigned generation = 0; //bumped per job so workers know there's new work
+		bool stop = false; //shutting down
+		std::exception_ptr error; //first exception thrown by a task
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+
+namespace DB
+{
+	//Forward declarations
+	class Account;
+
+	/// <summary>
+	/// One committed state of an account. Never changed once published, apart from older being cut off when no reader needs it
+	/// </summary>
+	struct AccountVersion
+	{
+		std::uint64_t version = 0; //commit it became visible at
+		std::int32_t balance = 0; //cents
+		std::int32_t available = 0;
+		int transactions = 0; //hot & archived
+		std::shared_ptr<AccountVersion> older; //previous state, only kept while a reader might need it; read & written atomically
+	};
+
+	/// <summary>
+	/// Multi-version store for account states. Writers publish a new state per commit by swapping the account's head, under the
+	/// account lock they already hold, & never wait on readers; readers pin a version & walk each account's chain back to it without
+	/// taking any account lock. A commit that changes two accounts publishes both under the same version, so a reader sees all of a
+	/// transfer or none of it. The only shared lock guards the pin list, which commits read through one atomic
+	/// </summary>
+	class VersionStore
+	{
+		public:
+			VersionStore() {}
+			~VersionStore() {}
+
+			//publishes an account's current state as a new commit; a second account changed in the same commit can be given too
+			void publish(Account& a, Account* b = nullptr);
+			//pins the newest commit for a reader, returns it
+			std::uint64_t pin();
+			//releases a pin; versions only it needed are dropped on the next publish to each account
+			void unpin(std::uint64_t version);
+			//an account's state as of a version, null if it didn't exist yet
+			static std::shared_ptr<const AccountVersion> at(Account& a, std::uint64_t version);
+			//states an account is holding on to, for diagnostics
+			static int retained(Account& a);
+
+			//newest commit readers can see
+			std::uint64_t current()
+			{
+				return visible.load();
+			}
+
+		private:
+			//drops the states below the newest one at or before keep; called under the account's lock
+			static void trim(Account& a, std::uint64_t keep);
+			//stores the oldest pin for commits to read; called under pinLock
+			void setOldest();
+
+			std::atomic<std::uint64_t> issued{ 0 }; //newest version handed to a commit
+			std::atomic<std::uint64_t> visible{ 0 }; //newest version that it & every commit before it are linked; what readers pin
+			std::atomic<std::uint64_t> oldestPin{ UINT64_MAX }; //oldest pinned version, the max when nothing is pinned
+			std::mutex pinLock; //guards pins
+			std::multiset<std::uint64_t> pins; //versions readers have pinned
+	};
+
+	/// <summary>
+	/// A reader's pinned, consistent view of the bank; the pin is released when the view goes away
+	/// </summary>
+	class ReadView
+	{
+		public:
+			ReadView(std::shared_ptr<VersionStore> s) : store(s), version(s->pin()) {}
+			~ReadView()
+			{
+				store->unpin(version);
+			}
+			ReadView(const ReadView&) = delete;
+			ReadView& operator=(const ReadView&) = delete;
+
+			//an account as this view sees it, null if it was added after the view was taken
+			std::shared_ptr<const AccountVersion> at(Account& a)
+			{
+				return VersionStore::at(a, version);
+			}
+
+			//the pinned commit
+			std::uint64_t getVersion()
+			{
+				return version;
+			}
+
+		private:
+			std::shared_ptr<VersionStore> store;
+			std::uint64_t version;
+	};
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "List.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace DB
+{
+	//Forward declarations
+	class Database;
+	class Account;
+	class Transaction;
+	class User;
+
+	/// <summary>
+	/// Thrown when the log file can't be opened or written
+	/// </summary>
+	class ExLogIO : public Exception
+	{
+		public:
+			/// <summary>
+			/// Constructor
+			/// </summary>
+			/// <param name="s">throwing function</param>
+			ExLogIO(std::string s) : Exception(s) {}
+
+			/// <summary>
+			/// print the error to cout
+			/// </summary>
+			void printError()
+			{
+				std::cout << "Could not write the database log, while executing function: " << throwingFunc << "\n";
+			}
+	};
+
+	/// <summary>
+	/// Thrown when an intact log record can't be applied, so the log & the bank disagree
+	/// </summary>
+	class ExLogReplay : public Exception
+	{
+		public:
+			/// <summary>
+			/// Constructor
+			/// </summary>
+			/// <param name="s">throwing function</param>
+			/// <param name="r">sequence number of the record</param>
+			ExLogReplay(std::string s, std::uint64_t r) : Exception(s), record(r) {}
+
+			/// <summary>
+			/// print the error to cout
+			/// </summary>
+			void printError()
+			{
+				std::cout << "Could not apply database log record " << record << ", while executing function: " << throwingFunc << "\n";
+			}
+
+			std::uint64_t record; //sequence number of the record
+	};
+
+	/// <summary>
+	/// Append-only write-ahead log. Every mutation is written here as a compact binary record & is on disk before the call that made it returns.
+	/// With group commit, callers that arrive while a sync is running queue up & the next sync covers all of them, so concurrent
+	/// mutations share one fsync instead of paying for one each
+	/// </summary>
+	class WriteAheadLog
+	{
+		public:
+			//how records are made durable
+			enum SyncMode
+			{
+				SyncEachRecord, //one fsync per record
+				GroupCommit //records arriving together share an fsync
+			};
+
+			WriteAheadLog(std::string p, SyncMode m = GroupCommit, std::uint64_t records = 0);
+			~WriteAheadLog();
+
+			//appends one record & waits until it's on disk
+			void append(const std::string& record);
+			//queues a record in log order; returns its sequence number. under group commit this doesn't wait, so it can be called while holding a lock
+			std::uint64_t enqueue(const std::string& record);
+			//waits until every record up to a sequence number is on disk
+			void waitDurable(std::uint64_t seq);
+
+			//record builders, one per kind of mutation
+			static std::string customerRecord(User& u);
+			static std::string employeeRecord(User& u);
+			static std::string accountRecord(Account& a, std::string owner);
+			static std::string postingRecord(std::string id, Transaction& t);
+			static std::string interestRecord(Account& a);
+			static std::string interestRecord(std::string id, std::int32_t soFar, std::chrono::system_clock::time_point last, std::chrono::system_clock::time_point paid);
+			static std::string ownerRecord(std::string id, std::string owner);
+			static std::string transferRecord(std::string from, Transaction& out, std::string to, Transaction& in);
+			static std::string passwordRecord(User& u);
+
+			//applies every complete record in a log file to a database; stops at the first torn or corrupt record. returns records applied,
+			//throws ExLogReplay if an intact record can't be applied
+			static int replay(std::string path, Database& d);
+			//same, starting after a snapshot's checkpoint & giving the length of the intact part of the file & its newest sequence number
+			static int replay(std::string path, Database& d, std::uint64_t& validBytes, std::uint64_t& lastSeq, std::uint64_t from = 0);
+
+			//drops the records up to seq, which a snapshot now has, by rotating to a file that starts after them
+			bool checkpoint(std::uint64_t seq);
+
+			//file the log lives in
+			std::string getPath()
+			{
+				return path;
+			}
+
+			//records appended
+			std::uint64_t records()
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				return appended;
+			}
+
+			//fsyncs done; under group commit this is well below records() when callers overlap
+			std::uint64_t syncs()
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				return synced;
+			}
+
+		private:
+			//writes bytes to the file & forces them to disk
+			void writeDurable(const std::string& bytes);
+			//closes the file
+			void closeFile();
+
+			std::string path; //log file path
+			SyncMode mode;
+			int fd = -1; //file descriptor, kept open for the life of the log
+
+			std::mutex lock; //guards everything below
+			std::condition_variable flushed; //signalled whenever a group is on disk
+			std::string pending; //framed records waiting for the next sync
+			std::uint64_t appended = 0; //sequence number of the newest record
+			std::uint64_t durable = 0; //sequence number of the newest record on disk
+			std::uint64_t synced = 0; //fsyncs done
+			bool flushing = false; //a thread is writing a group right now
+			bool failed = false; //a write failed; nothing more is accepted
+	};
+}